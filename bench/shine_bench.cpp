@@ -0,0 +1,346 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+#include "treegenerator.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include <sys/time.h>
+
+using namespace shine;
+
+/**
+ * The benchmark options, see print_usage().
+ */
+struct BenchOptions
+{
+    BenchOptions()
+    : module_file("mod1.o"), primitives("F,G,H,I"), arity_mix(""),
+      min_depth(1), max_depth(8), num_trees(200), num_rows(10000),
+      seed(42), terminal_probability(0.3),
+      profile(ModuleHandler::PROFILE_MAX_THROUGHPUT) {};
+
+    std::string module_file;
+    std::string primitives;
+    std::string arity_mix;
+    unsigned int min_depth;
+    unsigned int max_depth;
+    unsigned int num_trees;
+    unsigned int num_rows;
+    unsigned long seed;
+    double terminal_probability;
+    ModuleHandler::OptimizationProfile profile;
+};
+
+/**
+ * The samples of a phase, in seconds.
+ */
+typedef std::vector<double> Samples;
+
+static double wall_time()
+{
+    struct timeval time_value;
+    gettimeofday(&time_value, NULL);
+    return time_value.tv_sec + time_value.tv_usec * 1e-6;
+}
+
+static std::vector<std::string> split(const std::string &value, char separator)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while(std::getline(stream, item, separator))
+        if(!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+/**
+ * Returns the percentile of the samples, using the nearest rank.
+ */
+static double percentile(Samples samples, double rank)
+{
+    if(samples.empty())
+        return 0.0;
+
+    std::sort(samples.begin(), samples.end());
+    unsigned int index = rank * samples.size();
+    if(index >= samples.size())
+        index = samples.size()-1;
+    return samples[index];
+}
+
+static void print_usage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "  --module FILE         Bitcode module with the primitives (mod1.o)" << std::endl
+              << "  --primitives F,G,...  Primitive set (F,G,H,I)" << std::endl
+              << "  --arity-mix 1:w,2:w   Weight of the primitives of each arity (1 each)" << std::endl
+              << "  --min-depth N         Minimum tree depth (1)" << std::endl
+              << "  --max-depth N         Maximum tree depth (8)" << std::endl
+              << "  --trees N             Trees for each depth (200)" << std::endl
+              << "  --rows N              Dataset rows for the evaluation (10000)" << std::endl
+              << "  --terminal-prob P     Terminal probability above the maximum depth (0.3)" << std::endl
+              << "  --profile NAME        fast-compile, balanced or max-throughput" << std::endl
+              << "  --seed N              Random seed (42)" << std::endl;
+}
+
+static bool parse_options(int argc, char **argv, BenchOptions &options)
+{
+    for(int i=1; i < argc; i++)
+    {
+        const std::string option = argv[i];
+
+        if(option=="--help" || i+1 >= argc)
+            return false;
+
+        const std::string value = argv[++i];
+
+        if(option=="--module")
+            options.module_file = value;
+        else if(option=="--primitives")
+            options.primitives = value;
+        else if(option=="--arity-mix")
+            options.arity_mix = value;
+        else if(option=="--min-depth")
+            options.min_depth = std::atoi(value.c_str());
+        else if(option=="--max-depth")
+            options.max_depth = std::atoi(value.c_str());
+        else if(option=="--trees")
+            options.num_trees = std::atoi(value.c_str());
+        else if(option=="--rows")
+            options.num_rows = std::atoi(value.c_str());
+        else if(option=="--terminal-prob")
+            options.terminal_probability = std::atof(value.c_str());
+        else if(option=="--seed")
+            options.seed = std::strtoul(value.c_str(), NULL, 10);
+        else if(option=="--profile")
+        {
+            if(!ModuleHandler::parse_profile_name(value, options.profile))
+                return false;
+        }
+        else
+            return false;
+    }
+
+    return options.min_depth <= options.max_depth &&
+           options.num_trees > 0 && options.num_rows > 0;
+}
+
+static ModuleHandler *create_handler(const BenchOptions &options,
+                                     std::string &error_string)
+{
+    ModuleLoader *loader =
+            ModuleLoader::create_from_file(options.module_file, error_string);
+
+    if(!loader)
+        return NULL;
+
+    ModuleLinker *link = new ModuleLinker("shine_bench", "shine_bench");
+
+    bool link_ret = link->link_module_loader(loader, error_string);
+    delete loader;
+
+    if(!link_ret)
+    {
+        delete link;
+        return NULL;
+    }
+
+    ModuleHandler *handler =
+            ModuleHandler::create(link->release_module(), error_string,
+                                  NULL, NULL, options.profile);
+    delete link;
+    return handler;
+}
+
+static void print_samples(const std::string &phase, const Samples &samples, double scale,
+                          const std::string &unit)
+{
+    std::cout << "    " << std::left << std::setw(18) << phase << std::right
+              << " p50 " << std::setw(10) << percentile(samples, 0.50) * scale
+              << " p90 " << std::setw(10) << percentile(samples, 0.90) * scale
+              << " p99 " << std::setw(10) << percentile(samples, 0.99) * scale
+              << " max " << std::setw(10) << percentile(samples, 1.0) * scale
+              << " " << unit << std::endl;
+}
+
+/**
+ * Runs the benchmark of the trees of a depth, with a new handler,
+ * since the module passes change the entire module.
+ */
+static bool run_depth(const BenchOptions &options, unsigned int depth,
+                      TreeGenerator &generator, const std::vector<std::string> &vars,
+                      const std::vector<const double*> &columns,
+                      std::string &error_string)
+{
+    ModuleHandler *handler = create_handler(options, error_string);
+    if(!handler)
+        return false;
+
+    handler->set_variable_list(vars);
+
+    // The primitives are optimized before the kernels call them
+    const double module_start = wall_time();
+    handler->run_module_passes();
+    const double module_time = wall_time() - module_start;
+
+    Samples codegen_samples, passes_samples, jit_samples, row_samples;
+    unsigned long total_nodes = 0;
+
+    std::vector<double> out(options.num_rows);
+
+    for(unsigned int i=0; i < options.num_trees; i++)
+    {
+        std::vector<ASTNode*> ast_nodes;
+        generator.generate(depth, ast_nodes);
+        total_nodes += ast_nodes.size();
+
+        std::stringstream ss_name;
+        ss_name << "bench_" << i;
+
+        const bool codegen_ret = handler->codegen_ast_batch(&ast_nodes, ss_name.str())!=NULL;
+
+        for(unsigned int j=0; j < ast_nodes.size(); j++)
+            delete ast_nodes[j];
+
+        if(!codegen_ret)
+        {
+            error_string = "Code generation failed for " + ss_name.str();
+            delete handler;
+            return false;
+        }
+
+        handler->run_function_passes(ss_name.str());
+
+        Evaluator::BatchKernel kernel =
+            (Evaluator::BatchKernel)(intptr_t)handler->jit_function(ss_name.str());
+
+        ModuleHandler::FunctionStats stats;
+        handler->get_function_stats(ss_name.str(), stats);
+        codegen_samples.push_back(stats.codegen_time);
+        passes_samples.push_back(stats.function_passes_time);
+        jit_samples.push_back(stats.jit_time);
+
+        const double evaluation_start = wall_time();
+        kernel(&columns[0], &out[0], options.num_rows);
+        row_samples.push_back((wall_time() - evaluation_start) / options.num_rows);
+    }
+
+    std::cout << "depth " << depth << ": " << options.num_trees << " trees, "
+              << (double)total_nodes / options.num_trees << " nodes/tree" << std::endl;
+    print_samples("codegen", codegen_samples, 1e6, "us");
+    print_samples("function passes", passes_samples, 1e6, "us");
+    print_samples("jit", jit_samples, 1e6, "us");
+    print_samples("evaluation", row_samples, 1e9, "ns/row");
+    std::cout << "    " << std::left << std::setw(18) << "module passes" << std::right
+              << " total " << module_time * 1e3 << " ms" << std::endl;
+
+    delete handler;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if(!parse_options(argc, argv, options))
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    std::string error_string;
+
+    shine_initialize();
+
+    // Resolves the arity of the primitives
+    ModuleHandler *handler = create_handler(options, error_string);
+    if(!handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+    vars.push_back("z");
+
+    TreeGenerator generator(vars, options.seed);
+    generator.set_terminal_probability(options.terminal_probability);
+
+    const std::vector<std::string> primitives = split(options.primitives, ',');
+    for(unsigned int i=0; i < primitives.size(); i++)
+    {
+        unsigned int arity = 0;
+        if(!handler->get_primitive_pointer(primitives[i], &arity) || arity==0)
+        {
+            std::cout << "Error: invalid primitive " << primitives[i] << std::endl;
+            return -1;
+        }
+        generator.add_primitive(primitives[i], arity);
+    }
+
+    delete handler;
+
+    const std::vector<std::string> arity_mix = split(options.arity_mix, ',');
+    for(unsigned int i=0; i < arity_mix.size(); i++)
+    {
+        const std::vector<std::string> arity_weight = split(arity_mix[i], ':');
+        if(arity_weight.size()!=2)
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+        generator.set_arity_weight(std::atoi(arity_weight[0].c_str()),
+                                   std::atof(arity_weight[1].c_str()));
+    }
+
+    std::vector<std::vector<double> > dataset(vars.size(), std::vector<double>(options.num_rows));
+    std::vector<const double*> columns;
+    for(unsigned int var_index=0; var_index < vars.size(); var_index++)
+    {
+        for(unsigned int row=0; row < options.num_rows; row++)
+            dataset[var_index][row] = generator.random_uniform() * 2.0 - 1.0;
+        columns.push_back(&dataset[var_index][0]);
+    }
+
+    std::cout << "profile " << ModuleHandler::get_profile_name(options.profile)
+              << ", " << options.num_rows << " rows" << std::endl;
+
+    for(unsigned int depth=options.min_depth; depth <= options.max_depth; depth++)
+    {
+        if(!run_depth(options, depth, generator, vars, columns, error_string))
+        {
+            std::cout << "Error: " << error_string << std::endl;
+            return -1;
+        }
+    }
+
+    shine_shutdown();
+
+    return 0;
+}
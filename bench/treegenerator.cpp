@@ -0,0 +1,119 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "treegenerator.h"
+
+#include "astnode.h"
+
+#include <cassert>
+
+namespace shine
+{
+
+TreeGenerator::TreeGenerator(const std::vector<std::string> &var_list, uint64_t seed)
+: mVariableList(var_list), mTerminalProbability(0.3),
+  mState(seed ? seed : 0x9E3779B97F4A7C15ULL)
+{
+    assert(var_list.size()>0);
+}
+
+void TreeGenerator::add_primitive(const std::string &name, unsigned int arity)
+{
+    assert(arity>0);
+
+    if(mPrimitives.size() <= arity)
+    {
+        mPrimitives.resize(arity+1);
+        mArityWeights.resize(arity+1, 1.0);
+    }
+
+    mPrimitives[arity].push_back(name);
+}
+
+void TreeGenerator::set_arity_weight(unsigned int arity, double weight)
+{
+    if(mArityWeights.size() <= arity)
+    {
+        mPrimitives.resize(arity+1);
+        mArityWeights.resize(arity+1, 1.0);
+    }
+
+    mArityWeights[arity] = weight;
+}
+
+double TreeGenerator::random_uniform()
+{
+    // xorshift64*
+    mState ^= mState >> 12;
+    mState ^= mState << 25;
+    mState ^= mState >> 27;
+    const uint64_t value = mState * 2685821657736338717ULL;
+    return (value >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void TreeGenerator::generate_terminal(std::vector<ASTNode*> &ast_nodes)
+{
+    if(random_uniform() < 0.5)
+    {
+        const unsigned int var_index = random_uniform() * mVariableList.size();
+        ast_nodes.push_back(new ASTVariable(mVariableList[var_index]));
+        return;
+    }
+
+    ast_nodes.push_back(new ASTConstant(random_uniform() * 20.0 - 10.0));
+}
+
+void TreeGenerator::generate(unsigned int max_depth, std::vector<ASTNode*> &ast_nodes)
+{
+    double total_weight = 0.0;
+    for(unsigned int arity=1; arity < mPrimitives.size(); arity++)
+        if(!mPrimitives[arity].empty())
+            total_weight += mArityWeights[arity];
+
+    if(max_depth==0 || total_weight <= 0.0 || random_uniform() < mTerminalProbability)
+    {
+        generate_terminal(ast_nodes);
+        return;
+    }
+
+    // The arity by weight, then the primitive uniformly
+    double choice = random_uniform() * total_weight;
+    unsigned int arity = 1;
+    for(; arity < mPrimitives.size(); arity++)
+    {
+        if(mPrimitives[arity].empty())
+            continue;
+        if(choice < mArityWeights[arity])
+            break;
+        choice -= mArityWeights[arity];
+    }
+
+    // Rounding may leave the choice past the last arity
+    while(arity >= mPrimitives.size() || mPrimitives[arity].empty())
+        arity--;
+
+    const std::vector<std::string> &primitives = mPrimitives[arity];
+    const unsigned int prim_index = random_uniform() * primitives.size();
+    ast_nodes.push_back(new ASTFunction(primitives[prim_index]));
+
+    for(unsigned int arg=0; arg < arity; arg++)
+        generate(max_depth-1, ast_nodes);
+}
+
+}
@@ -0,0 +1,140 @@
+/**
+ * \file treegenerator.h
+ * This file defines and implement the TreeGenerator related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TREEGENERATOR_H
+#define TREEGENERATOR_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace shine
+{
+
+class ASTNode;
+
+/**
+ * This class generates random pre-order ASTs for the benchmarks, using
+ * the "grow" method of the Genetic Programming initialization: the nodes
+ * above the maximum depth are functions or terminals, and the nodes at
+ * the maximum depth are terminals. The generator is deterministic for a
+ * given seed.
+ */
+class TreeGenerator
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates a generator.
+     *
+     * \param var_list The variable names.
+     * \param seed The random seed.
+     */
+    TreeGenerator(const std::vector<std::string> &var_list, uint64_t seed);
+    virtual ~TreeGenerator() {};
+
+// Public interface
+public:
+    /**
+     * Adds a primitive to the primitive set.
+     *
+     * \param name The primitive name.
+     * \param arity The number of arguments of the primitive.
+     */
+    void add_primitive(const std::string &name, unsigned int arity);
+
+    /**
+     * Sets the weight of the primitives of an arity, the primitives are
+     * chosen first by arity (using the weights) and then uniformly inside
+     * the arity. The default weight is 1.
+     *
+     * \param arity The number of arguments.
+     * \param weight The weight of the arity.
+     */
+    void set_arity_weight(unsigned int arity, double weight);
+
+    /**
+     * Sets the probability of a terminal above the maximum depth,
+     * use 0.0 for full trees.
+     *
+     * \param probability The terminal probability.
+     */
+    void set_terminal_probability(double probability)
+    { mTerminalProbability = probability; }
+
+    /**
+     * Generates a random tree, the nodes are owned by the caller.
+     *
+     * \param max_depth The maximum depth of the tree, 0 for a terminal.
+     * \param ast_nodes Receives the pre-order nodes.
+     */
+    void generate(unsigned int max_depth, std::vector<ASTNode*> &ast_nodes);
+
+    /**
+     * Returns a uniform random number in [0, 1).
+     *
+     * \return The random number.
+     */
+    double random_uniform();
+
+// Private interface
+private:
+    /**
+     * Appends a random terminal: a variable or a constant.
+     *
+     * \param ast_nodes The pre-order nodes.
+     */
+    void generate_terminal(std::vector<ASTNode*> &ast_nodes);
+
+private:
+    /**
+     * The variable names.
+     */
+    std::vector<std::string> mVariableList;
+
+    /**
+     * The primitive names, indexed by arity.
+     */
+    std::vector<std::vector<std::string> > mPrimitives;
+
+    /**
+     * The weight of each arity.
+     */
+    std::vector<double> mArityWeights;
+
+    /**
+     * The probability of a terminal above the maximum depth.
+     */
+    double mTerminalProbability;
+
+    /**
+     * The xorshift state.
+     */
+    uint64_t mState;
+};
+
+} // namespace shine
+
+#endif // TREEGENERATOR_H
@@ -0,0 +1,312 @@
+/**
+ * \file astarena.h
+ * This file defines and implement the ASTArena related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ASTARENA_H
+#define ASTARENA_H
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include <cassert>
+
+#include <stdint.h>
+
+#include "astnode.h"
+
+namespace tr1impl = std::tr1;
+
+namespace shine
+{
+
+/**
+ * A tree stored in an ASTArena, it is the range of its pre-order
+ * nodes in the arena, so it is valid until the arena is cleared.
+ */
+struct FlatTree
+{
+    FlatTree() : begin(0), size(0) {};
+    FlatTree(unsigned int tree_begin, unsigned int tree_size)
+    : begin(tree_begin), size(tree_size) {};
+
+    /**
+     * The index of the root node in the arena.
+     */
+    unsigned int begin;
+
+    /**
+     * The number of nodes of the tree.
+     */
+    unsigned int size;
+};
+
+/**
+ * This class stores the pre-order trees of a generation in contiguous
+ * arrays (a struct of arrays with the opcode, the arity and the payload
+ * of each node), instead of a heap allocated ASTNode for each node. The
+ * payload is the constant index for the constants, and the symbol id for
+ * the variables and functions. The symbols are interned and kept when the
+ * arena is cleared, since the primitive set doesn't change between the
+ * generations, so the release of a generation is a single clear() call.
+ */
+class ASTArena
+{
+// Ctor & Dtor
+public:
+    ASTArena() {};
+    virtual ~ASTArena() {};
+
+// Not implemented copy/assign
+private:
+    ASTArena(const ASTArena&);
+    ASTArena& operator=(const ASTArena&);
+
+// Public interface
+public:
+    /**
+     * Declares a function symbol (a primitive), its arity is used by the
+     * nodes of the symbol. If the symbol is already declared, its id is
+     * returned.
+     *
+     * \param name The function name.
+     * \param arity The number of arguments of the function.
+     * \return The symbol id.
+     */
+    unsigned int add_function_symbol(const std::string &name, unsigned int arity);
+
+    /**
+     * Declares a variable symbol, if the symbol is already
+     * declared, its id is returned.
+     *
+     * \param name The variable name.
+     * \return The symbol id.
+     */
+    unsigned int add_variable_symbol(const std::string &name);
+
+    /**
+     * Appends a function node, the function symbol must be declared.
+     *
+     * \param symbol The function symbol id.
+     */
+    void push_function(unsigned int symbol)
+    {
+        assert(symbol < mFunctionNames.size());
+        push_node(ASTNode::AST_FUNCTION, mFunctionArities[symbol], symbol);
+    }
+
+    /**
+     * Appends a variable node.
+     *
+     * \param symbol The variable symbol id.
+     */
+    void push_variable(unsigned int symbol)
+    {
+        assert(symbol < mVariableNames.size());
+        push_node(ASTNode::AST_VARIABLE, 0, symbol);
+    }
+
+    /**
+     * Appends a constant node.
+     *
+     * \param value The constant value.
+     */
+    void push_constant(double value)
+    {
+        push_node(ASTNode::AST_CONSTANT, 0, mConstants.size());
+        mConstants.push_back(value);
+    }
+
+    /**
+     * Returns the tree of the nodes appended since \p begin, which
+     * must be the size() of the arena before the first node.
+     *
+     * \param begin The index of the root node.
+     * \return The tree.
+     */
+    FlatTree end_tree(unsigned int begin) const
+    {
+        assert(begin <= mOpcodes.size());
+        return FlatTree(begin, mOpcodes.size()-begin);
+    }
+
+    /**
+     * Copies an ASTNode tree into the arena, the variable symbols are
+     * declared when needed, but the function symbols must be declared
+     * before, since the ASTFunction nodes have no arity.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param tree The tree in the arena.
+     * \param error_string The error string.
+     * \return true on success, false otherwise.
+     */
+    bool add_tree(const std::vector<ASTNode*> *ast_nodes, FlatTree &tree,
+                  std::string &error_string);
+
+    /**
+     * Releases all the trees of the arena, keeping the symbols
+     * and the allocated memory for the next generation.
+     */
+    void clear();
+
+    /**
+     * Returns the number of nodes of the arena.
+     *
+     * \return The number of nodes.
+     */
+    unsigned int size() const
+    { return mOpcodes.size(); }
+
+    /**
+     * Returns the type of a node.
+     *
+     * \param node_index The node index.
+     * \return The node type.
+     */
+    ASTNode::ASTNodeType get_opcode(unsigned int node_index) const
+    { return static_cast<ASTNode::ASTNodeType>(mOpcodes[node_index]); }
+
+    /**
+     * Returns the number of arguments of a node.
+     *
+     * \param node_index The node index.
+     * \return The number of arguments, 0 for constants and variables.
+     */
+    unsigned int get_arity(unsigned int node_index) const
+    { return mArities[node_index]; }
+
+    /**
+     * Returns the payload of a node: the constant index or the symbol id.
+     *
+     * \param node_index The node index.
+     * \return The payload.
+     */
+    unsigned int get_payload(unsigned int node_index) const
+    { return mPayloads[node_index]; }
+
+    /**
+     * Returns a constant value.
+     *
+     * \param constant_index The payload of the constant node.
+     * \return The constant value.
+     */
+    double get_constant(unsigned int constant_index) const
+    { return mConstants[constant_index]; }
+
+    /**
+     * Returns the name of a function symbol.
+     *
+     * \param symbol The symbol id.
+     * \return The function name.
+     */
+    const std::string &get_function_name(unsigned int symbol) const
+    { return mFunctionNames[symbol]; }
+
+    /**
+     * Returns the name of a variable symbol.
+     *
+     * \param symbol The symbol id.
+     * \return The variable name.
+     */
+    const std::string &get_variable_name(unsigned int symbol) const
+    { return mVariableNames[symbol]; }
+
+    /**
+     * Returns the number of function symbols.
+     *
+     * \return The number of function symbols.
+     */
+    unsigned int get_num_function_symbols() const
+    { return mFunctionNames.size(); }
+
+    /**
+     * Returns the number of variable symbols.
+     *
+     * \return The number of variable symbols.
+     */
+    unsigned int get_num_variable_symbols() const
+    { return mVariableNames.size(); }
+
+// Private interface
+private:
+    /**
+     * Appends a node.
+     *
+     * \param opcode The node type.
+     * \param arity The number of arguments.
+     * \param payload The constant index or the symbol id.
+     */
+    void push_node(ASTNode::ASTNodeType opcode, unsigned int arity,
+                   unsigned int payload)
+    {
+        mOpcodes.push_back(static_cast<uint8_t>(opcode));
+        mArities.push_back(static_cast<uint8_t>(arity));
+        mPayloads.push_back(payload);
+    }
+
+private:
+    /**
+     * The node types.
+     */
+    std::vector<uint8_t> mOpcodes;
+
+    /**
+     * The node arities.
+     */
+    std::vector<uint8_t> mArities;
+
+    /**
+     * The node payloads.
+     */
+    std::vector<uint32_t> mPayloads;
+
+    /**
+     * The constant values.
+     */
+    std::vector<double> mConstants;
+
+    /**
+     * The function symbols and their arities.
+     */
+    std::vector<std::string> mFunctionNames;
+    std::vector<unsigned int> mFunctionArities;
+
+    /**
+     * The variable symbols.
+     */
+    std::vector<std::string> mVariableNames;
+
+    /**
+     * This typedef declares a hash map from name to symbol id.
+     */
+    typedef tr1impl::unordered_map<std::string, unsigned int> SymbolMap;
+
+    /**
+     * The hash maps from name to symbol id.
+     */
+    SymbolMap mFunctionSymbols;
+    SymbolMap mVariableSymbols;
+};
+
+} // namespace shine
+
+#endif // ASTARENA_H
@@ -30,6 +30,8 @@
 #include <vector>
 #include <iostream>
 
+#include <stdint.h>
+
 namespace shine
 {
 
@@ -66,6 +68,64 @@ public:
      * \return The node type
      */
     virtual ASTNodeType get_id() const = 0;
+
+    /**
+     * The symbol id of the variables and functions not
+     * resolved by a ModuleHandler.
+     *
+     * \see ModuleHandler::resolve_symbols
+     */
+    static const int NO_SYMBOL = -1;
+
+// Public static interface
+public:
+    /**
+     * This method returns a canonical structural key of the pre-order
+     * AST, two trees have the same key if and only if they have the same
+     * structure, the same function and variable names and the same
+     * constants (compared bit by bit).
+     *
+     * \param ast_nodes The pre-order AST Tree.
+     * \return The structural key (a binary string).
+     */
+    static std::string structural_key(const std::vector<ASTNode*> *ast_nodes);
+
+    /**
+     * This method returns a structural hash of the pre-order AST, it
+     * is the hash of the structural key, but computed without building
+     * the key.
+     *
+     * \see ASTNode::structural_key
+     * \param ast_nodes The pre-order AST Tree.
+     * \return The structural hash.
+     */
+    static uint64_t structural_hash(const std::vector<ASTNode*> *ast_nodes);
+
+    /**
+     * This method returns the structural key of a subtree of the
+     * pre-order AST.
+     *
+     * \see ASTNode::structural_key
+     * \param ast_nodes The pre-order AST Tree.
+     * \param begin The index of the subtree root.
+     * \param size The number of nodes of the subtree.
+     * \return The structural key (a binary string).
+     */
+    static std::string structural_key(const std::vector<ASTNode*> *ast_nodes,
+                                      unsigned int begin, unsigned int size);
+
+    /**
+     * This method returns the structural hash of a subtree of the
+     * pre-order AST.
+     *
+     * \see ASTNode::structural_hash
+     * \param ast_nodes The pre-order AST Tree.
+     * \param begin The index of the subtree root.
+     * \param size The number of nodes of the subtree.
+     * \return The structural hash.
+     */
+    static uint64_t structural_hash(const std::vector<ASTNode*> *ast_nodes,
+                                    unsigned int begin, unsigned int size);
 };
 
 /**
@@ -87,7 +147,7 @@ public:
      *             match with the variable name of the individual.
      */
     ASTVariable(const std::string &name)
-    : mName(name) { };
+    : mName(name), mSymbol(NO_SYMBOL) { };
     virtual ~ASTVariable() {};
 
 public:
@@ -100,16 +160,33 @@ public:
      *
      * \return The name of the variable.
      */
-    std::string get_name() const { return mName; }
+    const std::string &get_name() const { return mName; }
 
     /**
-     * Sets the name of the variable.
+     * Sets the name of the variable, the symbol id is reset.
      * \see ASTVariable::ASTVariable
      * \see ASTVariable::get_name
      *
      * \param name The name of the variable.
      */
-    void set_name(const std::string &name) { mName = name; }
+    void set_name(const std::string &name) { mName = name; mSymbol = NO_SYMBOL; }
+
+    /**
+     * Returns the symbol id of the variable, which is its index
+     * in the variable list of the ModuleHandler.
+     * \see ModuleHandler::resolve_symbols
+     *
+     * \return The symbol id, or ASTNode::NO_SYMBOL if not resolved.
+     */
+    int get_symbol() const { return mSymbol; }
+
+    /**
+     * Sets the symbol id of the variable.
+     * \see ASTVariable::get_symbol
+     *
+     * \param symbol The symbol id.
+     */
+    void set_symbol(int symbol) { mSymbol = symbol; }
 
     virtual void print_stream(std::ostream &stream) const
     { stream << "[ASTVariable " << mName << "]"; }
@@ -119,6 +196,11 @@ private:
      * The name of the variable.
      */
     std::string mName;
+
+    /**
+     * The symbol id of the variable.
+     */
+    int mSymbol;
 };
 
 /**
@@ -180,7 +262,7 @@ public:
      * \param name Function name.
      */
     ASTFunction(const std::string &name)
-    : mName(name) {};
+    : mName(name), mSymbol(NO_SYMBOL) {};
     virtual ~ASTFunction() {};
 
 public:
@@ -193,16 +275,33 @@ public:
      *
      * \return The name of the function.
      */
-    std::string get_name() const { return mName; }
+    const std::string &get_name() const { return mName; }
 
     /**
-     * Sets the name of the function.
+     * Sets the name of the function, the symbol id is reset.
      * \see ASTFunction::ASTFunction
      * \see ASTFunction::get_name
      *
      * \param name The name of the function.
      */
-    void set_name(const std::string &name) { mName = name; }
+    void set_name(const std::string &name) { mName = name; mSymbol = NO_SYMBOL; }
+
+    /**
+     * Returns the symbol id of the function, which is its index
+     * in the primitive table of the ModuleHandler.
+     * \see ModuleHandler::resolve_symbols
+     *
+     * \return The symbol id, or ASTNode::NO_SYMBOL if not resolved.
+     */
+    int get_symbol() const { return mSymbol; }
+
+    /**
+     * Sets the symbol id of the function.
+     * \see ASTFunction::get_symbol
+     *
+     * \param symbol The symbol id.
+     */
+    void set_symbol(int symbol) { mSymbol = symbol; }
 
     virtual void print_stream(std::ostream &stream) const
     { stream << "[ASTFunction " << mName << "]"; }
@@ -212,6 +311,11 @@ private:
      * Function name.
      */
     std::string mName;
+
+    /**
+     * The symbol id of the function.
+     */
+    int mSymbol;
 };
 
 
@@ -0,0 +1,263 @@
+/**
+ * \file bytecodevm.h
+ * This file defines and implement the BytecodeVM related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef BYTECODEVM_H
+#define BYTECODEVM_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <tr1/unordered_map>
+
+namespace tr1impl = std::tr1;
+
+namespace shine
+{
+
+class ModuleHandler;
+class ASTNode;
+
+/**
+ * This class holds the register bytecode of a tree, compiled by
+ * BytecodeVM::compile(). The operands are slots: the variable columns
+ * first, then the constants, the output and the temporary registers.
+ */
+class BytecodeProgram
+{
+    friend class BytecodeVM;
+
+// Ctor & Dtor
+public:
+    virtual ~BytecodeProgram() {};
+
+private:
+    BytecodeProgram() : mNumVariables(0), mNumRegisters(0) {};
+
+// Not implemented copy/assign
+private:
+    BytecodeProgram(const BytecodeProgram&);
+    BytecodeProgram& operator=(const BytecodeProgram&);
+
+// Public interface
+public:
+    /**
+     * Returns the number of instructions of the program.
+     *
+     * \return The number of instructions.
+     */
+    unsigned int size() const
+    { return mInstructions.size(); }
+
+    /**
+     * Returns the number of temporary registers used by the program.
+     *
+     * \return The number of temporary registers.
+     */
+    unsigned int get_num_registers() const
+    { return mNumRegisters; }
+
+// Private interface
+private:
+    /**
+     * The opcodes of the instructions.
+     */
+    enum Opcode
+    {
+        OP_CALL, /**< Calls a primitive */
+        OP_COPY  /**< Copies a slot, used when the root isn't a function */
+    };
+
+    /**
+     * A bytecode instruction.
+     */
+    struct Instruction
+    {
+        /**
+         * The opcode of the instruction.
+         */
+        Opcode opcode;
+
+        /**
+         * The number of operands.
+         */
+        unsigned int arg_size;
+
+        /**
+         * The index of the first operand in the operand list.
+         */
+        unsigned int first_arg;
+
+        /**
+         * The destination slot.
+         */
+        unsigned int dest;
+
+        /**
+         * The primitive function pointer.
+         */
+        void *function;
+    };
+
+    /**
+     * The instructions.
+     */
+    std::vector<Instruction> mInstructions;
+
+    /**
+     * The operand slots of all the instructions.
+     */
+    std::vector<unsigned int> mOperands;
+
+    /**
+     * The constant values.
+     */
+    std::vector<double> mConstants;
+
+    /**
+     * The number of variables of the program.
+     */
+    unsigned int mNumVariables;
+
+    /**
+     * The number of temporary registers.
+     */
+    unsigned int mNumRegisters;
+};
+
+/**
+ * This class is a backend alternative to the ModuleHandler code generation:
+ * it compiles the pre-order ASTs into a compact register bytecode and
+ * evaluates it a block of rows at a time, so the dispatch cost is paid
+ * once for each block instead of once for each row. The primitives are
+ * called through the function pointers JITed by the ModuleHandler. It is
+ * useful when the compile latency matters more than the peak throughput.
+ * It isn't thread safe, use one instance for each thread.
+ */
+class BytecodeVM
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates a VM for the ModuleHandler, the variables of each program
+     * are taken from the handler variable list when it is compiled.
+     * It doesn't take the ownership of the handler.
+     *
+     * \param handler The ModuleHandler with the primitives.
+     * \param block_size The number of rows evaluated by each instruction dispatch.
+     */
+    BytecodeVM(ModuleHandler *handler, unsigned int block_size=256);
+    virtual ~BytecodeVM() {};
+
+// Not implemented copy/assign
+private:
+    BytecodeVM(const BytecodeVM&);
+    BytecodeVM& operator=(const BytecodeVM&);
+
+// Public interface
+public:
+    /**
+     * Compiles the AST into bytecode.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param error_string The error string.
+     * \return The program, owned by the caller, or NULL on error.
+     */
+    BytecodeProgram *compile(const std::vector<ASTNode*> *ast_nodes,
+                             std::string &error_string);
+
+    /**
+     * Evaluates the program over the dataset, with the same parameters of
+     * the kernels generated by ModuleHandler::codegen_ast_batch().
+     *
+     * \param program The program compiled by this VM.
+     * \param columns The dataset columns, one for each variable.
+     * \param out The output, it must have room for \p n results.
+     * \param n The number of rows.
+     */
+    void evaluate(const BytecodeProgram *program,
+                  const double* const* columns,
+                  double *out, size_t n);
+
+    /**
+     * Returns the number of rows evaluated by each instruction dispatch.
+     *
+     * \return The block size.
+     */
+    unsigned int get_block_size() const
+    { return mBlockSize; }
+
+// Private interface
+private:
+    /**
+     * Runs an instruction over a block of rows.
+     *
+     * \param instruction The instruction.
+     * \param args The operand slots of the instruction.
+     * \param slots The slot pointers of the block.
+     * \param rows The number of rows of the block.
+     */
+    static void run_instruction(const BytecodeProgram::Instruction &instruction,
+                                const unsigned int *args,
+                                double* const* slots, size_t rows);
+
+private:
+    /**
+     * The ModuleHandler with the primitives.
+     */
+    ModuleHandler *mHandler;
+
+    /**
+     * The number of rows evaluated by each instruction dispatch.
+     */
+    unsigned int mBlockSize;
+
+    /**
+     * A JITed primitive.
+     */
+    struct Primitive
+    {
+        void *function;
+        unsigned int arg_size;
+    };
+
+    /**
+     * This typedef declares a hash map from primitive name to its function pointer.
+     */
+    typedef tr1impl::unordered_map<std::string, Primitive> PrimitiveMap;
+
+    /**
+     * The hash map from primitive name to its function pointer.
+     */
+    PrimitiveMap mPrimitives;
+
+    /**
+     * The block buffers of the constants and temporary
+     * registers, reused between evaluations.
+     */
+    std::vector<double> mScratch;
+};
+
+} // namespace shine
+
+#endif // BYTECODEVM_H
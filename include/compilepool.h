@@ -0,0 +1,159 @@
+/**
+ * \file compilepool.h
+ * This file defines and implement the CompilePool related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef COMPILEPOOL_H
+#define COMPILEPOOL_H
+
+#include <string>
+#include <vector>
+
+#include "modulehandler.h"
+
+// External forward declaration
+namespace llvm
+{
+    class Module;
+    class LLVMContext;
+}
+
+namespace shine
+{
+
+class ThreadPool;
+class ASTNode;
+
+/**
+ * This class is a compilation service using multiple worker threads.
+ * Each worker has its own LLVM context, its own copy of the composite
+ * module and its own ModuleHandler (and thus its own Execution Engine),
+ * so the workers can generate, optimize and JIT the trees at the same
+ * time.
+ */
+class CompilePool
+{
+// Ctor & Dtor
+public:
+    /**
+     * Use the create() method instead of this constructor, the
+     * CompilePool takes the ownership of all the parameters.
+     *
+     * \param thread_pool The worker threads.
+     * \param contexts The LLVM context of each worker.
+     * \param handlers The ModuleHandler of each worker.
+     */
+    CompilePool(ThreadPool *thread_pool,
+                const std::vector<llvm::LLVMContext*> &contexts,
+                const std::vector<ModuleHandler*> &handlers);
+    virtual ~CompilePool();
+
+// Not implemented copy/assign
+private:
+    CompilePool(const CompilePool&);
+    CompilePool& operator=(const CompilePool&);
+
+// Public interface
+public:
+    /**
+     * This is the creator method for creating CompilePool instances,
+     * use this method instead of the constructor. The module is copied
+     * into the context of each worker, it does *not* take the ownership
+     * of the module.
+     *
+     * \param module The LLVM module (this is typically from ModuleLinker).
+     * \param var_list The variable list used in your ASTs.
+     * \param num_workers The number of worker threads.
+     * \param error_string Error message in case of error.
+     * \param profile The optimization profile of the worker handlers.
+     * \return A new CompilePool instance in case of success, otherwise
+     *         NULL and the error message on the error_string parameter.
+     */
+    static CompilePool *create(llvm::Module *module,
+                               const std::vector<std::string> &var_list,
+                               unsigned int num_workers,
+                               std::string &error_string,
+                               ModuleHandler::OptimizationProfile profile=
+                                   ModuleHandler::PROFILE_MAX_THROUGHPUT);
+
+    /**
+     * Compiles the population using all the workers, the population is
+     * split in chunks of individuals and each worker compiles a chunk
+     * at a time using ModuleHandler::compile_population().
+     *
+     * \param population The AST Trees of the population.
+     * \param name_prefix The prefix of the function names.
+     * \param kernel_type The type of the generated functions.
+     * \param chunk_size The number of individuals compiled at a time by a worker.
+     * \return The function pointers, in the same order of the population.
+     */
+    std::vector<void*> compile_population(const std::vector<std::vector<ASTNode*> > &population,
+                                          const std::string &name_prefix,
+                                          ModuleHandler::KernelType kernel_type=ModuleHandler::KERNEL_SCALAR,
+                                          unsigned int chunk_size=64);
+
+    /**
+     * This method will free memory from all JITed functions
+     * of all the workers.
+     *
+     * \return true if at least one function was free'd, otherwise false.
+     */
+    bool free_jit_memory(void);
+
+    /**
+     * Returns the number of workers.
+     *
+     * \return The number of workers.
+     */
+    unsigned int get_num_workers() const
+    { return mHandlers.size(); }
+
+    /**
+     * Returns the ModuleHandler of a worker, it must not be used
+     * while the pool is compiling.
+     *
+     * \param worker_index The worker index.
+     * \return The worker ModuleHandler.
+     */
+    ModuleHandler *get_worker_handler(unsigned int worker_index)
+    { return mHandlers[worker_index]; }
+
+private:
+    /**
+     * The worker threads.
+     */
+    ThreadPool *mThreadPool;
+
+    /**
+     * The LLVM context of each worker.
+     */
+    std::vector<llvm::LLVMContext*> mContexts;
+
+    /**
+     * The ModuleHandler of each worker.
+     */
+    std::vector<ModuleHandler*> mHandlers;
+};
+
+} // namespace shine
+
+#endif // COMPILEPOOL_H
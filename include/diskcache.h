@@ -0,0 +1,205 @@
+/**
+ * \file diskcache.h
+ * This file defines and implement the DiskCache related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "modulehandler.h"
+
+namespace shine
+{
+
+class ASTNode;
+
+/**
+ * This class is a persistent cache of the compiled trees, shared by the
+ * processes using the same cache directory. The structural key and the
+ * optimized bitcode of each tree are stored together in a file named by
+ * the structural hash of the tree, inside a subdirectory named by a hash
+ * of the primitives, the variable list, the kernel type, the optimization
+ * profile, the precision and the host target.
+ * On a hit the bitcode is linked into the module and only JITed, so the
+ * code generation and the function passes are skipped. The machine code
+ * itself isn't stored, since the JIT emits it for the process addresses.
+ */
+class DiskCache
+{
+// Ctor & Dtor
+public:
+    /**
+     * Use the create() method instead of this constructor.
+     *
+     * \param handler The ModuleHandler used to compile the trees.
+     * \param directory The cache subdirectory of the handler.
+     * \param kernel_type The type of the cached functions.
+     */
+    DiskCache(ModuleHandler *handler, const std::string &directory,
+              ModuleHandler::KernelType kernel_type);
+    virtual ~DiskCache() {};
+
+// Not implemented copy/assign
+private:
+    DiskCache(const DiskCache&);
+    DiskCache& operator=(const DiskCache&);
+
+// Public interface
+public:
+    /**
+     * This is the creator method for creating DiskCache instances, use
+     * this method instead of the constructor. The directories are created
+     * if they don't exist. It doesn't take the ownership of the handler,
+     * and the variable list of the handler must be set before.
+     *
+     * \param handler The ModuleHandler used to compile the trees.
+     * \param directory The cache directory.
+     * \param error_string Error message in case of error.
+     * \param kernel_type The type of the cached functions.
+     * \return A new DiskCache instance in case of success, otherwise
+     *         NULL and the error message on the error_string parameter.
+     */
+    static DiskCache *create(ModuleHandler *handler,
+                             const std::string &directory,
+                             std::string &error_string,
+                             ModuleHandler::KernelType kernel_type=ModuleHandler::KERNEL_SCALAR);
+
+    /**
+     * Returns the JITed function of the tree. If the tree is in the
+     * cache directory, its bitcode is linked into the module, otherwise
+     * the tree is compiled and its bitcode is stored. The function can
+     * be free'd using ModuleHandler::free_jit_memory().
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name, it must not exist in the module.
+     * \return The function pointer of the JITed function.
+     */
+    void *get_function(const std::vector<ASTNode*> *ast_nodes,
+                       const std::string &func_name);
+
+    /**
+     * Returns the cache subdirectory of the handler.
+     *
+     * \return The cache subdirectory.
+     */
+    const std::string &get_directory() const
+    { return mDirectory; }
+
+    /**
+     * Returns the number of trees loaded from the cache.
+     *
+     * \return The number of hits.
+     */
+    unsigned long get_hits() const
+    { return mHits; }
+
+    /**
+     * Returns the number of trees compiled.
+     *
+     * \return The number of misses.
+     */
+    unsigned long get_misses() const
+    { return mMisses; }
+
+    /**
+     * Returns the number of trees compiled but not stored, because
+     * their functions call internal functions (such as the shared
+     * subtree helpers), see ModuleHandler::get_function_bitcode(),
+     * or because the entry couldn't be written.
+     *
+     * \return The number of trees not stored.
+     */
+    unsigned long get_unstored() const
+    { return mUnstored; }
+
+    /**
+     * Resets the counters.
+     */
+    void reset_counters()
+    { mHits = mMisses = mUnstored = 0; }
+
+// Private interface
+private:
+    /**
+     * Loads the function of the tree from the cache.
+     *
+     * \param path The path of the entry, without extension.
+     * \param key The structural key of the tree.
+     * \param func_name The function name.
+     * \return The linked function, or NULL if not found.
+     */
+    llvm::Function *load_function(const std::string &path,
+                                  const std::string &key,
+                                  const std::string &func_name);
+
+    /**
+     * Stores the function of the tree in the cache.
+     *
+     * \param path The path of the entry, without extension.
+     * \param key The structural key of the tree.
+     * \param func_name The function name.
+     * \return true if stored, false otherwise.
+     */
+    bool store_function(const std::string &path,
+                        const std::string &key,
+                        const std::string &func_name);
+
+private:
+    /**
+     * The ModuleHandler used to compile the trees.
+     */
+    ModuleHandler *mHandler;
+
+    /**
+     * The cache subdirectory of the handler.
+     */
+    std::string mDirectory;
+
+    /**
+     * The type of the cached functions.
+     */
+    ModuleHandler::KernelType mKernelType;
+
+    /**
+     * The number of hits.
+     */
+    unsigned long mHits;
+
+    /**
+     * The number of misses.
+     */
+    unsigned long mMisses;
+
+    /**
+     * The number of trees not stored.
+     */
+    unsigned long mUnstored;
+};
+
+} // namespace shine
+
+#endif // DISKCACHE_H
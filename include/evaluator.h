@@ -0,0 +1,162 @@
+/**
+ * \file evaluator.h
+ * This file defines and implement the Evaluator related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <vector>
+#include <cstddef>
+
+#include "modulehandler.h"
+
+namespace shine
+{
+
+class ThreadPool;
+
+/**
+ * This class evaluates JITed kernels over a dataset using a persistent
+ * pool of threads. The dataset rows are partitioned in chunks (which
+ * should fit in the cache) and the chunks are distributed over the
+ * threads, the fitness errors are reduced per thread and then combined.
+ *
+ * The dataset is given as columns, one column for each variable in the
+ * same order of the ModuleHandler variable list.
+ */
+class Evaluator
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates the evaluator and starts its threads.
+     *
+     * \param num_threads The number of threads.
+     * \param chunk_size The number of rows of each chunk.
+     */
+    Evaluator(unsigned int num_threads, size_t chunk_size=4096);
+    virtual ~Evaluator();
+
+// Not implemented copy/assign
+private:
+    Evaluator(const Evaluator&);
+    Evaluator& operator=(const Evaluator&);
+
+// Public interface
+public:
+    /**
+     * Batch kernel prototype, see ModuleHandler::codegen_ast_batch().
+     */
+    typedef void (*BatchKernel)(const double* const* columns, double *out, size_t n);
+
+    /**
+     * Fitness kernel prototype, see ModuleHandler::codegen_ast_fitness().
+     */
+    typedef double (*FitnessKernel)(const double* const* columns, const double *target, size_t n);
+
+    /**
+     * Evaluates a batch kernel over the dataset in parallel.
+     *
+     * \param batch_kernel The JITed batch kernel (or vectorized kernel).
+     * \param columns The dataset columns.
+     * \param n The number of rows.
+     * \param out The output, it must have room for \p n results.
+     */
+    void evaluate(void *batch_kernel,
+                  const std::vector<const double*> &columns,
+                  size_t n, double *out);
+
+    /**
+     * Evaluates a fitness kernel over the dataset in parallel.
+     *
+     * \param fitness_kernel The JITed fitness kernel.
+     * \param columns The dataset columns.
+     * \param target The target column.
+     * \param n The number of rows.
+     * \param metric The metric used when the kernel was generated, it
+     *               is used to combine the errors of the chunks.
+     * \return The error over the entire dataset.
+     */
+    double evaluate_fitness(void *fitness_kernel,
+                            const std::vector<const double*> &columns,
+                            const double *target, size_t n,
+                            ModuleHandler::FitnessMetric metric);
+
+    /**
+     * Evaluates a set of fitness kernels (a population for example)
+     * over the dataset, the chunks of all the kernels are distributed
+     * over the threads.
+     *
+     * \param fitness_kernels The JITed fitness kernels.
+     * \param columns The dataset columns.
+     * \param target The target column.
+     * \param n The number of rows.
+     * \param metric The metric used when the kernels were generated.
+     * \return The error of each kernel.
+     */
+    std::vector<double> evaluate_fitness(const std::vector<void*> &fitness_kernels,
+                                         const std::vector<const double*> &columns,
+                                         const double *target, size_t n,
+                                         ModuleHandler::FitnessMetric metric);
+
+    /**
+     * Sets the number of rows of each chunk.
+     *
+     * \param chunk_size The number of rows.
+     */
+    void set_chunk_size(size_t chunk_size)
+    {
+        assert(chunk_size>0);
+        mChunkSize = chunk_size;
+    }
+
+    /**
+     * Returns the number of rows of each chunk.
+     *
+     * \return The number of rows.
+     */
+    size_t get_chunk_size() const
+    { return mChunkSize; }
+
+    /**
+     * Returns the number of threads.
+     *
+     * \return The number of threads.
+     */
+    unsigned int get_num_threads() const;
+
+private:
+    /**
+     * The evaluation threads.
+     */
+    ThreadPool *mThreadPool;
+
+    /**
+     * The number of rows of each chunk.
+     */
+    size_t mChunkSize;
+};
+
+} // namespace shine
+
+#endif // EVALUATOR_H
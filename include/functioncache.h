@@ -0,0 +1,232 @@
+/**
+ * \file functioncache.h
+ * This file defines and implement the FunctionCache related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef FUNCTIONCACHE_H
+#define FUNCTIONCACHE_H
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+
+#include <stdint.h>
+
+#include "modulehandler.h"
+
+namespace tr1impl = std::tr1;
+
+namespace shine
+{
+
+class ASTNode;
+
+/**
+ * This class caches the JITed functions of a ModuleHandler using the
+ * structural hash of the trees, so structurally identical trees (clones
+ * from reproduction for example) are compiled only once. The functions
+ * are only reused with the handler settings they were compiled with:
+ * the variable list, the precision, the profile and the forced inlining.
+ */
+class FunctionCache
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates a cache for the ModuleHandler, it doesn't take the
+     * ownership of the handler.
+     *
+     * \param handler The ModuleHandler used to compile the trees.
+     * \param kernel_type The type of the cached functions.
+     */
+    FunctionCache(ModuleHandler *handler,
+                  ModuleHandler::KernelType kernel_type=ModuleHandler::KERNEL_SCALAR);
+    virtual ~FunctionCache() {};
+
+// Not implemented copy/assign
+private:
+    FunctionCache(const FunctionCache&);
+    FunctionCache& operator=(const FunctionCache&);
+
+// Public interface
+public:
+    /**
+     * Returns the JITed function of the tree, the tree is compiled
+     * only if no structurally identical tree is in the cache.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \return The function pointer of the JITed function.
+     */
+    void *get_function(const std::vector<ASTNode*> *ast_nodes);
+
+    /**
+     * Returns the JITed functions of the population, only the trees
+     * which aren't in the cache (and aren't duplicated inside the
+     * population) are compiled, using ModuleHandler::compile_population().
+     *
+     * \param population The AST Trees of the population.
+     * \return The function pointers, in the same order of the population.
+     */
+    std::vector<void*> compile_population(const std::vector<std::vector<ASTNode*> > &population);
+
+    /**
+     * Removes all the functions from the cache and frees
+     * their JIT memory.
+     */
+    void clear();
+
+    /**
+     * Returns the number of cached functions.
+     *
+     * \return The number of cached functions.
+     */
+    unsigned int size() const
+    { return mNumEntries; }
+
+    /**
+     * Returns the number of lookups found in the cache.
+     *
+     * \return The number of hits.
+     */
+    unsigned long get_hits() const
+    { return mHits; }
+
+    /**
+     * Returns the number of lookups not found in the cache,
+     * which is the number of compiled trees.
+     *
+     * \return The number of misses.
+     */
+    unsigned long get_misses() const
+    { return mMisses; }
+
+    /**
+     * Resets the hit/miss counters.
+     */
+    void reset_counters()
+    { mHits = mMisses = 0; }
+
+// Private interface
+private:
+    /**
+     * A cached function.
+     */
+    struct CacheEntry
+    {
+        /**
+         * The structural key of the tree, used to
+         * resolve hash collisions.
+         */
+        std::string key;
+
+        /**
+         * The handler context of the function, an index in mContexts.
+         */
+        unsigned int context;
+
+        /**
+         * The name of the function in the module.
+         */
+        std::string func_name;
+
+        /**
+         * The JITed function.
+         */
+        void *function;
+    };
+
+    /**
+     * Finds the entry of the tree in the cache, the structural key of
+     * the tree is only built if there are entries with its hash.
+     *
+     * \param hash The structural hash of the tree.
+     * \param context The handler context, see get_context().
+     * \param ast_nodes The AST Tree.
+     * \param key The structural key of the tree, built if empty.
+     * \return The entry, or NULL if not found.
+     */
+    CacheEntry *find_entry(uint64_t hash, unsigned int context,
+                           const std::vector<ASTNode*> *ast_nodes,
+                           std::string &key);
+
+    /**
+     * Returns the current context of the handler, the settings which
+     * change the prototype or the code of the compiled functions.
+     *
+     * \return The index of the context in mContexts.
+     */
+    unsigned int get_context();
+
+    /**
+     * Inserts a new entry in the cache.
+     *
+     * \param hash The structural hash of the tree.
+     * \param entry The entry.
+     */
+    void insert_entry(uint64_t hash, const CacheEntry &entry);
+
+private:
+    /**
+     * The ModuleHandler used to compile the trees.
+     */
+    ModuleHandler *mHandler;
+
+    /**
+     * The type of the cached functions.
+     */
+    ModuleHandler::KernelType mKernelType;
+
+    /**
+     * This typedef declares a hash map from structural hash to the
+     * entries with that hash.
+     */
+    typedef tr1impl::unordered_map<uint64_t, std::vector<CacheEntry> > CacheMap;
+
+    /**
+     * The hash map from structural hash to the entries with that hash.
+     */
+    CacheMap mCache;
+
+    /**
+     * The handler contexts of the cached functions.
+     */
+    std::vector<std::string> mContexts;
+
+    /**
+     * The number of cached functions.
+     */
+    unsigned int mNumEntries;
+
+    /**
+     * The number of hits.
+     */
+    unsigned long mHits;
+
+    /**
+     * The number of misses.
+     */
+    unsigned long mMisses;
+};
+
+} // namespace shine
+
+#endif // FUNCTIONCACHE_H
@@ -0,0 +1,197 @@
+/**
+ * \file interpreter.h
+ * This file defines and implement the Interpreter related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <tr1/unordered_map>
+
+namespace tr1impl = std::tr1;
+
+namespace shine
+{
+
+class ModuleHandler;
+class ASTNode;
+
+/**
+ * This class evaluates the pre-order ASTs without generating code,
+ * the primitives are called through the function pointers JITed by
+ * the ModuleHandler. It is useful for the trees evaluated only a few
+ * times, when the code generation would cost more than the evaluation.
+ */
+class Interpreter
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates an interpreter for the ModuleHandler, the variables are
+     * looked up in the handler variable list when each tree is evaluated.
+     * It doesn't take the ownership of the handler.
+     *
+     * \param handler The ModuleHandler with the primitives.
+     */
+    Interpreter(ModuleHandler *handler);
+    virtual ~Interpreter() {};
+
+// Not implemented copy/assign
+private:
+    Interpreter(const Interpreter&);
+    Interpreter& operator=(const Interpreter&);
+
+// Public interface
+public:
+    /**
+     * Evaluates the AST for a single row.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param row The variable values, in the same order of the variable list.
+     * \param value Receives the value of the tree.
+     * \param error_string The error string.
+     * \return true on success, false if a variable or a primitive isn't found.
+     */
+    bool evaluate(const std::vector<ASTNode*> *ast_nodes,
+                  const double *row, double &value,
+                  std::string &error_string);
+
+    /**
+     * Evaluates the AST over the dataset, with the same parameters of
+     * the kernels generated by ModuleHandler::codegen_ast_batch().
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param columns The dataset columns, one for each variable.
+     * \param out The output, it must have room for \p n results.
+     * \param n The number of rows.
+     * \param error_string The error string.
+     * \return true on success, false if a variable or a primitive isn't found.
+     */
+    bool evaluate_batch(const std::vector<ASTNode*> *ast_nodes,
+                        const double* const* columns,
+                        double *out, size_t n,
+                        std::string &error_string);
+
+// Public static interface
+public:
+    /**
+     * The maximum number of arguments of the primitives.
+     */
+    static const unsigned int MAX_ARG_SIZE = 8;
+
+    /**
+     * Calls a double closure primitive through its function pointer.
+     *
+     * \param function The primitive function pointer.
+     * \param arg_size The number of arguments.
+     * \param args The arguments.
+     * \return The primitive result.
+     */
+    static double call_primitive(void *function, unsigned int arg_size,
+                                 const double *args);
+
+// Private interface
+private:
+    /**
+     * A resolved AST node, the trees are resolved once
+     * for each evaluate_batch() call.
+     */
+    struct Operation
+    {
+        /**
+         * The ASTNode::ASTNodeType of the node.
+         */
+        int type;
+
+        /**
+         * The variable index or the primitive number of arguments.
+         */
+        unsigned int index;
+
+        /**
+         * The constant value.
+         */
+        double value;
+
+        /**
+         * The primitive function pointer.
+         */
+        void *function;
+    };
+
+    /**
+     * Resolves the AST nodes into operations, in the
+     * evaluation order (the reverse pre-order).
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param operations The resolved operations.
+     * \param error_string The error string.
+     * \return true on success, false if a variable or a primitive isn't found.
+     */
+    bool resolve(const std::vector<ASTNode*> *ast_nodes,
+                 std::vector<Operation> &operations,
+                 std::string &error_string);
+
+    /**
+     * Evaluates the resolved operations for a row.
+     *
+     * \param operations The resolved operations.
+     * \param values The value of each variable.
+     * \param stack The evaluation stack, reused between rows.
+     * \return The value of the tree.
+     */
+    static double run(const std::vector<Operation> &operations,
+                      const double *values,
+                      std::vector<double> &stack);
+
+private:
+    /**
+     * The ModuleHandler with the primitives.
+     */
+    ModuleHandler *mHandler;
+
+    /**
+     * A JITed primitive.
+     */
+    struct Primitive
+    {
+        void *function;
+        unsigned int arg_size;
+    };
+
+    /**
+     * This typedef declares a hash map from primitive name to its function pointer.
+     */
+    typedef tr1impl::unordered_map<std::string, Primitive> PrimitiveMap;
+
+    /**
+     * The hash map from primitive name to its function pointer.
+     */
+    PrimitiveMap mPrimitives;
+};
+
+} // namespace shine
+
+#endif // INTERPRETER_H
@@ -29,6 +29,10 @@
 #include <vector>
 #include <map>
 #include <tr1/unordered_map>
+#include <tr1/unordered_set>
+#include <cstddef>
+
+#include <stdint.h>
 
 #include <llvm/PassManager.h>
 
@@ -40,6 +44,11 @@ namespace llvm
     class Linker;
     class ExecutionEngine;
     class Value;
+    class BasicBlock;
+    class Function;
+    class JITEventListener;
+    class LLVMContext;
+    class Type;
 }
 
 namespace shine
@@ -47,6 +56,10 @@ namespace shine
 
 class ModuleLinker;
 class ASTNode;
+class ASTVariable;
+class ASTFunction;
+class ASTArena;
+struct FlatTree;
 
 /**
  * This class takes the ModuleLinker ownership and perform
@@ -78,6 +91,119 @@ private:
 
 // Public interface
 public:
+    /**
+     * Error metrics used by the fitness kernels.
+     * \see ModuleHandler::codegen_ast_fitness
+     */
+    enum FitnessMetric
+    {
+        FITNESS_SSE,     /**< Sum of squared errors */
+        FITNESS_MSE,     /**< Mean squared error */
+        FITNESS_MAE,     /**< Mean absolute error */
+        FITNESS_MAX_ABS  /**< Maximum absolute error */
+    };
+
+    /**
+     * Kernel types generated by the population compilation.
+     * \see ModuleHandler::compile_population
+     */
+    enum KernelType
+    {
+        KERNEL_SCALAR, /**< Functions generated by codegen_ast() */
+        KERNEL_BATCH   /**< Kernels generated by codegen_ast_batch() */
+    };
+
+    /**
+     * Floating-point precisions of the generated functions.
+     * \see ModuleHandler::set_precision
+     */
+    enum Precision
+    {
+        PRECISION_DOUBLE, /**< double data and arithmetic */
+        PRECISION_SINGLE, /**< float data and arithmetic */
+        PRECISION_MIXED   /**< float data, double arithmetic and results */
+    };
+
+    /**
+     * Optimization profiles, trading the compile latency for the
+     * quality of the generated code. The function passes can be
+     * selected for each compilation, but the native code generation
+     * level is fixed when the handler is created.
+     * \see ModuleHandler::create
+     */
+    enum OptimizationProfile
+    {
+        PROFILE_DEFAULT,        /**< The profile of the handler */
+        PROFILE_FAST_COMPILE,   /**< Minimal passes and no codegen optimization */
+        PROFILE_BALANCED,       /**< Standard passes and default codegen */
+        PROFILE_MAX_THROUGHPUT  /**< Full passes and aggressive codegen */
+    };
+
+    /**
+     * The times measured by measure_profile().
+     */
+    struct ProfileMeasure
+    {
+        /**
+         * The time of the function passes and the
+         * native code generation, in seconds.
+         */
+        double compile_time;
+
+        /**
+         * The time of one evaluation over the dataset, in seconds.
+         */
+        double evaluation_time;
+    };
+
+    /**
+     * The statistics of a generated function.
+     * \see ModuleHandler::get_function_stats
+     */
+    struct FunctionStats
+    {
+        FunctionStats()
+        : codegen_time(0.0), function_passes_time(0.0), jit_time(0.0),
+          instructions_before(0), instructions_after(0),
+          machine_code_bytes(0) {};
+
+        double codegen_time;               /**< IR generation, in seconds */
+        double function_passes_time;       /**< Function passes, in seconds */
+        double jit_time;                   /**< Native code generation, in seconds */
+        unsigned long instructions_before; /**< IR instructions generated */
+        unsigned long instructions_after;  /**< IR instructions after the function passes */
+        unsigned long machine_code_bytes;  /**< Machine code emitted */
+    };
+
+    /**
+     * The cumulative statistics of the compile pipeline, since
+     * the handler creation or the last reset_compile_stats().
+     * \see ModuleHandler::get_compile_stats
+     */
+    struct CompileStats
+    {
+        CompileStats()
+        : codegen_time(0.0), function_passes_time(0.0),
+          module_passes_time(0.0), jit_time(0.0),
+          generated_functions(0), optimized_functions(0), jit_functions(0),
+          instructions_before(0), instructions_after(0),
+          machine_code_bytes(0), live_functions(0),
+          live_machine_code_bytes(0) {};
+
+        double codegen_time;                   /**< IR generation, in seconds */
+        double function_passes_time;           /**< Function passes, in seconds */
+        double module_passes_time;             /**< Module passes, in seconds */
+        double jit_time;                       /**< Native code generation, in seconds */
+        unsigned long generated_functions;     /**< Functions generated */
+        unsigned long optimized_functions;     /**< Functions optimized by the function passes */
+        unsigned long jit_functions;           /**< Functions JITed */
+        unsigned long instructions_before;     /**< IR instructions generated */
+        unsigned long instructions_after;      /**< IR instructions after the function passes */
+        unsigned long machine_code_bytes;      /**< Machine code emitted, including the primitives */
+        unsigned long live_functions;          /**< JITed functions not free'd */
+        unsigned long live_machine_code_bytes; /**< Machine code not free'd */
+    };
+
     /**
      * This is the creator method for creating ModuleHandler instances,
      * use this method instead of the constructor.
@@ -89,17 +215,83 @@ public:
      * \param func_pass_manager This is optional, if you do not want to provide a
      *                          Function Pass Manager, ModuleHandler will create
      *                          it for you.
+     * \param profile The optimization profile of the handler, it selects the
+     *                native code generation level and the passes created.
      * \return A new ModuleHandler instance in case of success, otherwise
      *         NULL and the error message on the error_string parameter.
      */
     static ModuleHandler *create(llvm::Module *module,
                                  std::string &error_string,
                                  llvm::PassManager *pass_manager=NULL,
-                                 llvm::FunctionPassManager *func_pass_manager=NULL);
+                                 llvm::FunctionPassManager *func_pass_manager=NULL,
+                                 OptimizationProfile profile=PROFILE_MAX_THROUGHPUT);
+
+    /**
+     * This is the creator method for creating ModuleHandler instances
+     * from a snapshot written by save_snapshot(). The snapshot is lazily
+     * loaded (see ModuleLoader::create_from_file()), and the handler is
+     * created with the profile of the saved handler, so neither the
+     * linking, the closure checking nor the module passes are needed.
+     *
+     * \param filename The snapshot file.
+     * \param error_string Error message in case of error.
+     * \param context The LLVM context of the module, if NULL the
+     *                LLVM global context is used.
+     * \return A new ModuleHandler instance in case of success, otherwise
+     *         NULL and the error message on the error_string parameter.
+     */
+    static ModuleHandler *create_from_snapshot(const std::string &filename,
+                                               std::string &error_string,
+                                               llvm::LLVMContext *context=NULL);
+
+    /**
+     * Writes a snapshot of the module, to create handlers using
+     * create_from_snapshot(). The snapshot has the primitives, as
+     * optimized by run_module_passes() if it was called, the primitive
+     * symbol table and the profile of the handler. The generated
+     * functions aren't saved, it fails if one of them is still used
+     * outside of the generated functions.
+     *
+     * \param filename The snapshot file.
+     * \param error_string Error message in case of error.
+     * \return true on success, false otherwise.
+     */
+    bool save_snapshot(const std::string &filename,
+                       std::string &error_string);
+
+    /**
+     * Returns the name of the profile ("fast-compile",
+     * "balanced" or "max-throughput").
+     *
+     * \param profile The optimization profile.
+     * \return The profile name.
+     */
+    static const char *get_profile_name(OptimizationProfile profile);
+
+    /**
+     * Parses the name of a profile, see get_profile_name().
+     *
+     * \param name The profile name.
+     * \param profile Receives the optimization profile.
+     * \return true if the name is valid, false otherwise.
+     */
+    static bool parse_profile_name(const std::string &name,
+                                   OptimizationProfile &profile);
+
+    /**
+     * Returns the optimization profile of the handler.
+     *
+     * \return The optimization profile.
+     */
+    OptimizationProfile get_profile() const
+    { return mProfile; }
 
     /**
      * Run the optimization passes into the composite
-     * linker module.
+     * linker module. The interprocedural passes need every body,
+     * so the bodies of a lazily loaded module are read first, and
+     * the passes aren't run if one of them can't be read (see
+     * get_materialize_error()).
      *
      * \return true if module was modified, false otherwise.
      */
@@ -114,6 +306,34 @@ public:
      */
     bool run_function_passes(const std::string &func_name);
 
+    /**
+     * Run the function optimization passes of a profile into the
+     * specified function.
+     *
+     * \param func_name The function name.
+     * \param profile The optimization profile.
+     * \return true if Function was modified, false otherwise.
+     */
+    bool run_function_passes(const std::string &func_name,
+                             OptimizationProfile profile);
+
+    /**
+     * Measures the compile time and the evaluation time of the batch
+     * kernel of a tree with the function passes of a profile, it is
+     * useful to choose the profile for the trees of a given size. The
+     * native code generation level is always the one of the handler,
+     * and the measured kernel is removed from the module.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param profile The optimization profile.
+     * \param columns The dataset columns, one for each variable.
+     * \param n The number of rows.
+     * \return The measured times, zero if the kernel can't be generated.
+     */
+    ProfileMeasure measure_profile(const std::vector<ASTNode*> *ast_nodes,
+                                   OptimizationProfile profile,
+                                   const double* const* columns, size_t n);
+
     /**
      * This method will dump the function LLVM IR code to a
      * string.
@@ -137,13 +357,436 @@ public:
     void print_module(std::ostream &stream);
 
     /**
-     * This method will generate LLVM IR code for your AST tree.
+     * This method will generate LLVM IR code for your AST tree. Its
+     * prototype depends on the precision, see set_precision().
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name.
+     * \return The generated function.
+     */
+    llvm::Function *codegen_ast(const std::vector<ASTNode*> *ast_nodes,
+                                const std::string &func_name);
+
+    /**
+     * This method will generate LLVM IR code for a tree stored in an
+     * ASTArena, the generated function is the same of the codegen_ast()
+     * for the ASTNode trees, but the nodes are read without virtual calls
+     * and each symbol of the arena is resolved only once. The subtree
+     * sharing isn't applied to these trees.
+     *
+     * \param arena The arena of the tree.
+     * \param tree Your AST Tree.
+     * \param func_name The function name.
+     * \return The generated function.
+     */
+    llvm::Function *codegen_ast(const ASTArena *arena, const FlatTree &tree,
+                                const std::string &func_name);
+
+    /**
+     * This method will generate a batch kernel for your AST tree. Instead
+     * of a function evaluating a single row, the generated function loops
+     * over the entire dataset, its prototype is:
+     *
+     * \code
+     * void func_name(const double* const* columns, double *out, size_t n);
+     * \endcode
+     *
+     * Where \p columns has one column for each variable (in the same order
+     * of the variable list), and \p out receives the \p n results. The
+     * types depend on the precision, see set_precision().
      *
      * \param ast_nodes Your AST Tree.
      * \param func_name The function name.
+     * \return The generated function.
      */
-    void codegen_ast(const std::vector<ASTNode*> *ast_nodes,
-                     const std::string &func_name);
+    llvm::Function *codegen_ast_batch(const std::vector<ASTNode*> *ast_nodes,
+                                      const std::string &func_name);
+
+    /**
+     * This method will generate a vectorized batch kernel for your AST
+     * tree, it has the same prototype of the kernel generated by
+     * codegen_ast_batch(), but evaluates \p vector_width rows per loop
+     * iteration using LLVM vector types (\p <4 x double> for example).
+     * The remaining rows are evaluated by a scalar loop.
+     *
+     * For every function node, a vector variant of the function named
+     * with the \p _v\<width\> suffix is used if present in the module
+     * (e.g. \p F_v4 for the function \p F and width 4), otherwise the
+     * scalar function is called for each vector lane. The vector kernels
+     * are only generated in double precision.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name.
+     * \param vector_width The number of rows per iteration, it must be
+     *                     a power of two.
+     * \return The generated function.
+     */
+    llvm::Function *codegen_ast_vector(const std::vector<ASTNode*> *ast_nodes,
+                                       const std::string &func_name,
+                                       unsigned int vector_width);
+
+    /**
+     * This method will generate a fitness kernel for your AST tree, the
+     * tree evaluation, the residual against the target column and the
+     * error reduction are fused into a single loop over the dataset,
+     * so no predictions are stored. Its prototype is:
+     *
+     * \code
+     * double func_name(const double* const* columns, const double *target, size_t n);
+     * \endcode
+     *
+     * The kernel returns 0 for an empty dataset, NaN results of the
+     * tree are propagated to the returned error. The types depend on
+     * the precision, see set_precision(), the error is accumulated in
+     * the type of the result.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name.
+     * \param metric The error metric.
+     * \return The generated function.
+     */
+    llvm::Function *codegen_ast_fitness(const std::vector<ASTNode*> *ast_nodes,
+                                        const std::string &func_name,
+                                        FitnessMetric metric);
+
+    /**
+     * This method will generate LLVM IR code for your AST tree, with
+     * the constants loaded from a parameter array instead of being
+     * embedded in the code, so the same function is evaluated with
+     * other constants without being generated again. The prototypes
+     * are the ones of codegen_ast() and codegen_ast_batch() with a
+     * trailing parameter array:
+     *
+     * \code
+     * double func_name(double var1, ..., double varN, const double *params);
+     * void func_name(const double* const* columns, double *out, size_t n,
+     *                const double *params);
+     * \endcode
+     *
+     * The subtree sharing isn't used for these functions. The parameter
+     * array has the type of the result, see set_precision().
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name.
+     * \param param_layout Receives the parameter layout, see get_parameter_layout().
+     * \param kernel_type KERNEL_SCALAR or KERNEL_BATCH.
+     * \return The generated function.
+     */
+    llvm::Function *codegen_ast_params(const std::vector<ASTNode*> *ast_nodes,
+                                       const std::string &func_name,
+                                       std::vector<unsigned int> &param_layout,
+                                       KernelType kernel_type=KERNEL_SCALAR);
+
+    /**
+     * Returns the parameter layout of the tree: the parameter i is the
+     * constant of the node param_layout[i], in pre-order.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param param_layout Receives the node index of each parameter.
+     */
+    static void get_parameter_layout(const std::vector<ASTNode*> *ast_nodes,
+                                     std::vector<unsigned int> &param_layout);
+
+    /**
+     * Reads the constants of the tree into a parameter array.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param param_layout The parameter layout of the tree.
+     * \param params Receives the parameters.
+     */
+    static void get_parameter_values(const std::vector<ASTNode*> *ast_nodes,
+                                     const std::vector<unsigned int> &param_layout,
+                                     std::vector<double> &params);
+
+    /**
+     * Writes a parameter array into the constants of the tree, for
+     * example to keep the best parameters found.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param param_layout The parameter layout of the tree.
+     * \param params The parameters.
+     */
+    static void set_parameter_values(const std::vector<ASTNode*> *ast_nodes,
+                                     const std::vector<unsigned int> &param_layout,
+                                     const double *params);
+
+    /**
+     * This method will generate a function computing the value of your
+     * AST tree and its gradient, by reverse-mode differentiation. The
+     * constants are parameters (see codegen_ast_params()) and its
+     * prototype is:
+     *
+     * \code
+     * double func_name(double var1, ..., double varN, const double *params,
+     *                  double *grad);
+     * \endcode
+     *
+     * The gradient has the partial derivatives of the parameters first,
+     * in the parameter layout order, then the partial derivatives of the
+     * variables, in the variable list order. The partial derivatives of
+     * each primitive F with K arguments are primitives of the module too,
+     * named d_F_0 to d_F_(K-1) (see get_derivative_name()), with the same
+     * arguments as F. The gradients are only generated in double precision.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name.
+     * \param param_layout Receives the parameter layout, see get_parameter_layout().
+     * \param error_string Error message in case of error.
+     * \return The generated function, or NULL if a derivative is missing.
+     */
+    llvm::Function *codegen_ast_gradient(const std::vector<ASTNode*> *ast_nodes,
+                                         const std::string &func_name,
+                                         std::vector<unsigned int> &param_layout,
+                                         std::string &error_string);
+
+    /**
+     * This method will generate a fitness kernel computing the sum of
+     * the squared errors of your AST tree and its gradient with respect
+     * to the parameters, in a single loop over the dataset. Its prototype is:
+     *
+     * \code
+     * double func_name(const double* const* columns, const double *target, size_t n,
+     *                  const double *params, double *grad);
+     * \endcode
+     *
+     * The gradient has the partial derivatives of the parameters, in the
+     * parameter layout order. See codegen_ast_gradient() for the derivative
+     * primitives.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name.
+     * \param param_layout Receives the parameter layout, see get_parameter_layout().
+     * \param error_string Error message in case of error.
+     * \return The generated function, or NULL if a derivative is missing.
+     */
+    llvm::Function *codegen_ast_fitness_gradient(const std::vector<ASTNode*> *ast_nodes,
+                                                 const std::string &func_name,
+                                                 std::vector<unsigned int> &param_layout,
+                                                 std::string &error_string);
+
+    /**
+     * Returns the name of the primitive with the partial derivative
+     * of a primitive with respect to one of its arguments.
+     *
+     * \param func_name The primitive name.
+     * \param arg_index The argument index.
+     * \return The derivative primitive name (d_<func_name>_<arg_index>).
+     */
+    static std::string get_derivative_name(const std::string &func_name,
+                                           unsigned int arg_index);
+
+    /**
+     * This method will generate a function computing the bounds of your
+     * AST tree over intervals of the variables, using interval arithmetic,
+     * so the trees that may produce NaN, infinite or absurd values over
+     * the input domain are found without evaluating them on the dataset.
+     * Its prototype is:
+     *
+     * \code
+     * void func_name(const double *var_lo, const double *var_hi, double *bounds);
+     * \endcode
+     *
+     * The variable intervals are in the order of the variable list, and
+     * the bounds receive the lower bound of the tree followed by its upper
+     * bound. Each primitive F with K arguments must have two interval
+     * primitives in the module, F_lo and F_hi (see get_interval_name()),
+     * returning the lower and the upper bound of F over the intervals of
+     * its arguments, with 2K arguments: the lower and the upper bound of
+     * each argument, in turn. The bounds are only generated in double
+     * precision.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param func_name The function name.
+     * \param error_string Error message in case of error.
+     * \return The generated function, or NULL if an interval primitive is missing.
+     */
+    llvm::Function *codegen_ast_interval(const std::vector<ASTNode*> *ast_nodes,
+                                         const std::string &func_name,
+                                         std::string &error_string);
+
+    /**
+     * Returns the name of the interval primitive of a primitive.
+     *
+     * \param func_name The primitive name.
+     * \param upper true for the upper bound, false for the lower bound.
+     * \return The interval primitive name (<func_name>_lo or <func_name>_hi).
+     */
+    static std::string get_interval_name(const std::string &func_name,
+                                         bool upper);
+
+    /**
+     * This method compiles an entire population at once, all the trees
+     * are generated into the module, then the function passes are run
+     * over all of them in one sweep and finally the native code is
+     * emitted for each function. This avoids the fixed overhead of
+     * calling codegen_ast(), run_function_passes() and jit_function()
+     * for each individual.
+     *
+     * The functions are named with the prefix followed by the index of
+     * the individual, and can be free'd using free_jit_memory(). The
+     * population isn't compiled if one of these names is already used
+     * by a function of the module.
+     *
+     * \param population The AST Trees of the population.
+     * \param name_prefix The prefix of the function names.
+     * \param kernel_type The type of the generated functions.
+     * \param profile The optimization profile of the function passes.
+     * \return The function pointers, in the same order of the population,
+     *         NULL for the individuals which couldn't be generated (all
+     *         of them if the prefix is already in use).
+     */
+    std::vector<void*> compile_population(const std::vector<std::vector<ASTNode*> > &population,
+                                          const std::string &name_prefix,
+                                          KernelType kernel_type=KERNEL_SCALAR,
+                                          OptimizationProfile profile=PROFILE_DEFAULT);
+
+    /**
+     * Returns the cumulative statistics of the compile pipeline: the
+     * time of each phase (codegen, function passes, module passes and
+     * JIT), the number of IR instructions before and after the function
+     * passes, and the machine code emitted and still alive.
+     *
+     * \return The compile statistics.
+     */
+    CompileStats get_compile_stats() const;
+
+    /**
+     * Returns the statistics of a generated function.
+     *
+     * \param func_name The function name.
+     * \param stats Receives the function statistics.
+     * \return true if the function was found, false otherwise.
+     */
+    bool get_function_stats(const std::string &func_name,
+                            FunctionStats &stats) const;
+
+    /**
+     * Resets the cumulative and the per function statistics, the
+     * live functions and machine code are kept.
+     */
+    void reset_compile_stats();
+
+    /**
+     * Dumps the compile statistics as a JSON object into the stream.
+     *
+     * \param stream The output stream.
+     * \param function_stats true to include the statistics of
+     *                       each function.
+     */
+    void print_compile_stats(std::ostream &stream, bool function_stats=true) const;
+
+    /**
+     * Enables or disables the subtree sharing of compile_population().
+     * When enabled, the subtrees repeated across the individuals of the
+     * population are generated only once, as internal helper functions
+     * called by the individuals. The helpers are kept in the module, so
+     * the next generations also reuse them.
+     *
+     * \param enable true to enable the subtree sharing.
+     */
+    void set_subtree_sharing(bool enable)
+    { mSubtreeSharing = enable; }
+
+    /**
+     * Returns true if the subtree sharing is enabled.
+     *
+     * \return true if the subtree sharing is enabled.
+     */
+    bool get_subtree_sharing() const
+    { return mSubtreeSharing; }
+
+    /**
+     * Enables or disables the forced inlining of the primitives. When
+     * enabled, the function passes are preceded by the inlining of every
+     * call to a primitive defined in the module (and of the primitives
+     * they call), whatever the LLVM inlining heuristics, so the passes
+     * optimize the whole expression and the machine code has no calls
+     * to the primitives. The external functions, the recursive primitives
+     * and the shared subtree helpers are still called.
+     *
+     * \param enable true to enable the forced inlining.
+     */
+    void set_force_inline(bool enable)
+    { mForceInline = enable; }
+
+    /**
+     * Returns true if the forced inlining is enabled.
+     *
+     * \return true if the forced inlining is enabled.
+     */
+    bool get_force_inline() const
+    { return mForceInline; }
+
+    /**
+     * Sets the floating-point precision of the functions generated by
+     * codegen_ast(), codegen_ast_batch(), codegen_ast_fitness(),
+     * codegen_ast_params() and compile_population(). The data are the
+     * variables, the columns and the target, the results are the
+     * returned values, the \p out array and the parameters:
+     *
+     * \code
+     * PRECISION_DOUBLE: double data, double arithmetic, double results
+     * PRECISION_SINGLE: float data, float arithmetic, float results
+     * PRECISION_MIXED:  float data, double arithmetic, double results
+     * \endcode
+     *
+     * In single precision, the float variant of each primitive named with
+     * the \p _f suffix is called if present in the module (e.g. \p F_f for
+     * the primitive \p F, see get_float_name()), otherwise the double
+     * primitive is called with its arguments and result converted. The
+     * modules with float variants are checked by ModuleLoader::check_closure()
+     * accepting the float closures. The shared subtree helpers of another
+     * precision aren't reused, and the FunctionCache and the DiskCache
+     * keep the functions of each precision apart.
+     *
+     * \param precision The precision of the next generated functions.
+     */
+    void set_precision(Precision precision);
+
+    /**
+     * Returns the precision of the generated functions.
+     *
+     * \return The precision.
+     */
+    Precision get_precision() const
+    { return mPrecision; }
+
+    /**
+     * Returns the name of the float variant of a primitive.
+     *
+     * \param func_name The primitive name.
+     * \return The float variant name (<func_name>_f).
+     */
+    static std::string get_float_name(const std::string &func_name);
+
+    /**
+     * Returns the number of calls in a function, the calls to the
+     * LLVM intrinsics aren't counted.
+     *
+     * \param func_name The function name.
+     * \return The number of calls.
+     */
+    unsigned int get_call_count(const std::string &func_name) const;
+
+    /**
+     * Returns the number of AST nodes which weren't generated by the
+     * last compile_population() because of the subtree sharing.
+     *
+     * \return The number of deduplicated nodes.
+     */
+    unsigned long get_deduplicated_nodes() const
+    { return mDeduplicatedNodes; }
+
+    /**
+     * Returns a function name prefix unique to the handler, no function
+     * of the module has a name starting with it. The callers generating
+     * functions under their own names (FunctionCache, TieredEvaluator)
+     * use it so several of them can share the handler.
+     *
+     * \param base The start of the prefix.
+     * \return The base followed by a number and an underscore.
+     */
+    std::string get_unique_prefix(const std::string &base);
 
     /**
      * JITs the function (func_name) and then return a function
@@ -155,15 +798,121 @@ public:
     void *jit_function(const std::string &func_name);
 
     /**
-     * Sets the variable list used in your AST.
+     * JITs a primitive function of the loaded modules (a function
+     * node of the ASTs) and returns its function pointer, it is used
+     * to call the primitives outside the generated code. The primitive
+     * must be a double closure, see ModuleLoader::check_closure().
+     *
+     * \param func_name The primitive name.
+     * \param arg_size If not NULL, receives the number of arguments.
+     * \return The function pointer, or NULL if the primitive isn't found
+     *         or its body can't be read.
+     */
+    void *get_primitive_pointer(const std::string &func_name,
+                                unsigned int *arg_size=NULL);
+
+    /**
+     * Returns a hash of the primitives of the module (their names and
+     * their IR), two handlers have the same hash if they were created
+     * from the same primitives.
+     *
+     * \return The primitive hash.
+     */
+    uint64_t get_primitive_hash() const;
+
+    /**
+     * Writes the bitcode of a generated function, as a standalone
+     * module with declarations of the called primitives. The function
+     * must not call internal functions (such as the shared subtrees).
+     *
+     * \param func_name The function name.
+     * \param bitcode Receives the bitcode.
+     * \param error_string Error message in case of error.
+     * \return true on success, false otherwise.
+     */
+    bool get_function_bitcode(const std::string &func_name,
+                              std::string &bitcode,
+                              std::string &error_string) const;
+
+    /**
+     * Links a function written by get_function_bitcode() into the
+     * module, with a new name. The function can then be JITed using
+     * jit_function(), without the code generation and the function
+     * passes.
+     *
+     * \param bitcode The function bitcode.
+     * \param func_name The new function name, it must not exist in the module.
+     * \param error_string Error message in case of error.
+     * \return The linked function, or NULL on error.
+     */
+    llvm::Function *link_function_bitcode(const std::string &bitcode,
+                                          const std::string &func_name,
+                                          std::string &error_string);
+
+    /**
+     * Returns the number of primitives whose bodies weren't read yet,
+     * when the module was lazily loaded by the ModuleLoader. The body
+     * of a primitive is read when a call to it is first generated.
+     *
+     * \return The number of primitives not materialized.
+     */
+    unsigned int get_materializable_count() const;
+
+    /**
+     * Returns the error of the last primitive body which couldn't be
+     * read from a lazily loaded module. The code generation methods
+     * return NULL when a body they need can't be read, instead of
+     * generating calls the JIT couldn't resolve.
+     *
+     * \return The error message, empty if there was no error.
+     */
+    const std::string &get_materialize_error() const
+    { return mMaterializeError; }
+
+    /**
+     * Infers the attributes of the primitives defined in the module:
+     * the primitives that don't access memory (except their stack and
+     * the constant globals) are marked readnone, the ones that only read
+     * memory are marked readonly, and the ones that can't unwind are
+     * marked nounwind. The calls keep the effects of the called functions,
+     * and the external functions have the attributes they were declared
+     * with. These attributes let the function passes apply CSE and LICM
+     * to the primitive calls when they aren't inlined. It reads the bodies
+     * of a lazily loaded module.
+     *
+     * \param report Receives a line for each primitive, with its
+     *               attributes or the reason of its side effects.
+     * \return true on success, false otherwise (the error is in the report).
+     */
+    bool infer_primitive_attributes(std::string &report);
+
+    /**
+     * Returns true if the attributes of the primitives were inferred,
+     * see infer_primitive_attributes().
+     *
+     * \return true if the attributes were inferred, false otherwise.
+     */
+    bool get_attributes_inferred() const
+    { return mAttributesInferred; }
+
+    /**
+     * Returns true if the primitive is marked readnone and nounwind,
+     * see infer_primitive_attributes().
+     *
+     * \param func_name The primitive name.
+     * \return true if the primitive is pure, false otherwise.
+     */
+    bool is_primitive_pure(const std::string &func_name) const;
+
+    /**
+     * Sets the variable list used in your AST, the symbol id of
+     * each variable is its index in the list. The shared subtree
+     * helpers take the variables as arguments, so the helpers of
+     * the previous list aren't reused.
      *
      * \param var_list Variable list.
      */
-    void set_variable_list(const std::vector<std::string> &var_list)
-    {
-        assert(var_list.size()>0);
-        mVariableList = var_list;
-    }
+    void set_variable_list(const std::vector<std::string> &var_list);
 
     /**
      * Returns the variable list used for the AST.
@@ -173,6 +922,47 @@ public:
     std::vector<std::string> get_variable_list(void)
     { return mVariableList; }
 
+    /**
+     * Returns the number of variables of the variable list.
+     *
+     * \return The number of variables.
+     */
+    unsigned int get_variable_count() const
+    { return mVariableList.size(); }
+
+    /**
+     * Returns the symbol id of a primitive, the primitives of the
+     * module are numbered when the handler is created.
+     *
+     * \param func_name The primitive name.
+     * \return The symbol id, or ASTNode::NO_SYMBOL if not found.
+     */
+    int get_function_symbol(const std::string &func_name) const;
+
+    /**
+     * Returns the symbol id of a variable, which is
+     * its index in the variable list.
+     *
+     * \param var_name The variable name.
+     * \return The symbol id, or ASTNode::NO_SYMBOL if not found.
+     */
+    int get_variable_symbol(const std::string &var_name) const;
+
+    /**
+     * Sets the symbol ids of the variables and functions of the AST, so
+     * the code generation indexes the primitive table and the arguments
+     * instead of looking up the names. The ids are valid for this handler
+     * (and the handlers created from copies of the same module) until the
+     * variable list is changed, the nodes not resolved and the variables
+     * whose ids are stale are looked up by name.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param error_string The error string.
+     * \return true if all the symbols were found, false otherwise.
+     */
+    bool resolve_symbols(const std::vector<ASTNode*> *ast_nodes,
+                         std::string &error_string) const;
+
     /**
      * This method will free memory from all JITed functions.
      *
@@ -190,16 +980,345 @@ public:
 
 // Private interface
 private:
+    /**
+     * Creates the module Pass Manager of a profile: the O1 module passes
+     * for PROFILE_FAST_COMPILE, the O2 ones without loop unrolling for
+     * PROFILE_BALANCED, and the O3 ones followed by the link time passes
+     * for PROFILE_MAX_THROUGHPUT.
+     *
+     * \param profile The optimization profile.
+     * \return The Pass Manager.
+     */
+    static llvm::PassManager *create_pass_manager(OptimizationProfile profile);
+
+    /**
+     * Creates the Function Pass Manager of a profile.
+     *
+     * \param module The LLVM Module.
+     * \param execution_engine The LLVM Execution Engine (JIT).
+     * \param profile The optimization profile.
+     * \return The Function Pass Manager.
+     */
+    static llvm::FunctionPassManager *create_function_pass_manager(llvm::Module *module,
+                                                                   llvm::ExecutionEngine *execution_engine,
+                                                                   OptimizationProfile profile);
+
+    /**
+     * Returns the Function Pass Manager of a profile, the one of the
+     * handler profile is the handler Function Pass Manager, the others
+     * are created when first used.
+     *
+     * \param profile The optimization profile.
+     * \return The Function Pass Manager.
+     */
+    llvm::FunctionPassManager *get_function_pass_manager(OptimizationProfile profile);
+
+    /**
+     * Reads the body of a function of a lazily loaded module, if
+     * it wasn't read yet. On error, the message is kept for
+     * get_materialize_error() and the function being generated
+     * is discarded by record_codegen().
+     *
+     * \param func The function.
+     * \return true for ok, false for error.
+     */
+    bool materialize_function(llvm::Function *func);
+
+    /**
+     * Returns true if the function calls itself, directly or
+     * through the functions it calls.
+     *
+     * \param func The function.
+     * \return true if the function is recursive, false otherwise.
+     */
+    bool is_recursive_function(llvm::Function *func);
+
+    /**
+     * Inlines the calls to the primitives defined in the module,
+     * the recursive primitives aren't inlined, see set_force_inline().
+     *
+     * \param func The function.
+     * \return The number of calls left.
+     */
+    unsigned int inline_primitive_calls(llvm::Function *func);
+
+    /**
+     * Records the statistics of a generated function, or erases it if
+     * a primitive body couldn't be read during its code generation.
+     *
+     * \param func The generated function.
+     * \param start_time The start time of the code generation.
+     * \return The function, or NULL if it was erased.
+     */
+    llvm::Function *record_codegen(llvm::Function *func, double start_time);
+
+    /**
+     * Records the statistics of the function passes of a function.
+     *
+     * \param func The optimized function.
+     * \param start_time The start time of the function passes.
+     */
+    void record_function_passes(llvm::Function *func, double start_time);
+
+    /**
+     * Records the statistics of the native code generation of a function.
+     *
+     * \param func The JITed function.
+     * \param start_time The start time of the native code generation.
+     */
+    void record_jit(llvm::Function *func, double start_time);
+
     /**
      * This method is used to declare the function prototype inside
      * the module. Its used before creating an entry point.
      *
      * \param function_name The function name.
-     * \param named_values The mapping of named values.
+     * \param variable_values Receives the arguments, in the order of the variable list.
      * \return The new created function.
      */
     llvm::Function *declare_function(const std::string &function_name,
-                                     std::map<std::string, llvm::Value*> &named_values);
+                                     std::vector<llvm::Value*> &variable_values,
+                                     bool with_params=false);
+
+    /**
+     * This method is used to declare the batch kernel prototype inside
+     * the module, see codegen_ast_batch() for the prototype.
+     *
+     * \param function_name The function name.
+     * \param with_params true to add the parameter array, see codegen_ast_params().
+     * \return The new created function.
+     */
+    llvm::Function *declare_batch_function(const std::string &function_name,
+                                           bool with_params=false);
+
+    /**
+     * This method is used to declare the gradient function prototype
+     * inside the module, see codegen_ast_gradient() for the prototype.
+     *
+     * \param function_name The function name.
+     * \param variable_values Receives the arguments, in the order of the variable list.
+     * \return The new created function.
+     */
+    llvm::Function *declare_gradient_function(const std::string &function_name,
+                                              std::vector<llvm::Value*> &variable_values);
+
+    /**
+     * This method is used to declare the fitness gradient kernel prototype
+     * inside the module, see codegen_ast_fitness_gradient() for the prototype.
+     *
+     * \param function_name The function name.
+     * \return The new created function.
+     */
+    llvm::Function *declare_fitness_gradient_function(const std::string &function_name);
+
+    /**
+     * Checks that the derivative primitives of every function of the
+     * tree are in the module.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param error_string Error message in case of error.
+     * \return true if all the derivatives were found, false otherwise.
+     */
+    bool check_derivatives(const std::vector<ASTNode*> *ast_nodes,
+                           std::string &error_string);
+
+    /**
+     * Checks that the interval primitives of every function of the
+     * tree are in the module, each one taking the two double bounds of
+     * every argument and returning a double bound.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param error_string Error message in case of error.
+     * \return true if all the interval primitives were found and valid,
+     *         false otherwise.
+     */
+    bool check_interval_primitives(const std::vector<ASTNode*> *ast_nodes,
+                                   std::string &error_string);
+
+    /**
+     * Generates the LLVM IR for the value of the AST nodes and for their
+     * reverse-mode gradient at the end of the basic block.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param basic_block The basic block where the code is appended.
+     * \param variable_values The values of the variables, in the order of the variable list.
+     * \param constant_values The values of the constants indexed by their node index.
+     * \param param_layout The parameter layout of the tree.
+     * \param param_adjoints Receives the partial derivatives of the parameters.
+     * \param variable_adjoints Receives the partial derivatives of the variables,
+     *                          or NULL if they aren't needed.
+     * \return The value of the tree root.
+     */
+    llvm::Value *codegen_gradient_nodes(const std::vector<ASTNode*> *ast_nodes,
+                                        llvm::BasicBlock *basic_block,
+                                        const std::vector<llvm::Value*> &variable_values,
+                                        const std::vector<llvm::Value*> &constant_values,
+                                        const std::vector<unsigned int> &param_layout,
+                                        std::vector<llvm::Value*> &param_adjoints,
+                                        std::vector<llvm::Value*> *variable_adjoints);
+
+    /**
+     * Generates the body of a batch kernel.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param func The batch kernel declared by declare_batch_function().
+     * \param param_layout The parameter layout, or NULL if the
+     *                     constants are embedded in the code.
+     */
+    void codegen_batch_body(const std::vector<ASTNode*> *ast_nodes,
+                            llvm::Function *func,
+                            const std::vector<unsigned int> *param_layout);
+
+    /**
+     * This method is used to declare the fitness kernel prototype inside
+     * the module, see codegen_ast_fitness() for the prototype.
+     *
+     * \param function_name The function name.
+     * \return The new created function.
+     */
+    llvm::Function *declare_fitness_function(const std::string &function_name);
+
+    /**
+     * Generates the LLVM IR for the AST nodes at the end of the basic
+     * block, the variables are indexed by their symbol ids.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param basic_block The basic block where the code is appended.
+     * \param variable_values The values of the variables, in the order of the variable list.
+     * \param vector_width The vector width of the values, 1 for scalars.
+     * \param share_root false if the tree root must not be replaced by
+     *                   a shared subtree helper (used by the helpers).
+     * \param constant_values The values of the constants indexed by their
+     *                        node index, or NULL to embed the constants.
+     * \return The value of the tree root.
+     */
+    llvm::Value *codegen_ast_nodes(const std::vector<ASTNode*> *ast_nodes,
+                                   llvm::BasicBlock *basic_block,
+                                   const std::vector<llvm::Value*> &variable_values,
+                                   unsigned int vector_width=1,
+                                   bool share_root=true,
+                                   const std::vector<llvm::Value*> *constant_values=NULL);
+
+    /**
+     * Generates the LLVM IR for a tree of an ASTArena at the end of
+     * the basic block, see codegen_ast_nodes().
+     *
+     * \param arena The arena of the tree.
+     * \param tree The AST Tree.
+     * \param basic_block The basic block where the code is appended.
+     * \param variable_values The values of the variables, in the order of the variable list.
+     * \return The value of the tree root.
+     */
+    llvm::Value *codegen_flat_nodes(const ASTArena *arena, const FlatTree &tree,
+                                    llvm::BasicBlock *basic_block,
+                                    const std::vector<llvm::Value*> &variable_values);
+
+    /**
+     * Computes the number of nodes of each subtree of the
+     * pre-order AST, using the arity of the functions.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param subtree_sizes The number of nodes of the subtree rooted
+     *                      at each node.
+     */
+    void compute_subtree_sizes(const std::vector<ASTNode*> *ast_nodes,
+                               std::vector<unsigned int> &subtree_sizes);
+
+    /**
+     * Finds which subtrees of the AST are replaced by shared
+     * subtree helpers, creating the helpers when needed.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param share_root false if the root must not be replaced.
+     * \param shared_calls The helper of each replaced subtree root,
+     *                     NULL for the other nodes.
+     * \param covered true for the nodes inside a replaced subtree.
+     */
+    void find_shared_subtrees(const std::vector<ASTNode*> *ast_nodes,
+                              bool share_root,
+                              std::vector<llvm::Function*> &shared_calls,
+                              std::vector<bool> &covered);
+
+    /**
+     * Returns the helper function of a shared subtree, creating
+     * it if needed.
+     *
+     * \param ast_nodes The AST Tree.
+     * \param begin The index of the subtree root.
+     * \param size The number of nodes of the subtree.
+     * \param hash The structural hash of the subtree.
+     * \return The helper, or NULL if another subtree with the same
+     *         hash already has a helper.
+     */
+    llvm::Function *get_shared_helper(const std::vector<ASTNode*> *ast_nodes,
+                                      unsigned int begin, unsigned int size,
+                                      uint64_t hash);
+
+    /**
+     * Generates the call of a function node for vector values, using the
+     * vector variant of the function when available or calling the
+     * scalar function for each lane otherwise.
+     *
+     * \param basic_block The basic block where the code is appended.
+     * \param scalar_func The scalar function.
+     * \param argument_list The vector arguments.
+     * \param vector_width The vector width of the arguments.
+     * \return The vector result.
+     */
+    llvm::Value *codegen_vector_call(llvm::BasicBlock *basic_block,
+                                     llvm::Function *scalar_func,
+                                     const std::vector<llvm::Value*> &argument_list,
+                                     unsigned int vector_width);
+
+    /**
+     * Generates the call of a function node for scalar values of the
+     * precision, using the float variant of the function in single
+     * precision when available, or converting the arguments and the
+     * result of the double function otherwise.
+     *
+     * \param basic_block The basic block where the code is appended.
+     * \param func The double function.
+     * \param argument_list The arguments.
+     * \return The result.
+     */
+    llvm::Value *codegen_scalar_call(llvm::BasicBlock *basic_block,
+                                     llvm::Function *func,
+                                     const std::vector<llvm::Value*> &argument_list);
+
+    /**
+     * Returns the symbol id of a variable node: its resolved symbol if
+     * it is still valid for the variable list (see resolve_symbols()),
+     * otherwise the symbol of its name.
+     *
+     * \param variable The variable node.
+     * \return The symbol id, or ASTNode::NO_SYMBOL if not found.
+     */
+    int resolve_variable_symbol(const ASTVariable *variable) const;
+
+    /**
+     * Returns the function of a function node, using its symbol if it
+     * was resolved against this handler and its name otherwise.
+     *
+     * \param function The function node.
+     * \return The function, or NULL if not found.
+     */
+    llvm::Function *resolve_function(const ASTFunction *function) const;
+
+    /**
+     * Returns the type of the variables, the columns and the target of
+     * the generated functions (float or double), see set_precision().
+     *
+     * \return The data type.
+     */
+    const llvm::Type *get_data_type() const;
+
+    /**
+     * Returns the type of the arithmetic and the results of the generated
+     * functions (float or double), see set_precision().
+     *
+     * \return The value type.
+     */
+    const llvm::Type *get_value_type() const;
 
 private:
     /**
@@ -236,6 +1355,140 @@ private:
      * The hash map from function name to LLVM Function pointer.
      */
     JITFunctionMap mJITFunctions;
+
+    /**
+     * This typedef declares a hash map from symbol name to symbol id.
+     */
+    typedef tr1impl::unordered_map<std::string, unsigned int> SymbolMap;
+
+    /**
+     * The primitives of the module, indexed by symbol id.
+     */
+    std::vector<llvm::Function*> mFunctionTable;
+
+    /**
+     * The hash map from primitive name to symbol id.
+     */
+    SymbolMap mFunctionSymbols;
+
+    /**
+     * The hash map from variable name to symbol id.
+     */
+    SymbolMap mVariableSymbols;
+
+    /**
+     * true if the subtree sharing of compile_population() is enabled.
+     */
+    bool mSubtreeSharing;
+
+    /**
+     * true if the primitives are inlined before the function passes.
+     */
+    bool mForceInline;
+
+    /**
+     * true if a primitive body couldn't be read since the
+     * start of the current code generation.
+     */
+    bool mMaterializeFailed;
+
+    /**
+     * The error of the last primitive body which couldn't be read.
+     */
+    std::string mMaterializeError;
+
+    /**
+     * The precision of the generated functions.
+     */
+    Precision mPrecision;
+
+    /**
+     * The structural hashes of the subtrees repeated in the population
+     * being compiled, only valid during compile_population().
+     */
+    tr1impl::unordered_set<uint64_t> mSharedHashes;
+
+    /**
+     * The helper functions created during compile_population().
+     */
+    std::vector<llvm::Function*> mNewSharedHelpers;
+
+    /**
+     * A shared subtree helper function.
+     */
+    struct SharedHelper
+    {
+        /**
+         * The structural key of the subtree.
+         */
+        std::string key;
+
+        /**
+         * The helper function.
+         */
+        llvm::Function *function;
+    };
+
+    /**
+     * This typedef declares a hash map from subtree structural hash to its helper.
+     */
+    typedef tr1impl::unordered_map<uint64_t, SharedHelper> SharedHelperMap;
+
+    /**
+     * The hash map from subtree structural hash to its helper.
+     */
+    SharedHelperMap mSharedHelpers;
+
+    /**
+     * The number of nodes generated since the start of compile_population().
+     */
+    unsigned long mGeneratedNodes;
+
+    /**
+     * The number of nodes deduplicated by the last compile_population().
+     */
+    unsigned long mDeduplicatedNodes;
+
+    /**
+     * true if the attributes of the primitives were inferred.
+     */
+    bool mAttributesInferred;
+
+    /**
+     * The number of prefixes returned by get_unique_prefix().
+     */
+    unsigned long mUniquePrefixCount;
+
+    /**
+     * The optimization profile of the handler.
+     */
+    OptimizationProfile mProfile;
+
+    /**
+     * The Function Pass Managers of the other profiles,
+     * indexed by profile.
+     */
+    llvm::FunctionPassManager *mProfilePassManagers[PROFILE_MAX_THROUGHPUT+1];
+
+    /**
+     * The cumulative compile statistics.
+     */
+    CompileStats mCompileStats;
+
+    /**
+     * This typedef declares a hash map from function name to its statistics.
+     */
+    typedef tr1impl::unordered_map<std::string, FunctionStats> FunctionStatsMap;
+
+    /**
+     * The hash map from function name to its statistics.
+     */
+    FunctionStatsMap mFunctionStats;
+
+    /**
+     * The JIT listener recording the emitted machine code.
+     */
+    llvm::JITEventListener *mStatsListener;
 };
 
 }
@@ -32,6 +32,7 @@ namespace llvm
 {
     class Linker;
     class Module;
+    class LLVMContext;
 }
 
 namespace shine
@@ -53,9 +54,13 @@ public:
      *
      * \param prog_name The program name.
      * \param module_name The composite module name.
+     * \param context The LLVM context of the composite module, if NULL
+     *                the LLVM global context is used. The linked modules
+     *                must be in the same context.
      */
     ModuleLinker(const std::string &prog_name,
-                 const std::string &module_name);
+                 const std::string &module_name,
+                 llvm::LLVMContext *context=NULL);
 
     virtual ~ModuleLinker();
 
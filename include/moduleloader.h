@@ -32,6 +32,7 @@ namespace llvm
 
 class Module;
 class MemoryBuffer;
+class LLVMContext;
 
 }
 
@@ -79,16 +80,49 @@ public:
     llvm::Module *get_internal_module()
     { return mInternalModule; }
 
+    /**
+     * This method releases the internal module, the ownership
+     * of the module is transferred to the caller, so the
+     * ModuleLoader shouldn't be used anymore.
+     *
+     * \return The internal LLVM Module.
+     */
+    llvm::Module *release_module();
+
     /**
      * Checks if the entire module is a valid double closure
      * type needed for the system. This method will check
      * if every function arguments and return types are returning
-     * double or not.
+     * double or not. Vectors of double are also accepted, they are
+     * used by the vector variants of the functions (see
+     * ModuleHandler::codegen_ast_vector()), every argument of a vector
+     * variant must be a vector of the width of its result. The float
+     * closures can be accepted too, for the float variants of the
+     * functions (see ModuleHandler::set_precision()), every type of a
+     * float closure must be a float or a vector of float.
      *
      * \param error_string Closure errors found.
+     * \param accept_float true to accept the float closures.
      * \return true if problems were found, false otherwise.
      */
-    bool check_closure(std::string &error_string);
+    bool check_closure(std::string &error_string, bool accept_float=false);
+
+    /**
+     * Returns the number of functions of a lazily loaded module
+     * whose bodies weren't read from the bitcode yet.
+     *
+     * \return The number of functions not materialized.
+     */
+    unsigned int get_materializable_count() const;
+
+    /**
+     * Reads the bodies of all the functions of a lazily loaded
+     * module, this is done by the ModuleLinker when linking it.
+     *
+     * \param error_string The error message in case of problems.
+     * \return true for ok, false for error.
+     */
+    bool materialize_all(std::string &error_string);
 
 // Public static interface
 public:
@@ -99,10 +133,17 @@ public:
      *
      * \param filename The bitcode file.
      * \param error_string The error message in case of problems.
+     * \param context The LLVM context of the module, if NULL the
+     *                LLVM global context is used.
+     * \param lazy If true, the file is kept mapped in memory and the
+     *             function bodies are only read when first used, see
+     *             create_from_memory_buffer().
      * \return A new ModuleLoader instance, or NULL if error.
      */
     static ModuleLoader* create_from_file(const std::string &filename,
-                                          std::string &error_string);
+                                          std::string &error_string,
+                                          llvm::LLVMContext *context=NULL,
+                                          bool lazy=false);
 
     /**
      * This method creates a new ModuleLoader instance from the
@@ -111,10 +152,21 @@ public:
      *
      * \param memory_buffer The memory buffer.
      * \param error_string The error message in case of problems.
+     * \param context The LLVM context of the module, if NULL the
+     *                LLVM global context is used.
+     * \param lazy If true, only the function prototypes are read, the
+     *             bodies are read when the ModuleHandler first generates
+     *             a call to them or JITs them. In this case the module
+     *             takes the ownership of the memory buffer on success.
+     *             Linking the module with the ModuleLinker reads all
+     *             the bodies, so pass the module directly to the
+     *             ModuleHandler to keep it lazy.
      * \return A new ModuleLoader instance, or NULL if error.
      */
     static ModuleLoader* create_from_memory_buffer(llvm::MemoryBuffer *memory_buffer,
-                                                   std::string &error_string);
+                                                   std::string &error_string,
+                                                   llvm::LLVMContext *context=NULL,
+                                                   bool lazy=false);
 };
 
 } // namespace shine
@@ -29,6 +29,16 @@
 #include "modulelinker.h"
 #include "modulehandler.h"
 #include "astnode.h"
+#include "astarena.h"
+#include "threadpool.h"
+#include "compilepool.h"
+#include "evaluator.h"
+#include "functioncache.h"
+#include "interpreter.h"
+#include "tieredevaluator.h"
+#include "bytecodevm.h"
+#include "diskcache.h"
+#include "simplifier.h"
 
 namespace shine
 {
@@ -0,0 +1,289 @@
+/**
+ * \file simplifier.h
+ * This file defines and implement the Simplifier related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SIMPLIFIER_H
+#define SIMPLIFIER_H
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+
+namespace tr1impl = std::tr1;
+
+namespace shine
+{
+
+class ModuleHandler;
+class ASTNode;
+class Simplifier;
+
+/**
+ * This is the abstract rewrite rule class applied by the Simplifier,
+ * the rules are tried on each subtree after its children were simplified.
+ */
+class RewriteRule
+{
+public:
+    RewriteRule() {};
+    virtual ~RewriteRule() {};
+
+    /**
+     * This method is called by the Simplifier for each subtree.
+     *
+     * \param simplifier The Simplifier, used to get the subtree sizes.
+     * \param subtree The pre-order subtree.
+     * \param rewritten Receives the new pre-order subtree, the nodes are
+     *                  allocated by the rule and owned by the Simplifier.
+     * \return true if the subtree was rewritten, false otherwise.
+     */
+    virtual bool rewrite(Simplifier &simplifier,
+                         const std::vector<ASTNode*> &subtree,
+                         std::vector<ASTNode*> &rewritten) = 0;
+};
+
+/**
+ * This is a rewrite rule described by a pattern tree and a replacement
+ * tree, both in pre-order. The variables of the pattern whose names start
+ * with '?' are wildcards: they match any subtree, and the same wildcard
+ * must match equal subtrees. The replacement uses the wildcards to copy
+ * the matched subtrees, as in I(?a) -> ?a or F(?a, 0.0) -> ?a.
+ */
+class PatternRule : public RewriteRule
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates the rule, the trees are copied.
+     *
+     * \param pattern The pattern tree.
+     * \param replacement The replacement tree, it can only use the
+     *                    wildcards of the pattern.
+     */
+    PatternRule(const std::vector<ASTNode*> &pattern,
+                const std::vector<ASTNode*> &replacement);
+    virtual ~PatternRule();
+
+// Not implemented copy/assign
+private:
+    PatternRule(const PatternRule&);
+    PatternRule& operator=(const PatternRule&);
+
+// Public interface
+public:
+    virtual bool rewrite(Simplifier &simplifier,
+                         const std::vector<ASTNode*> &subtree,
+                         std::vector<ASTNode*> &rewritten);
+
+// Private interface
+private:
+    /**
+     * A subtree matched by a wildcard.
+     */
+    struct Binding
+    {
+        unsigned int begin;
+        unsigned int size;
+    };
+
+    typedef tr1impl::unordered_map<std::string, Binding> BindingMap;
+
+private:
+    /**
+     * The pattern tree.
+     */
+    std::vector<ASTNode*> mPattern;
+
+    /**
+     * The replacement tree.
+     */
+    std::vector<ASTNode*> mReplacement;
+};
+
+/**
+ * This class simplifies the pre-order ASTs before the code generation:
+ * the constant subtrees are folded by calling the primitives JITed by the
+ * ModuleHandler, and the registered rewrite rules are applied bottom-up.
+ * Only the pure primitives are folded, the Simplifier infers the primitive
+ * attributes if the handler didn't (see ModuleHandler::infer_primitive_attributes()).
+ */
+class Simplifier
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates a simplifier for the primitives of the ModuleHandler,
+     * it doesn't take the ownership of the handler. The attributes of
+     * the primitives are inferred if they weren't, reading the bodies
+     * of a lazily loaded module.
+     *
+     * \param handler The ModuleHandler with the primitives.
+     * \param max_rewrites The maximum number of rules applied for each
+     *                     tree, so cyclic rules always terminate.
+     */
+    Simplifier(ModuleHandler *handler, unsigned int max_rewrites=64);
+    virtual ~Simplifier();
+
+// Not implemented copy/assign
+private:
+    Simplifier(const Simplifier&);
+    Simplifier& operator=(const Simplifier&);
+
+// Public interface
+public:
+    /**
+     * Adds a rewrite rule, the Simplifier takes the ownership of
+     * the rule. The rules are tried in the order they were added.
+     *
+     * \param rule The rewrite rule.
+     */
+    void add_rule(RewriteRule *rule);
+
+    /**
+     * Simplifies the AST, the simplified tree is a new tree, its
+     * nodes must be deleted by the caller.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \param simplified Receives the simplified tree.
+     */
+    void simplify(const std::vector<ASTNode*> *ast_nodes,
+                  std::vector<ASTNode*> &simplified);
+
+    /**
+     * Returns the number of arguments of a primitive.
+     *
+     * \param func_name The primitive name.
+     * \return The number of arguments.
+     */
+    unsigned int get_arity(const std::string &func_name);
+
+    /**
+     * Returns the number of nodes of the subtree starting at \p begin.
+     *
+     * \param ast_nodes The pre-order tree.
+     * \param begin The index of the subtree root.
+     * \return The number of nodes of the subtree.
+     */
+    unsigned int get_subtree_size(const std::vector<ASTNode*> &ast_nodes,
+                                  unsigned int begin);
+
+    /**
+     * Returns the number of subtrees folded into constants.
+     *
+     * \return The number of folded subtrees.
+     */
+    unsigned long get_folded_count() const
+    { return mFoldedCount; }
+
+    /**
+     * Returns the number of rewrite rules applied.
+     *
+     * \return The number of rewrites.
+     */
+    unsigned long get_rewritten_count() const
+    { return mRewrittenCount; }
+
+// Public static interface
+public:
+    /**
+     * Copies an AST node.
+     *
+     * \param node The node.
+     * \return The new node.
+     */
+    static ASTNode *clone_node(const ASTNode *node);
+
+// Private interface
+private:
+    /**
+     * A primitive called by the constant folding.
+     */
+    struct Primitive
+    {
+        void *pointer;
+        unsigned int arg_size;
+        bool pure;
+    };
+
+    typedef tr1impl::unordered_map<std::string, Primitive> PrimitiveMap;
+
+    /**
+     * Returns the primitive, JITing it on the first use.
+     */
+    const Primitive &get_primitive(const std::string &func_name);
+
+    /**
+     * Simplifies the tree, appending the simplified nodes.
+     *
+     * \param ast_nodes The pre-order tree.
+     * \param simplified Receives the simplified nodes.
+     * \param rewrites The number of rules applied to this tree.
+     */
+    void simplify_nodes(const std::vector<ASTNode*> &ast_nodes,
+                        std::vector<ASTNode*> &simplified,
+                        unsigned int &rewrites);
+
+    /**
+     * Folds the subtree if its arguments are constants.
+     *
+     * \param subtree The pre-order subtree, it is replaced by
+     *                the constant when folded.
+     * \return true if folded, false otherwise.
+     */
+    bool fold_constants(std::vector<ASTNode*> &subtree);
+
+private:
+    /**
+     * The ModuleHandler with the primitives.
+     */
+    ModuleHandler *mHandler;
+
+    /**
+     * The maximum number of rules applied for each tree.
+     */
+    unsigned int mMaxRewrites;
+
+    /**
+     * The rewrite rules.
+     */
+    std::vector<RewriteRule*> mRules;
+
+    /**
+     * The primitives used.
+     */
+    PrimitiveMap mPrimitives;
+
+    /**
+     * The number of subtrees folded into constants.
+     */
+    unsigned long mFoldedCount;
+
+    /**
+     * The number of rewrite rules applied.
+     */
+    unsigned long mRewrittenCount;
+};
+
+} // namespace shine
+
+#endif // SIMPLIFIER_H
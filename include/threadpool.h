@@ -0,0 +1,175 @@
+/**
+ * \file threadpool.h
+ * This file defines and implement the ThreadPool related classes and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+
+#include <pthread.h>
+
+namespace shine
+{
+
+/**
+ * This is the abstract task class executed by the ThreadPool,
+ * the same task is executed by every worker thread of the pool.
+ */
+class ThreadTask
+{
+public:
+    ThreadTask() {};
+    virtual ~ThreadTask() {};
+
+    /**
+     * This method is called by each worker thread of the pool.
+     *
+     * \param worker_index The index of the worker thread, from zero
+     *                     to the number of threads minus one.
+     */
+    virtual void run(unsigned int worker_index) = 0;
+};
+
+/**
+ * This class owns a set of persistent worker threads, the threads
+ * are created once and then wait for tasks, so the thread creation
+ * cost isn't paid for each parallel operation.
+ */
+class ThreadPool
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates the thread pool and starts the worker threads.
+     *
+     * \param num_threads The number of worker threads.
+     */
+    ThreadPool(unsigned int num_threads);
+    virtual ~ThreadPool();
+
+// Not implemented copy/assign
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+// Public interface
+public:
+    /**
+     * Runs the task in every worker thread and waits until all
+     * the workers have finished it. Calls from different threads
+     * are serialized.
+     *
+     * \param task The task to run.
+     */
+    void run(ThreadTask *task);
+
+    /**
+     * Returns the number of worker threads.
+     *
+     * \return The number of worker threads.
+     */
+    unsigned int get_num_threads() const
+    { return mThreads.size(); }
+
+// Private interface
+private:
+    /**
+     * The entry point of the worker threads.
+     *
+     * \param worker The WorkerInfo of the thread.
+     * \return Always NULL.
+     */
+    static void *worker_main(void *worker);
+
+    /**
+     * The main loop of the worker threads.
+     *
+     * \param worker_index The index of the worker thread.
+     */
+    void worker_loop(unsigned int worker_index);
+
+    /**
+     * Information passed to each worker thread.
+     */
+    struct WorkerInfo
+    {
+        ThreadPool *pool;
+        unsigned int worker_index;
+    };
+
+private:
+    /**
+     * The worker threads.
+     */
+    std::vector<pthread_t> mThreads;
+
+    /**
+     * The information of each worker thread.
+     */
+    std::vector<WorkerInfo> mWorkerInfo;
+
+    /**
+     * The mutex protecting the pool state.
+     */
+    pthread_mutex_t mMutex;
+
+    /**
+     * The mutex serializing the run() calls.
+     */
+    pthread_mutex_t mRunMutex;
+
+    /**
+     * Signaled when a new task is available or when the pool is shutting down.
+     */
+    pthread_cond_t mTaskCond;
+
+    /**
+     * Signaled when the last worker finishes the current task.
+     */
+    pthread_cond_t mDoneCond;
+
+    /**
+     * The current task.
+     */
+    ThreadTask *mTask;
+
+    /**
+     * Incremented for each new task, used by the workers to detect new tasks.
+     */
+    unsigned long mGeneration;
+
+    /**
+     * The number of workers still running the current task.
+     */
+    unsigned int mPending;
+
+    /**
+     * true when the pool is shutting down.
+     */
+    bool mShutdown;
+};
+
+} // namespace shine
+
+#endif // THREADPOOL_H
@@ -0,0 +1,241 @@
+/**
+ * \file tieredevaluator.h
+ * This file defines and implement the TieredEvaluator related class and methods.
+ */
+
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TIEREDEVALUATOR_H
+#define TIEREDEVALUATOR_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "interpreter.h"
+
+namespace shine
+{
+
+class ModuleHandler;
+class ASTNode;
+
+/**
+ * This class evaluates the trees in tiers: the trees start in the
+ * Interpreter and are JITed only when they become hot, which is when
+ * they are evaluated a number of times or when the interpreted work
+ * (nodes times rows) becomes greater than a threshold. Most of the
+ * individuals of a GP run are evaluated once and discarded, so they
+ * never pay the code generation cost.
+ */
+class TieredEvaluator
+{
+// Ctor & Dtor
+public:
+    /**
+     * Creates a tiered evaluator for the ModuleHandler, the variable
+     * list of the handler must be set before. It doesn't take the
+     * ownership of the handler.
+     *
+     * \param handler The ModuleHandler used to interpret and compile the trees.
+     * \param promote_evaluations The number of evaluations to JIT a tree.
+     * \param promote_cost The interpreted work (nodes times rows) to JIT a tree.
+     */
+    TieredEvaluator(ModuleHandler *handler,
+                    unsigned int promote_evaluations=3,
+                    unsigned long promote_cost=1000000);
+    virtual ~TieredEvaluator();
+
+// Not implemented copy/assign
+private:
+    TieredEvaluator(const TieredEvaluator&);
+    TieredEvaluator& operator=(const TieredEvaluator&);
+
+// Public interface
+public:
+    /**
+     * Adds a tree to the evaluator, the tree nodes aren't copied, so
+     * they must live while the tree is used.
+     *
+     * \param ast_nodes Your AST Tree.
+     * \return The id of the tree.
+     */
+    unsigned int add_tree(const std::vector<ASTNode*> *ast_nodes);
+
+    /**
+     * Evaluates the tree over the dataset, with the same parameters of
+     * the kernels generated by ModuleHandler::codegen_ast_batch(). The
+     * tree is JITed first if it became hot.
+     *
+     * \param tree_id The id returned by add_tree().
+     * \param columns The dataset columns, one for each variable.
+     * \param out The output, it must have room for \p n results.
+     * \param n The number of rows.
+     * \param error_string The error string.
+     * \return true on success, false if the interpreter didn't find a
+     *         variable or a primitive of the tree.
+     */
+    bool evaluate(unsigned int tree_id, const double* const* columns,
+                  double *out, size_t n, std::string &error_string);
+
+    /**
+     * Returns true if the tree is already JITed.
+     *
+     * \param tree_id The id returned by add_tree().
+     * \return true if the tree is JITed, false otherwise.
+     */
+    bool is_compiled(unsigned int tree_id) const;
+
+    /**
+     * Removes all the trees and frees the JIT memory
+     * of the compiled ones.
+     */
+    void clear();
+
+    /**
+     * Sets the number of evaluations to JIT a tree.
+     *
+     * \param promote_evaluations The number of evaluations.
+     */
+    void set_promote_evaluations(unsigned int promote_evaluations)
+    { mPromoteEvaluations = promote_evaluations; }
+
+    /**
+     * Returns the number of evaluations to JIT a tree.
+     *
+     * \return The number of evaluations.
+     */
+    unsigned int get_promote_evaluations() const
+    { return mPromoteEvaluations; }
+
+    /**
+     * Sets the interpreted work (nodes times rows) to JIT a tree.
+     *
+     * \param promote_cost The interpreted work.
+     */
+    void set_promote_cost(unsigned long promote_cost)
+    { mPromoteCost = promote_cost; }
+
+    /**
+     * Returns the interpreted work (nodes times rows) to JIT a tree.
+     *
+     * \return The interpreted work.
+     */
+    unsigned long get_promote_cost() const
+    { return mPromoteCost; }
+
+    /**
+     * Returns the number of interpreted evaluations.
+     *
+     * \return The number of interpreted evaluations.
+     */
+    unsigned long get_interpreted_evaluations() const
+    { return mInterpretedEvaluations; }
+
+    /**
+     * Returns the number of JITed evaluations.
+     *
+     * \return The number of JITed evaluations.
+     */
+    unsigned long get_compiled_evaluations() const
+    { return mCompiledEvaluations; }
+
+    /**
+     * Returns the number of JITed trees.
+     *
+     * \return The number of JITed trees.
+     */
+    unsigned long get_promotions() const
+    { return mPromotions; }
+
+// Private interface
+private:
+    /**
+     * A tree of the evaluator.
+     */
+    struct Tree
+    {
+        /**
+         * The AST Tree.
+         */
+        const std::vector<ASTNode*> *ast_nodes;
+
+        /**
+         * The number of evaluations.
+         */
+        unsigned int evaluations;
+
+        /**
+         * The interpreted work (nodes times rows).
+         */
+        unsigned long cost;
+
+        /**
+         * The name of the JITed function.
+         */
+        std::string func_name;
+
+        /**
+         * The JITed function, or NULL if interpreted.
+         */
+        void *function;
+    };
+
+    /**
+     * JITs the tree, it stays in the interpreter if the handler isn't
+     * in double precision or if the kernel couldn't be generated.
+     *
+     * \param tree_id The id of the tree.
+     */
+    void promote(unsigned int tree_id);
+
+private:
+    /**
+     * The ModuleHandler used to compile the trees.
+     */
+    ModuleHandler *mHandler;
+
+    /**
+     * The interpreter of the cold trees.
+     */
+    Interpreter mInterpreter;
+
+    /**
+     * The trees, indexed by id.
+     */
+    std::vector<Tree> mTrees;
+
+    /**
+     * The promotion thresholds.
+     */
+    unsigned int mPromoteEvaluations;
+    unsigned long mPromoteCost;
+
+    /**
+     * The evaluation counters.
+     */
+    unsigned long mInterpretedEvaluations;
+    unsigned long mCompiledEvaluations;
+    unsigned long mPromotions;
+};
+
+} // namespace shine
+
+#endif // TIEREDEVALUATOR_H
@@ -0,0 +1,114 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "astarena.h"
+
+#include <cassert>
+
+namespace shine
+{
+
+unsigned int ASTArena::add_function_symbol(const std::string &name, unsigned int arity)
+{
+    assert(arity <= 255 && "Too many arguments !");
+
+    SymbolMap::const_iterator symbol_it = mFunctionSymbols.find(name);
+    if(symbol_it!=mFunctionSymbols.end())
+    {
+        assert(mFunctionArities[symbol_it->second]==arity);
+        return symbol_it->second;
+    }
+
+    const unsigned int symbol = mFunctionNames.size();
+    mFunctionSymbols.insert(std::make_pair(name, symbol));
+    mFunctionNames.push_back(name);
+    mFunctionArities.push_back(arity);
+    return symbol;
+}
+
+unsigned int ASTArena::add_variable_symbol(const std::string &name)
+{
+    SymbolMap::const_iterator symbol_it = mVariableSymbols.find(name);
+    if(symbol_it!=mVariableSymbols.end())
+        return symbol_it->second;
+
+    const unsigned int symbol = mVariableNames.size();
+    mVariableSymbols.insert(std::make_pair(name, symbol));
+    mVariableNames.push_back(name);
+    return symbol;
+}
+
+bool ASTArena::add_tree(const std::vector<ASTNode*> *ast_nodes, FlatTree &tree,
+                        std::string &error_string)
+{
+    const unsigned int begin = mOpcodes.size();
+    const unsigned int constants_begin = mConstants.size();
+
+    for(unsigned int i=0; i < ast_nodes->size(); i++)
+    {
+        const ASTNode *node = (*ast_nodes)[i];
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_CONSTANT:
+            push_constant(static_cast<const ASTConstant*>(node)->get_value());
+            break;
+
+        case ASTNode::AST_VARIABLE:
+            push_variable(add_variable_symbol(static_cast<const ASTVariable*>(node)->get_name()));
+            break;
+
+        case ASTNode::AST_FUNCTION:
+        {
+            const std::string func_name = static_cast<const ASTFunction*>(node)->get_name();
+            SymbolMap::const_iterator symbol_it = mFunctionSymbols.find(func_name);
+            if(symbol_it==mFunctionSymbols.end())
+            {
+                // Discards the partial tree
+                mOpcodes.resize(begin);
+                mArities.resize(begin);
+                mPayloads.resize(begin);
+                mConstants.resize(constants_begin);
+
+                error_string = "Function symbol not declared: " + func_name;
+                return false;
+            }
+
+            push_function(symbol_it->second);
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    tree = end_tree(begin);
+    return true;
+}
+
+void ASTArena::clear()
+{
+    mOpcodes.clear();
+    mArities.clear();
+    mPayloads.clear();
+    mConstants.clear();
+}
+
+}
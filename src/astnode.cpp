@@ -19,5 +19,137 @@
 
 #include "astnode.h"
 
+#include <cassert>
+#include <cstring>
+
 namespace shine
-{ }
+{
+
+const int ASTNode::NO_SYMBOL;
+
+namespace
+{
+
+/**
+ * Appends the structural key bytes to a string.
+ */
+class KeySink
+{
+public:
+    KeySink(std::string &key) : mKey(key) {};
+
+    void append(const void *data, size_t size)
+    { mKey.append(static_cast<const char*>(data), size); }
+
+private:
+    std::string &mKey;
+};
+
+/**
+ * Hashes the structural key bytes using the 64-bit FNV-1a hash.
+ */
+class HashSink
+{
+public:
+    HashSink() : mHash(14695981039346656037ULL) {};
+
+    void append(const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        for(size_t i=0; i < size; i++)
+        {
+            mHash ^= bytes[i];
+            mHash *= 1099511628211ULL;
+        }
+    }
+
+    uint64_t get_hash() const
+    { return mHash; }
+
+private:
+    uint64_t mHash;
+};
+
+/**
+ * Appends a name with its length, so that different
+ * sequences of names can't have the same bytes.
+ */
+template <class Sink>
+void append_name(Sink &sink, const std::string &name)
+{
+    const uint32_t name_size = name.size();
+    sink.append(&name_size, sizeof(name_size));
+    sink.append(name.data(), name.size());
+}
+
+template <class Sink>
+void append_structure(Sink &sink,
+                      std::vector<ASTNode*>::const_iterator it_begin,
+                      std::vector<ASTNode*>::const_iterator it_end)
+{
+    for(std::vector<ASTNode*>::const_iterator it = it_begin;
+        it != it_end; it++)
+    {
+        const ASTNode *node = *it;
+        const unsigned char node_type = node->get_id();
+        sink.append(&node_type, sizeof(node_type));
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_CONSTANT:
+        {
+            const double value = static_cast<const ASTConstant*>(node)->get_value();
+            unsigned char value_bytes[sizeof(double)];
+            std::memcpy(value_bytes, &value, sizeof(double));
+            sink.append(value_bytes, sizeof(double));
+            break;
+        }
+
+        case ASTNode::AST_VARIABLE:
+            append_name(sink, static_cast<const ASTVariable*>(node)->get_name());
+            break;
+
+        case ASTNode::AST_FUNCTION:
+            append_name(sink, static_cast<const ASTFunction*>(node)->get_name());
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+}
+
+std::string ASTNode::structural_key(const std::vector<ASTNode*> *ast_nodes)
+{
+    return structural_key(ast_nodes, 0, ast_nodes->size());
+}
+
+uint64_t ASTNode::structural_hash(const std::vector<ASTNode*> *ast_nodes)
+{
+    return structural_hash(ast_nodes, 0, ast_nodes->size());
+}
+
+std::string ASTNode::structural_key(const std::vector<ASTNode*> *ast_nodes,
+                                    unsigned int begin, unsigned int size)
+{
+    assert(begin + size <= ast_nodes->size());
+
+    std::string key;
+    KeySink sink(key);
+    append_structure(sink, ast_nodes->begin()+begin, ast_nodes->begin()+begin+size);
+    return key;
+}
+
+uint64_t ASTNode::structural_hash(const std::vector<ASTNode*> *ast_nodes,
+                                  unsigned int begin, unsigned int size)
+{
+    assert(begin + size <= ast_nodes->size());
+
+    HashSink sink;
+    append_structure(sink, ast_nodes->begin()+begin, ast_nodes->begin()+begin+size);
+    return sink.get_hash();
+}
+
+}
@@ -0,0 +1,324 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "bytecodevm.h"
+
+#include "modulehandler.h"
+#include "interpreter.h"
+#include "astnode.h"
+
+#include <cassert>
+#include <algorithm>
+#include <stdint.h>
+
+namespace shine
+{
+
+namespace
+{
+
+/**
+ * The kinds of the operands, the constants and the temporary registers
+ * are numbered apart until the number of constants is known.
+ */
+enum OperandKind
+{
+    OPERAND_VARIABLE,
+    OPERAND_CONSTANT,
+    OPERAND_REGISTER
+};
+
+}
+
+BytecodeVM::BytecodeVM(ModuleHandler *handler, unsigned int block_size)
+: mHandler(handler), mBlockSize(block_size)
+{
+    assert(handler && "No Module Handler provided !");
+    assert(block_size>0);
+}
+
+BytecodeProgram *BytecodeVM::compile(const std::vector<ASTNode*> *ast_nodes,
+                                     std::string &error_string)
+{
+    assert(ast_nodes && ast_nodes->size()>0);
+
+    BytecodeProgram *program = new BytecodeProgram();
+    // The program keeps the variable list of its compilation
+    program->mNumVariables = mHandler->get_variable_count();
+
+    std::vector<std::pair<OperandKind, unsigned int> > operand_stack;
+    std::vector<std::pair<OperandKind, unsigned int> > operand_list;
+    std::vector<unsigned int> dest_list;
+
+    typedef tr1impl::unordered_map<uint64_t, unsigned int> ConstantMap;
+    ConstantMap constant_map;
+
+    unsigned int num_registers = 0;
+
+    for(int i=ast_nodes->size()-1; i>=0; i--)
+    {
+        const ASTNode *node = (*ast_nodes)[i];
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_CONSTANT:
+        {
+            // Constants are shared when bit-exact equal
+            const double value = static_cast<const ASTConstant*>(node)->get_value();
+            uint64_t bits;
+            std::copy((const char*)&value, (const char*)&value + sizeof(value), (char*)&bits);
+
+            ConstantMap::const_iterator const_it = constant_map.find(bits);
+            if(const_it==constant_map.end())
+            {
+                const_it = constant_map.insert(std::make_pair(bits, program->mConstants.size())).first;
+                program->mConstants.push_back(value);
+            }
+
+            operand_stack.push_back(std::make_pair(OPERAND_CONSTANT, const_it->second));
+            break;
+        }
+
+        case ASTNode::AST_VARIABLE:
+        {
+            const std::string var_name = static_cast<const ASTVariable*>(node)->get_name();
+            const int symbol = mHandler->get_variable_symbol(var_name);
+            if(symbol==ASTNode::NO_SYMBOL)
+            {
+                error_string = "Variable not found: " + var_name;
+                delete program;
+                return NULL;
+            }
+
+            operand_stack.push_back(std::make_pair(OPERAND_VARIABLE, (unsigned int)symbol));
+            break;
+        }
+
+        case ASTNode::AST_FUNCTION:
+        {
+            const std::string func_name = static_cast<const ASTFunction*>(node)->get_name();
+
+            PrimitiveMap::iterator prim_it = mPrimitives.find(func_name);
+            if(prim_it==mPrimitives.end())
+            {
+                Primitive primitive;
+                primitive.function = mHandler->get_primitive_pointer(func_name, &primitive.arg_size);
+                if(!primitive.function)
+                {
+                    error_string = "Function not found: " + func_name;
+                    delete program;
+                    return NULL;
+                }
+                prim_it = mPrimitives.insert(std::make_pair(func_name, primitive)).first;
+            }
+
+            const Primitive &primitive = prim_it->second;
+            if(primitive.arg_size > Interpreter::MAX_ARG_SIZE ||
+               primitive.arg_size > operand_stack.size())
+            {
+                error_string = "Invalid number of arguments: " + func_name;
+                delete program;
+                return NULL;
+            }
+
+            BytecodeProgram::Instruction instruction;
+            instruction.opcode = BytecodeProgram::OP_CALL;
+            instruction.arg_size = primitive.arg_size;
+            instruction.first_arg = operand_list.size();
+            instruction.function = primitive.function;
+
+            // The first argument is on the top of the stack, the registers
+            // are released in stack order, so the destination can reuse them
+            for(unsigned int arg=0; arg < primitive.arg_size; arg++)
+            {
+                operand_list.push_back(operand_stack.back());
+                if(operand_stack.back().first==OPERAND_REGISTER)
+                    num_registers--;
+                operand_stack.pop_back();
+            }
+
+            const unsigned int dest = num_registers++;
+            program->mNumRegisters = std::max(program->mNumRegisters, num_registers);
+
+            program->mInstructions.push_back(instruction);
+            dest_list.push_back(dest);
+            operand_stack.push_back(std::make_pair(OPERAND_REGISTER, dest));
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    if(operand_stack.size()!=1)
+    {
+        error_string = "Invalid tree.";
+        delete program;
+        return NULL;
+    }
+
+    // The root writes directly to the output
+    if(operand_stack.back().first!=OPERAND_REGISTER)
+    {
+        BytecodeProgram::Instruction instruction;
+        instruction.opcode = BytecodeProgram::OP_COPY;
+        instruction.arg_size = 1;
+        instruction.first_arg = operand_list.size();
+        instruction.function = NULL;
+
+        operand_list.push_back(operand_stack.back());
+        program->mInstructions.push_back(instruction);
+        dest_list.push_back(0);
+    }
+
+    const unsigned int constant_base = program->mNumVariables;
+    const unsigned int output_slot = constant_base + program->mConstants.size();
+    const unsigned int register_base = output_slot + 1;
+
+    program->mOperands.resize(operand_list.size());
+    for(unsigned int i=0; i < operand_list.size(); i++)
+    {
+        switch(operand_list[i].first)
+        {
+        case OPERAND_VARIABLE:
+            program->mOperands[i] = operand_list[i].second;
+            break;
+        case OPERAND_CONSTANT:
+            program->mOperands[i] = constant_base + operand_list[i].second;
+            break;
+        case OPERAND_REGISTER:
+            program->mOperands[i] = register_base + operand_list[i].second;
+            break;
+        }
+    }
+
+    for(unsigned int i=0; i < program->mInstructions.size(); i++)
+        program->mInstructions[i].dest = register_base + dest_list[i];
+    program->mInstructions.back().dest = output_slot;
+
+    return program;
+}
+
+void BytecodeVM::run_instruction(const BytecodeProgram::Instruction &instruction,
+                                 const unsigned int *args,
+                                 double* const* slots, size_t rows)
+{
+    double *dest = slots[instruction.dest];
+
+    if(instruction.opcode==BytecodeProgram::OP_COPY)
+    {
+        std::copy(slots[args[0]], slots[args[0]] + rows, dest);
+        return;
+    }
+
+    const intptr_t f = (intptr_t)instruction.function;
+
+    // The common arities get their own loops, without
+    // the dispatch on the number of arguments
+    switch(instruction.arg_size)
+    {
+    case 1:
+    {
+        typedef double (*F1)(double);
+        const double *a0 = slots[args[0]];
+        for(size_t row=0; row < rows; row++)
+            dest[row] = ((F1)f)(a0[row]);
+        break;
+    }
+
+    case 2:
+    {
+        typedef double (*F2)(double, double);
+        const double *a0 = slots[args[0]];
+        const double *a1 = slots[args[1]];
+        for(size_t row=0; row < rows; row++)
+            dest[row] = ((F2)f)(a0[row], a1[row]);
+        break;
+    }
+
+    case 3:
+    {
+        typedef double (*F3)(double, double, double);
+        const double *a0 = slots[args[0]];
+        const double *a1 = slots[args[1]];
+        const double *a2 = slots[args[2]];
+        for(size_t row=0; row < rows; row++)
+            dest[row] = ((F3)f)(a0[row], a1[row], a2[row]);
+        break;
+    }
+
+    default:
+    {
+        double arg_values[Interpreter::MAX_ARG_SIZE];
+        for(size_t row=0; row < rows; row++)
+        {
+            for(unsigned int arg=0; arg < instruction.arg_size; arg++)
+                arg_values[arg] = slots[args[arg]][row];
+            dest[row] = Interpreter::call_primitive(instruction.function,
+                                                    instruction.arg_size,
+                                                    arg_values);
+        }
+        break;
+    }
+    }
+}
+
+void BytecodeVM::evaluate(const BytecodeProgram *program,
+                          const double* const* columns,
+                          double *out, size_t n)
+{
+    assert(program!=NULL);
+
+    const unsigned int num_constants = program->mConstants.size();
+    const unsigned int output_slot = program->mNumVariables + num_constants;
+    const unsigned int num_slots = output_slot + 1 + program->mNumRegisters;
+
+    // Constant blocks are filled once, the registers follow them
+    mScratch.resize((num_constants + program->mNumRegisters) * mBlockSize);
+    for(unsigned int i=0; i < num_constants; i++)
+        std::fill(&mScratch[i*mBlockSize], &mScratch[i*mBlockSize] + mBlockSize,
+                  program->mConstants[i]);
+
+    std::vector<double*> slots(num_slots);
+    for(unsigned int i=0; i < num_constants; i++)
+        slots[program->mNumVariables + i] = &mScratch[i*mBlockSize];
+    for(unsigned int i=0; i < program->mNumRegisters; i++)
+        slots[output_slot + 1 + i] = &mScratch[(num_constants + i)*mBlockSize];
+
+    const unsigned int *operands = program->mOperands.empty() ? NULL : &program->mOperands[0];
+
+    for(size_t block_start=0; block_start < n; block_start += mBlockSize)
+    {
+        const size_t rows = std::min((size_t)mBlockSize, n - block_start);
+
+        // The columns and the output are used in place
+        for(unsigned int var_index=0; var_index < program->mNumVariables; var_index++)
+            slots[var_index] = const_cast<double*>(columns[var_index] + block_start);
+        slots[output_slot] = out + block_start;
+
+        for(unsigned int i=0; i < program->mInstructions.size(); i++)
+        {
+            const BytecodeProgram::Instruction &instruction = program->mInstructions[i];
+            run_instruction(instruction, operands + instruction.first_arg, &slots[0], rows);
+        }
+    }
+}
+
+}
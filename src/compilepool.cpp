@@ -0,0 +1,255 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "compilepool.h"
+
+#include "threadpool.h"
+#include "moduleloader.h"
+#include "astnode.h"
+
+#include <cassert>
+#include <sstream>
+#include <algorithm>
+
+#include <llvm/Module.h>
+#include <llvm/LLVMContext.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/Threading.h>
+
+namespace shine
+{
+
+namespace
+{
+
+/**
+ * Creates the context, the module copy and the ModuleHandler
+ * of each worker, in the worker thread itself.
+ */
+class CreateWorkerTask : public ThreadTask
+{
+public:
+    CreateWorkerTask(const std::string &bitcode,
+                     const std::vector<std::string> &var_list,
+                     unsigned int num_workers,
+                     ModuleHandler::OptimizationProfile profile)
+    : mBitcode(bitcode), mVariableList(var_list), mProfile(profile),
+      mContexts(num_workers, (llvm::LLVMContext*)NULL),
+      mHandlers(num_workers, (ModuleHandler*)NULL),
+      mErrors(num_workers) {};
+
+    virtual void run(unsigned int worker_index)
+    {
+        llvm::LLVMContext *context = new llvm::LLVMContext();
+        mContexts[worker_index] = context;
+
+        llvm::MemoryBuffer *buffer =
+            llvm::MemoryBuffer::getMemBufferCopy(mBitcode, "shine_worker");
+
+        ModuleLoader *loader =
+            ModuleLoader::create_from_memory_buffer(buffer, mErrors[worker_index], context);
+        delete buffer;
+
+        if(!loader)
+            return;
+
+        ModuleHandler *handler =
+            ModuleHandler::create(loader->release_module(), mErrors[worker_index],
+                                  NULL, NULL, mProfile);
+        delete loader;
+
+        if(!handler)
+            return;
+
+        handler->set_variable_list(mVariableList);
+        mHandlers[worker_index] = handler;
+    }
+
+public:
+    const std::string &mBitcode;
+    const std::vector<std::string> &mVariableList;
+    ModuleHandler::OptimizationProfile mProfile;
+    std::vector<llvm::LLVMContext*> mContexts;
+    std::vector<ModuleHandler*> mHandlers;
+    std::vector<std::string> mErrors;
+};
+
+/**
+ * Compiles the population, each worker takes chunks of
+ * individuals until the entire population is compiled.
+ */
+class CompileTask : public ThreadTask
+{
+public:
+    CompileTask(const std::vector<std::vector<ASTNode*> > &population,
+                const std::string &name_prefix,
+                ModuleHandler::KernelType kernel_type,
+                unsigned int chunk_size,
+                std::vector<ModuleHandler*> &handlers)
+    : mPopulation(population), mNamePrefix(name_prefix),
+      mKernelType(kernel_type), mChunkSize(chunk_size),
+      mHandlers(handlers), mNextIndividual(0),
+      mFunctionPointers(population.size(), (void*)NULL)
+    { pthread_mutex_init(&mMutex, NULL); }
+
+    virtual ~CompileTask()
+    { pthread_mutex_destroy(&mMutex); }
+
+    virtual void run(unsigned int worker_index)
+    {
+        ModuleHandler *handler = mHandlers[worker_index];
+
+        while(true)
+        {
+            pthread_mutex_lock(&mMutex);
+            const unsigned int chunk_begin = mNextIndividual;
+            mNextIndividual += mChunkSize;
+            pthread_mutex_unlock(&mMutex);
+
+            if(chunk_begin >= mPopulation.size())
+                break;
+
+            unsigned int chunk_end = chunk_begin + mChunkSize;
+            if(chunk_end > mPopulation.size())
+                chunk_end = mPopulation.size();
+
+            const std::vector<std::vector<ASTNode*> >
+                chunk(mPopulation.begin()+chunk_begin, mPopulation.begin()+chunk_end);
+
+            // The functions live in different modules, but the chunk
+            // is in the name to keep it unique inside each worker
+            std::stringstream ss_prefix;
+            ss_prefix << mNamePrefix << chunk_begin << "_";
+
+            const std::vector<void*> chunk_ptrs =
+                handler->compile_population(chunk, ss_prefix.str(), mKernelType);
+
+            std::copy(chunk_ptrs.begin(), chunk_ptrs.end(),
+                      mFunctionPointers.begin()+chunk_begin);
+        }
+    }
+
+public:
+    const std::vector<std::vector<ASTNode*> > &mPopulation;
+    const std::string &mNamePrefix;
+    ModuleHandler::KernelType mKernelType;
+    unsigned int mChunkSize;
+    std::vector<ModuleHandler*> &mHandlers;
+
+    pthread_mutex_t mMutex;
+    unsigned int mNextIndividual;
+    std::vector<void*> mFunctionPointers;
+};
+
+}
+
+CompilePool::CompilePool(ThreadPool *thread_pool,
+                         const std::vector<llvm::LLVMContext*> &contexts,
+                         const std::vector<ModuleHandler*> &handlers)
+: mThreadPool(thread_pool), mContexts(contexts), mHandlers(handlers)
+{
+    assert(thread_pool && "No Thread Pool provided !");
+    assert(contexts.size()==handlers.size());
+}
+
+CompilePool::~CompilePool()
+{
+    delete mThreadPool;
+
+    // The handlers own the modules, and they must be
+    // destroyed before their contexts
+    for(unsigned int i=0; i < mHandlers.size(); i++)
+    {
+        delete mHandlers[i];
+        delete mContexts[i];
+    }
+}
+
+CompilePool *CompilePool::create(llvm::Module *module,
+                                 const std::vector<std::string> &var_list,
+                                 unsigned int num_workers,
+                                 std::string &error_string,
+                                 ModuleHandler::OptimizationProfile profile)
+{
+    assert(module && "No module provided !");
+    assert(num_workers>0);
+
+    if(!llvm::llvm_is_multithreaded() && !llvm::llvm_start_multithreaded())
+    {
+        error_string = "Error while creating Compile Pool: [ LLVM was built without threads support ]";
+        return NULL;
+    }
+
+    // The module is copied to each worker context
+    // through its bitcode
+    std::string bitcode;
+    llvm::raw_string_ostream bitcode_stream(bitcode);
+    llvm::WriteBitcodeToFile(module, bitcode_stream);
+    bitcode_stream.flush();
+
+    ThreadPool *thread_pool = new ThreadPool(num_workers);
+
+    CreateWorkerTask create_task(bitcode, var_list, num_workers, profile);
+    thread_pool->run(&create_task);
+
+    for(unsigned int i=0; i < num_workers; i++)
+    {
+        if(create_task.mHandlers[i])
+            continue;
+
+        error_string = "Error while creating worker: [ " + create_task.mErrors[i] + " ]";
+
+        delete thread_pool;
+        for(unsigned int j=0; j < num_workers; j++)
+        {
+            delete create_task.mHandlers[j];
+            delete create_task.mContexts[j];
+        }
+        return NULL;
+    }
+
+    return new CompilePool(thread_pool, create_task.mContexts,
+                           create_task.mHandlers);
+}
+
+std::vector<void*> CompilePool::compile_population(const std::vector<std::vector<ASTNode*> > &population,
+                                                   const std::string &name_prefix,
+                                                   ModuleHandler::KernelType kernel_type,
+                                                   unsigned int chunk_size)
+{
+    assert(chunk_size>0);
+
+    CompileTask compile_task(population, name_prefix, kernel_type,
+                             chunk_size, mHandlers);
+    mThreadPool->run(&compile_task);
+
+    return compile_task.mFunctionPointers;
+}
+
+bool CompilePool::free_jit_memory(void)
+{
+    bool ret_free = false;
+    for(unsigned int i=0; i < mHandlers.size(); i++)
+        ret_free |= mHandlers[i]->free_jit_memory();
+    return ret_free;
+}
+
+}
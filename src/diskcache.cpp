@@ -0,0 +1,231 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "diskcache.h"
+
+#include "astnode.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <llvm/Support/Host.h>
+
+namespace shine
+{
+
+/**
+ * Hashes the string with the 64-bit FNV-1a hash, starting from \p hash.
+ */
+static uint64_t hash_string(uint64_t hash, const std::string &value)
+{
+    for(unsigned int i=0; i < value.size(); i++)
+    {
+        hash ^= static_cast<unsigned char>(value[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    // The separator, so that different sequences can't have the same bytes
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+/**
+ * Returns the hash as 16 hexadecimal digits.
+ */
+static std::string hash_hex(uint64_t hash)
+{
+    std::stringstream ss_hex;
+    ss_hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return ss_hex.str();
+}
+
+/**
+ * Creates the directory if it doesn't exist.
+ */
+static bool make_directory(const std::string &directory, std::string &error_string)
+{
+    if(mkdir(directory.c_str(), 0755)==0 || errno==EEXIST)
+        return true;
+
+    error_string = "Error while creating the cache directory: " + directory;
+    return false;
+}
+
+/**
+ * Reads the entire file.
+ */
+static bool read_file(const std::string &path, std::string &content)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if(!file)
+        return false;
+
+    std::stringstream ss_content;
+    ss_content << file.rdbuf();
+    content = ss_content.str();
+    return true;
+}
+
+/**
+ * Writes the entire file, using a temporary file renamed at the
+ * end, so the other processes never read a partial file.
+ */
+static bool write_file(const std::string &path, const std::string &content)
+{
+    std::stringstream ss_temp;
+    ss_temp << path << ".tmp" << getpid();
+    const std::string temp_path = ss_temp.str();
+
+    std::ofstream file(temp_path.c_str(), std::ios::out | std::ios::binary);
+    if(!file)
+        return false;
+
+    file.write(content.data(), content.size());
+    file.close();
+
+    if(!file || std::rename(temp_path.c_str(), path.c_str())!=0)
+    {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+DiskCache::DiskCache(ModuleHandler *handler, const std::string &directory,
+                     ModuleHandler::KernelType kernel_type)
+: mHandler(handler), mDirectory(directory), mKernelType(kernel_type),
+  mHits(0), mMisses(0), mUnstored(0)
+{
+    assert(handler && "No Module Handler provided !");
+}
+
+DiskCache *DiskCache::create(ModuleHandler *handler,
+                             const std::string &directory,
+                             std::string &error_string,
+                             ModuleHandler::KernelType kernel_type)
+{
+    assert(handler && "No Module Handler provided !");
+    assert(handler->get_variable_list().size()>0);
+
+    // Everything changing the generated code, except the tree
+    std::stringstream ss_context;
+    ss_context << handler->get_primitive_hash() << " "
+               << kernel_type << " " << handler->get_profile() << " "
+               << handler->get_precision();
+
+    uint64_t context_hash = hash_string(14695981039346656037ULL, ss_context.str());
+    context_hash = hash_string(context_hash, llvm::sys::getHostTriple());
+    context_hash = hash_string(context_hash, llvm::sys::getHostCPUName());
+
+    const std::vector<std::string> var_list = handler->get_variable_list();
+    for(unsigned int var_index=0; var_index < var_list.size(); var_index++)
+        context_hash = hash_string(context_hash, var_list[var_index]);
+
+    const std::string context_directory = directory + "/" + hash_hex(context_hash);
+
+    if(!make_directory(directory, error_string) ||
+       !make_directory(context_directory, error_string))
+        return NULL;
+
+    return new DiskCache(handler, context_directory, kernel_type);
+}
+
+llvm::Function *DiskCache::load_function(const std::string &path,
+                                         const std::string &key,
+                                         const std::string &func_name)
+{
+    // The entry is the key size, the key and the bitcode
+    std::string entry;
+    if(!read_file(path + ".entry", entry))
+        return NULL;
+
+    const std::string::size_type key_begin = entry.find('\n') + 1;
+    if(key_begin==0 || std::atol(entry.substr(0, key_begin-1).c_str())!=(long)key.size())
+        return NULL;
+
+    // The key resolves the hash collisions
+    if(entry.compare(key_begin, key.size(), key)!=0)
+        return NULL;
+
+    std::string error_string;
+    return mHandler->link_function_bitcode(entry.substr(key_begin + key.size()),
+                                           func_name, error_string);
+}
+
+bool DiskCache::store_function(const std::string &path,
+                               const std::string &key,
+                               const std::string &func_name)
+{
+    std::string bitcode;
+    std::string error_string;
+    if(!mHandler->get_function_bitcode(func_name, bitcode, error_string))
+        return false;
+
+    // The key and the bitcode are renamed into place together, so
+    // the processes storing the same hash never mix their entries
+    std::stringstream ss_entry;
+    ss_entry << key.size() << "\n" << key << bitcode;
+    return write_file(path + ".entry", ss_entry.str());
+}
+
+void *DiskCache::get_function(const std::vector<ASTNode*> *ast_nodes,
+                              const std::string &func_name)
+{
+    const std::string key = ASTNode::structural_key(ast_nodes);
+    const std::string path =
+        mDirectory + "/" + hash_hex(ASTNode::structural_hash(ast_nodes));
+
+    if(load_function(path, key, func_name))
+    {
+        mHits++;
+        return mHandler->jit_function(func_name);
+    }
+
+    mMisses++;
+
+    llvm::Function *function = NULL;
+    if(mKernelType==ModuleHandler::KERNEL_BATCH)
+        function = mHandler->codegen_ast_batch(ast_nodes, func_name);
+    else
+        function = mHandler->codegen_ast(ast_nodes, func_name);
+
+    if(!function)
+        return NULL;
+
+    // The return value only tells whether the passes changed the function
+    mHandler->run_function_passes(func_name);
+
+    if(!store_function(path, key, func_name))
+        mUnstored++;
+
+    return mHandler->jit_function(func_name);
+}
+
+}
@@ -0,0 +1,232 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "evaluator.h"
+
+#include "threadpool.h"
+
+#include <cassert>
+#include <stdint.h>
+
+#include <llvm/Support/Atomic.h>
+
+namespace shine
+{
+
+namespace
+{
+
+/**
+ * Combines two partial errors of the same metric, the mean metrics
+ * are combined as sums weighted by the number of rows and divided
+ * at the end.
+ */
+double combine_errors(double error, double partial_error,
+                      ModuleHandler::FitnessMetric metric)
+{
+    if(metric!=ModuleHandler::FITNESS_MAX_ABS)
+        return error + partial_error;
+
+    // NaN errors must stick
+    if(error!=error || partial_error!=partial_error)
+        return error + partial_error;
+
+    return (partial_error > error) ? partial_error : error;
+}
+
+/**
+ * Base class of the evaluation tasks, the work is a sequence of
+ * (kernel, chunk) items claimed atomically by the threads.
+ */
+class ChunkTask : public ThreadTask
+{
+public:
+    ChunkTask(const std::vector<const double*> &columns,
+              size_t n, size_t chunk_size, unsigned int num_kernels)
+    : mColumns(columns), mRows(n), mChunkSize(chunk_size),
+      mNumChunks((n + chunk_size - 1) / chunk_size),
+      mNumItems(mNumChunks * num_kernels), mNextItem(0) {};
+
+    virtual void run(unsigned int worker_index)
+    {
+        // The column pointers of the chunk are
+        // private to each thread
+        std::vector<const double*> chunk_columns(mColumns.size());
+
+        while(true)
+        {
+            const size_t item = llvm::sys::AtomicAdd(&mNextItem, 1) - 1;
+            if(item >= mNumItems)
+                break;
+
+            const unsigned int kernel_index = item / mNumChunks;
+            const size_t chunk_begin = (item % mNumChunks) * mChunkSize;
+            size_t chunk_rows = mChunkSize;
+            if(chunk_begin + chunk_rows > mRows)
+                chunk_rows = mRows - chunk_begin;
+
+            for(unsigned int i=0; i < mColumns.size(); i++)
+                chunk_columns[i] = mColumns[i] + chunk_begin;
+
+            run_chunk(worker_index, kernel_index, chunk_begin, chunk_rows,
+                      chunk_columns.empty() ? NULL : &chunk_columns[0]);
+        }
+    }
+
+    /**
+     * Evaluates a chunk of a kernel.
+     */
+    virtual void run_chunk(unsigned int worker_index, unsigned int kernel_index,
+                           size_t chunk_begin, size_t chunk_rows,
+                           const double* const* chunk_columns) = 0;
+
+protected:
+    const std::vector<const double*> &mColumns;
+    size_t mRows;
+    size_t mChunkSize;
+    size_t mNumChunks;
+    size_t mNumItems;
+    volatile llvm::sys::cas_flag mNextItem;
+};
+
+/**
+ * Evaluates a batch kernel writing its output.
+ */
+class BatchTask : public ChunkTask
+{
+public:
+    BatchTask(Evaluator::BatchKernel kernel,
+              const std::vector<const double*> &columns,
+              size_t n, size_t chunk_size, double *out)
+    : ChunkTask(columns, n, chunk_size, 1), mKernel(kernel), mOut(out) {};
+
+    virtual void run_chunk(unsigned int worker_index, unsigned int kernel_index,
+                           size_t chunk_begin, size_t chunk_rows,
+                           const double* const* chunk_columns)
+    { mKernel(chunk_columns, mOut + chunk_begin, chunk_rows); }
+
+private:
+    Evaluator::BatchKernel mKernel;
+    double *mOut;
+};
+
+/**
+ * Evaluates fitness kernels, each thread keeps its
+ * partial error for each kernel.
+ */
+class FitnessTask : public ChunkTask
+{
+public:
+    FitnessTask(const std::vector<void*> &kernels,
+                const std::vector<const double*> &columns,
+                const double *target, size_t n, size_t chunk_size,
+                ModuleHandler::FitnessMetric metric, unsigned int num_threads)
+    : ChunkTask(columns, n, chunk_size, kernels.size()), mKernels(kernels),
+      mTarget(target), mMetric(metric),
+      mPartialErrors(num_threads, std::vector<double>(kernels.size(), 0.0)) {};
+
+    virtual void run_chunk(unsigned int worker_index, unsigned int kernel_index,
+                           size_t chunk_begin, size_t chunk_rows,
+                           const double* const* chunk_columns)
+    {
+        Evaluator::FitnessKernel kernel =
+            (Evaluator::FitnessKernel)(intptr_t)mKernels[kernel_index];
+
+        double chunk_error = kernel(chunk_columns, mTarget + chunk_begin, chunk_rows);
+
+        if(mMetric==ModuleHandler::FITNESS_MSE || mMetric==ModuleHandler::FITNESS_MAE)
+            chunk_error *= chunk_rows;
+
+        double &error = mPartialErrors[worker_index][kernel_index];
+        error = combine_errors(error, chunk_error, mMetric);
+    }
+
+    std::vector<double> get_errors() const
+    {
+        std::vector<double> errors(mKernels.size(), 0.0);
+        for(unsigned int i=0; i < mPartialErrors.size(); i++)
+            for(unsigned int j=0; j < errors.size(); j++)
+                errors[j] = combine_errors(errors[j], mPartialErrors[i][j], mMetric);
+
+        if(mRows > 0 && (mMetric==ModuleHandler::FITNESS_MSE || mMetric==ModuleHandler::FITNESS_MAE))
+            for(unsigned int j=0; j < errors.size(); j++)
+                errors[j] /= mRows;
+
+        return errors;
+    }
+
+private:
+    const std::vector<void*> &mKernels;
+    const double *mTarget;
+    ModuleHandler::FitnessMetric mMetric;
+    std::vector<std::vector<double> > mPartialErrors;
+};
+
+}
+
+Evaluator::Evaluator(unsigned int num_threads, size_t chunk_size)
+: mChunkSize(chunk_size)
+{
+    assert(chunk_size>0);
+    mThreadPool = new ThreadPool(num_threads);
+}
+
+Evaluator::~Evaluator()
+{
+    delete mThreadPool;
+}
+
+unsigned int Evaluator::get_num_threads() const
+{
+    return mThreadPool->get_num_threads();
+}
+
+void Evaluator::evaluate(void *batch_kernel,
+                         const std::vector<const double*> &columns,
+                         size_t n, double *out)
+{
+    assert(batch_kernel!=NULL);
+
+    BatchTask task((BatchKernel)(intptr_t)batch_kernel, columns,
+                   n, mChunkSize, out);
+    mThreadPool->run(&task);
+}
+
+double Evaluator::evaluate_fitness(void *fitness_kernel,
+                                   const std::vector<const double*> &columns,
+                                   const double *target, size_t n,
+                                   ModuleHandler::FitnessMetric metric)
+{
+    std::vector<void*> fitness_kernels(1, fitness_kernel);
+    return evaluate_fitness(fitness_kernels, columns, target, n, metric)[0];
+}
+
+std::vector<double> Evaluator::evaluate_fitness(const std::vector<void*> &fitness_kernels,
+                                                const std::vector<const double*> &columns,
+                                                const double *target, size_t n,
+                                                ModuleHandler::FitnessMetric metric)
+{
+    FitnessTask task(fitness_kernels, columns, target, n, mChunkSize,
+                     metric, mThreadPool->get_num_threads());
+    mThreadPool->run(&task);
+
+    return task.get_errors();
+}
+
+}
@@ -0,0 +1,185 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "functioncache.h"
+
+#include "astnode.h"
+
+#include <cassert>
+#include <sstream>
+
+namespace shine
+{
+
+FunctionCache::FunctionCache(ModuleHandler *handler,
+                             ModuleHandler::KernelType kernel_type)
+: mHandler(handler), mKernelType(kernel_type), mNumEntries(0),
+  mHits(0), mMisses(0)
+{
+    assert(handler && "No Module Handler provided !");
+}
+
+FunctionCache::CacheEntry *FunctionCache::find_entry(uint64_t hash, unsigned int context,
+                                                     const std::vector<ASTNode*> *ast_nodes,
+                                                     std::string &key)
+{
+    CacheMap::iterator bucket_it = mCache.find(hash);
+    if(bucket_it==mCache.end())
+        return NULL;
+
+    if(key.empty())
+        key = ASTNode::structural_key(ast_nodes);
+
+    std::vector<CacheEntry> &bucket = bucket_it->second;
+    for(unsigned int i=0; i < bucket.size(); i++)
+        if(bucket[i].context==context && bucket[i].key==key)
+            return &bucket[i];
+
+    return NULL;
+}
+
+unsigned int FunctionCache::get_context()
+{
+    std::stringstream ss_context;
+    ss_context << mHandler->get_precision() << " " << mHandler->get_profile() << " "
+               << mHandler->get_force_inline();
+
+    const std::vector<std::string> var_list = mHandler->get_variable_list();
+    for(unsigned int var_index=0; var_index < var_list.size(); var_index++)
+        ss_context << " " << var_list[var_index];
+
+    const std::string context = ss_context.str();
+    for(unsigned int i=0; i < mContexts.size(); i++)
+        if(mContexts[i]==context)
+            return i;
+
+    mContexts.push_back(context);
+    return mContexts.size()-1;
+}
+
+void FunctionCache::insert_entry(uint64_t hash, const CacheEntry &entry)
+{
+    mCache[hash].push_back(entry);
+    mNumEntries++;
+}
+
+void *FunctionCache::get_function(const std::vector<ASTNode*> *ast_nodes)
+{
+    const std::vector<std::vector<ASTNode*> > population(1, *ast_nodes);
+    return compile_population(population)[0];
+}
+
+std::vector<void*> FunctionCache::compile_population(const std::vector<std::vector<ASTNode*> > &population)
+{
+    std::vector<void*> func_ptrs(population.size(), (void*)NULL);
+
+    std::vector<uint64_t> hash_list(population.size());
+    std::vector<std::string> key_list(population.size());
+
+    // The trees not found in the cache, without duplicates, and
+    // the individuals waiting for each one of them
+    std::vector<std::vector<ASTNode*> > miss_population;
+    std::vector<unsigned int> miss_individuals;
+    std::vector<std::vector<unsigned int> > miss_waiting;
+
+    typedef tr1impl::unordered_map<std::string, unsigned int> MissMap;
+    MissMap miss_map;
+
+    const unsigned int context = get_context();
+
+    for(unsigned int i=0; i < population.size(); i++)
+    {
+        hash_list[i] = ASTNode::structural_hash(&population[i]);
+
+        const CacheEntry *entry =
+            find_entry(hash_list[i], context, &population[i], key_list[i]);
+        if(entry)
+        {
+            func_ptrs[i] = entry->function;
+            mHits++;
+            continue;
+        }
+
+        // The key of the new entry
+        if(key_list[i].empty())
+            key_list[i] = ASTNode::structural_key(&population[i]);
+
+        MissMap::iterator miss_it = miss_map.find(key_list[i]);
+        if(miss_it!=miss_map.end())
+        {
+            // Duplicated inside the population
+            miss_waiting[miss_it->second].push_back(i);
+            mHits++;
+            continue;
+        }
+
+        miss_map.insert(std::make_pair(key_list[i], miss_population.size()));
+        miss_population.push_back(population[i]);
+        miss_individuals.push_back(i);
+        miss_waiting.push_back(std::vector<unsigned int>());
+        mMisses++;
+    }
+
+    if(miss_population.empty())
+        return func_ptrs;
+
+    const std::string prefix = mHandler->get_unique_prefix("shine_cached_");
+
+    const std::vector<void*> miss_ptrs =
+        mHandler->compile_population(miss_population, prefix, mKernelType);
+
+    for(unsigned int i=0; i < miss_ptrs.size(); i++)
+    {
+        const unsigned int individual = miss_individuals[i];
+        func_ptrs[individual] = miss_ptrs[i];
+
+        for(unsigned int j=0; j < miss_waiting[i].size(); j++)
+            func_ptrs[miss_waiting[i][j]] = miss_ptrs[i];
+
+        if(!miss_ptrs[i])
+            continue;
+
+        std::stringstream ss_name;
+        ss_name << prefix << i;
+
+        CacheEntry entry;
+        entry.key = key_list[individual];
+        entry.context = context;
+        entry.func_name = ss_name.str();
+        entry.function = miss_ptrs[i];
+        insert_entry(hash_list[individual], entry);
+    }
+
+    return func_ptrs;
+}
+
+void FunctionCache::clear()
+{
+    for(CacheMap::const_iterator it = mCache.begin(); it != mCache.end(); it++)
+    {
+        const std::vector<CacheEntry> &bucket = it->second;
+        for(unsigned int i=0; i < bucket.size(); i++)
+            mHandler->free_jit_memory(bucket[i].func_name);
+    }
+
+    mCache.clear();
+    mNumEntries = 0;
+}
+
+}
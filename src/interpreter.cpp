@@ -0,0 +1,216 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "interpreter.h"
+
+#include "modulehandler.h"
+#include "astnode.h"
+
+#include <cassert>
+#include <stdint.h>
+
+namespace shine
+{
+
+Interpreter::Interpreter(ModuleHandler *handler)
+: mHandler(handler)
+{
+    assert(handler && "No Module Handler provided !");
+}
+
+double Interpreter::call_primitive(void *function, unsigned int arg_size,
+                                   const double *args)
+{
+    typedef double (*F0)();
+    typedef double (*F1)(double);
+    typedef double (*F2)(double, double);
+    typedef double (*F3)(double, double, double);
+    typedef double (*F4)(double, double, double, double);
+    typedef double (*F5)(double, double, double, double, double);
+    typedef double (*F6)(double, double, double, double, double, double);
+    typedef double (*F7)(double, double, double, double, double, double, double);
+    typedef double (*F8)(double, double, double, double, double, double, double, double);
+
+    const intptr_t f = (intptr_t)function;
+
+    switch(arg_size)
+    {
+    case 0: return ((F0)f)();
+    case 1: return ((F1)f)(args[0]);
+    case 2: return ((F2)f)(args[0], args[1]);
+    case 3: return ((F3)f)(args[0], args[1], args[2]);
+    case 4: return ((F4)f)(args[0], args[1], args[2], args[3]);
+    case 5: return ((F5)f)(args[0], args[1], args[2], args[3], args[4]);
+    case 6: return ((F6)f)(args[0], args[1], args[2], args[3], args[4], args[5]);
+    case 7: return ((F7)f)(args[0], args[1], args[2], args[3], args[4], args[5], args[6]);
+    case 8: return ((F8)f)(args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7]);
+    default:
+        assert(false && "Too many primitive arguments !");
+        return 0.0;
+    }
+}
+
+bool Interpreter::resolve(const std::vector<ASTNode*> *ast_nodes,
+                          std::vector<Operation> &operations,
+                          std::string &error_string)
+{
+    operations.resize(ast_nodes->size());
+
+    for(unsigned int i=0; i < ast_nodes->size(); i++)
+    {
+        const ASTNode *node = (*ast_nodes)[ast_nodes->size()-1-i];
+        Operation &operation = operations[i];
+        operation.type = node->get_id();
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_CONSTANT:
+            operation.value = static_cast<const ASTConstant*>(node)->get_value();
+            break;
+
+        case ASTNode::AST_VARIABLE:
+        {
+            // The handler list is the current one, it can change between trees
+            const std::string &var_name = static_cast<const ASTVariable*>(node)->get_name();
+            const int symbol = mHandler->get_variable_symbol(var_name);
+            if(symbol==ASTNode::NO_SYMBOL)
+            {
+                error_string = "Variable not found: " + var_name;
+                return false;
+            }
+
+            operation.index = symbol;
+            break;
+        }
+
+        case ASTNode::AST_FUNCTION:
+        {
+            const std::string func_name = static_cast<const ASTFunction*>(node)->get_name();
+
+            PrimitiveMap::iterator prim_it = mPrimitives.find(func_name);
+            if(prim_it==mPrimitives.end())
+            {
+                Primitive primitive;
+                primitive.function = mHandler->get_primitive_pointer(func_name, &primitive.arg_size);
+                if(!primitive.function)
+                {
+                    error_string = "Function not found: " + func_name;
+                    return false;
+                }
+
+                if(primitive.arg_size > MAX_ARG_SIZE)
+                {
+                    error_string = "Too many primitive arguments: " + func_name;
+                    return false;
+                }
+
+                prim_it = mPrimitives.insert(std::make_pair(func_name, primitive)).first;
+            }
+
+            operation.function = prim_it->second.function;
+            operation.index = prim_it->second.arg_size;
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+double Interpreter::run(const std::vector<Operation> &operations,
+                        const double *values,
+                        std::vector<double> &stack)
+{
+    stack.clear();
+
+    double args[MAX_ARG_SIZE];
+    for(unsigned int i=0; i < operations.size(); i++)
+    {
+        const Operation &operation = operations[i];
+
+        switch(operation.type)
+        {
+        case ASTNode::AST_CONSTANT:
+            stack.push_back(operation.value);
+            break;
+
+        case ASTNode::AST_VARIABLE:
+            stack.push_back(values[operation.index]);
+            break;
+
+        case ASTNode::AST_FUNCTION:
+            // The first argument is on the top of the stack
+            for(unsigned int arg=0; arg < operation.index; arg++)
+            {
+                args[arg] = stack.back();
+                stack.pop_back();
+            }
+            stack.push_back(call_primitive(operation.function, operation.index, args));
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    assert(stack.size()==1);
+    return stack.back();
+}
+
+bool Interpreter::evaluate(const std::vector<ASTNode*> *ast_nodes,
+                           const double *row, double &value,
+                           std::string &error_string)
+{
+    std::vector<Operation> operations;
+    if(!resolve(ast_nodes, operations, error_string))
+        return false;
+
+    std::vector<double> stack;
+    value = run(operations, row, stack);
+    return true;
+}
+
+bool Interpreter::evaluate_batch(const std::vector<ASTNode*> *ast_nodes,
+                                 const double* const* columns,
+                                 double *out, size_t n,
+                                 std::string &error_string)
+{
+    std::vector<Operation> operations;
+    if(!resolve(ast_nodes, operations, error_string))
+        return false;
+
+    std::vector<double> stack;
+    stack.reserve(ast_nodes->size());
+
+    std::vector<double> values(mHandler->get_variable_count());
+    for(size_t row=0; row < n; row++)
+    {
+        for(unsigned int var_index=0; var_index < values.size(); var_index++)
+            values[var_index] = columns[var_index][row];
+
+        out[row] = run(operations, values.empty() ? NULL : &values[0], stack);
+    }
+
+    return true;
+}
+
+}
@@ -20,25 +20,376 @@
 #include "modulehandler.h"
 
 #include "modulelinker.h"
+#include "moduleloader.h"
 #include "astnode.h"
+#include "astarena.h"
 
 #include <cassert>
 #include <sstream>
+#include <sys/time.h>
 
 #include <llvm/Module.h>
 #include <llvm/Support/StandardPasses.h>
 #include <llvm/LinkAllPasses.h>
 #include <llvm/LLVMContext.h>
+#include <llvm/Metadata.h>
 #include <llvm/Support/IRBuilder.h>
 #include <llvm/Constants.h>
+#include <llvm/DerivedTypes.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/JIT.h>
+#include <llvm/ExecutionEngine/JITEventListener.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Target/TargetSelect.h>
 #include <llvm/Target/TargetData.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Support/InstIterator.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/Linker.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/Support/CallSite.h>
 
 namespace shine
 {
+
+/**
+ * Returns the wall clock time, in seconds.
+ */
+static double wall_time()
+{
+    struct timeval time_value;
+    gettimeofday(&time_value, NULL);
+    return time_value.tv_sec + time_value.tv_usec * 1e-6;
+}
+
+/**
+ * Returns the number of IR instructions of the function.
+ */
+static unsigned long count_instructions(const llvm::Function *func)
+{
+    unsigned long instructions = 0;
+    for(llvm::Function::const_iterator block_it = func->begin();
+        block_it != func->end(); ++block_it)
+        instructions += block_it->size();
+    return instructions;
+}
+
+/**
+ * Returns the number of calls in the function, except the intrinsics.
+ */
+static unsigned int count_calls(const llvm::Function *func)
+{
+    unsigned int call_count = 0;
+
+    for(llvm::const_inst_iterator inst_it = llvm::inst_begin(func);
+        inst_it != llvm::inst_end(func); ++inst_it)
+    {
+        llvm::ImmutableCallSite call_site(&*inst_it);
+        if(!call_site)
+            continue;
+
+        const llvm::Function *callee = call_site.getCalledFunction();
+        if(!callee || !callee->isIntrinsic())
+            call_count++;
+    }
+
+    return call_count;
+}
+
+/**
+ * Converts the floating point value to the type, extending or
+ * truncating it depending on the two types.
+ */
+static llvm::Value *convert_fp(llvm::IRBuilder<> &builder, llvm::Value *value,
+                               const llvm::Type *type)
+{
+    const llvm::Type *value_type = value->getType();
+    if(value_type==type)
+        return value;
+
+    if(value_type->getPrimitiveSizeInBits() < type->getPrimitiveSizeInBits())
+        return builder.CreateFPExt(value, type);
+    return builder.CreateFPTrunc(value, type);
+}
+
+/**
+ * The maximum depth of the primitives inlined into the primitives,
+ * the recursive primitives themselves are never inlined.
+ */
+static const unsigned int MAX_INLINE_DEPTH = 16;
+
+/**
+ * Writes the string as a JSON string.
+ */
+static void print_json_string(std::ostream &stream, const std::string &value)
+{
+    stream << '"';
+    for(unsigned int i=0; i < value.size(); i++)
+    {
+        if(value[i]=='"' || value[i]=='\\')
+            stream << '\\';
+        stream << value[i];
+    }
+    stream << '"';
+}
+
+namespace
+{
+
+/**
+ * Records the machine code emitted and free'd by the JIT,
+ * used by the compile statistics.
+ */
+class StatsListener : public llvm::JITEventListener
+{
+public:
+    StatsListener()
+    : mEmittedBytes(0), mLiveBytes(0) {};
+    virtual ~StatsListener() {};
+
+    virtual void NotifyFunctionEmitted(const llvm::Function &function,
+                                       void *code, size_t size,
+                                       const EmittedFunctionDetails &details)
+    {
+        mFunctionBytes[&function] = size;
+        mCodeBytes[code] = size;
+        mEmittedBytes += size;
+        mLiveBytes += size;
+    }
+
+    virtual void NotifyFreeingMachineCode(void *old_ptr)
+    {
+        std::map<void*, size_t>::iterator code_it = mCodeBytes.find(old_ptr);
+        if(code_it==mCodeBytes.end())
+            return;
+
+        mLiveBytes -= code_it->second;
+        mCodeBytes.erase(code_it);
+    }
+
+    /**
+     * Returns the machine code bytes emitted since the last call.
+     */
+    unsigned long take_emitted_bytes()
+    {
+        const unsigned long emitted_bytes = mEmittedBytes;
+        mEmittedBytes = 0;
+        return emitted_bytes;
+    }
+
+    /**
+     * Returns the machine code bytes of the last emission of the function.
+     */
+    unsigned long get_function_bytes(const llvm::Function *function) const
+    {
+        std::map<const llvm::Function*, size_t>::const_iterator func_it =
+            mFunctionBytes.find(function);
+        return (func_it!=mFunctionBytes.end()) ? func_it->second : 0;
+    }
+
+    /**
+     * Forgets the function, before it is erased from the module.
+     */
+    void forget_function(const llvm::Function *function)
+    { mFunctionBytes.erase(function); }
+
+    unsigned long get_live_bytes() const
+    { return mLiveBytes; }
+
+private:
+    std::map<const llvm::Function*, size_t> mFunctionBytes;
+    std::map<void*, size_t> mCodeBytes;
+    unsigned long mEmittedBytes;
+    unsigned long mLiveBytes;
+};
+
+/**
+ * The memory effect of a function, from the weakest to the strongest.
+ */
+enum FunctionEffect
+{
+    EFFECT_NONE, /**< Doesn't access memory (readnone) */
+    EFFECT_READ, /**< Only reads memory (readonly) */
+    EFFECT_ANY   /**< May write memory */
+};
+
+/**
+ * The inferred attributes of a function.
+ */
+struct FunctionAttributes
+{
+    FunctionEffect effect;
+    bool no_unwind;
+};
+
+typedef std::map<const llvm::Function*, FunctionAttributes> AttributeMap;
+
+}
+
+/**
+ * Returns the attributes of the called function, the inferred ones
+ * if it is in \p inferred, otherwise the ones declared.
+ */
+static FunctionAttributes get_callee_attributes(const llvm::Function *callee,
+                                                const AttributeMap &inferred)
+{
+    AttributeMap::const_iterator attr_it = inferred.find(callee);
+    if(attr_it!=inferred.end())
+        return attr_it->second;
+
+    FunctionAttributes attributes;
+    attributes.effect = callee->doesNotAccessMemory() ? EFFECT_NONE :
+                        (callee->onlyReadsMemory() ? EFFECT_READ : EFFECT_ANY);
+    attributes.no_unwind = callee->doesNotThrow();
+    return attributes;
+}
+
+/**
+ * Infers the attributes of the function body: the memory accessed
+ * through the stack allocations and the constant globals doesn't count,
+ * and the calls have the attributes of the called functions. The first
+ * reason of the effect found is stored in \p reason.
+ */
+static FunctionAttributes get_body_attributes(const llvm::Function *func,
+                                              const AttributeMap &inferred,
+                                              std::string &reason)
+{
+    FunctionAttributes attributes;
+    attributes.effect = EFFECT_NONE;
+    attributes.no_unwind = true;
+
+    for(llvm::const_inst_iterator inst_it = llvm::inst_begin(func);
+        inst_it != llvm::inst_end(func); ++inst_it)
+    {
+        const llvm::Instruction *inst = &*inst_it;
+        FunctionEffect effect = EFFECT_NONE;
+        std::string effect_reason;
+
+        if(llvm::isa<llvm::UnwindInst>(inst) || llvm::isa<llvm::InvokeInst>(inst))
+            attributes.no_unwind = false;
+
+        llvm::ImmutableCallSite call_site(inst);
+        if(call_site)
+        {
+            const llvm::Function *callee = call_site.getCalledFunction();
+            if(!callee)
+            {
+                effect = EFFECT_ANY;
+                effect_reason = "indirect call";
+                attributes.no_unwind = false;
+            }
+            else
+            {
+                const FunctionAttributes callee_attributes =
+                    get_callee_attributes(callee, inferred);
+                effect = callee_attributes.effect;
+                effect_reason = "calls " + callee->getNameStr();
+                attributes.no_unwind = attributes.no_unwind &&
+                    (callee_attributes.no_unwind || call_site.doesNotThrow());
+            }
+        }
+        else if(const llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(inst))
+        {
+            const llvm::Value *object = llvm::GetUnderlyingObject(load->getPointerOperand());
+            const llvm::GlobalVariable *global = llvm::dyn_cast<llvm::GlobalVariable>(object);
+
+            if(load->isVolatile())
+                effect = EFFECT_ANY;
+            else if(!llvm::isa<llvm::AllocaInst>(object) && !(global && global->isConstant()))
+                effect = EFFECT_READ;
+            effect_reason = "reads memory";
+        }
+        else if(const llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(inst))
+        {
+            const llvm::Value *object = llvm::GetUnderlyingObject(store->getPointerOperand());
+
+            if(store->isVolatile() || !llvm::isa<llvm::AllocaInst>(object))
+                effect = EFFECT_ANY;
+            effect_reason = "writes memory";
+        }
+        else if(inst->mayWriteToMemory())
+        {
+            effect = EFFECT_ANY;
+            effect_reason = "writes memory";
+        }
+        else if(inst->mayReadFromMemory())
+        {
+            effect = EFFECT_READ;
+            effect_reason = "reads memory";
+        }
+
+        if(effect > attributes.effect)
+        {
+            attributes.effect = effect;
+            reason = effect_reason;
+        }
+    }
+
+    return attributes;
+}
+
+/**
+ * Loads the column pointers of a batch kernel, the column pointers
+ * are loop invariant, so they are loaded only once before the loop.
+ */
+static std::vector<llvm::Value*> load_column_list(llvm::IRBuilder<> &builder,
+                                                  llvm::Value *columns,
+                                                  const std::vector<std::string> &var_list)
+{
+    const llvm::Type *index_type = llvm::Type::getInt32Ty(builder.getContext());
+
+    std::vector<llvm::Value*> column_list;
+    for(unsigned int var_index=0; var_index < var_list.size(); var_index++)
+    {
+        llvm::Value *column_ptr =
+            builder.CreateGEP(columns, llvm::ConstantInt::get(index_type, var_index));
+        column_list.push_back(builder.CreateLoad(column_ptr, var_list[var_index] + "_column"));
+    }
+    return column_list;
+}
+
+/**
+ * Loads the values of the row \p index from the columns, in
+ * the order of the variable list.
+ */
+static void load_row_values(llvm::IRBuilder<> &builder,
+                            const std::vector<llvm::Value*> &column_list,
+                            llvm::Value *index,
+                            const std::vector<std::string> &var_list,
+                            std::vector<llvm::Value*> &variable_values)
+{
+    variable_values.resize(var_list.size());
+    for(unsigned int var_index=0; var_index < var_list.size(); var_index++)
+    {
+        llvm::Value *var_ptr = builder.CreateGEP(column_list[var_index], index);
+        variable_values[var_index] = builder.CreateLoad(var_ptr, var_list[var_index]);
+    }
+}
+
+/**
+ * Loads the parameters, the values are indexed by the node
+ * index of their constants (see ModuleHandler::get_parameter_layout()).
+ */
+static void load_parameter_values(llvm::IRBuilder<> &builder,
+                                  llvm::Value *params,
+                                  const std::vector<ASTNode*> *ast_nodes,
+                                  const std::vector<unsigned int> &param_layout,
+                                  std::vector<llvm::Value*> &constant_values)
+{
+    const llvm::Type *index_type = llvm::Type::getInt32Ty(builder.getContext());
+
+    constant_values.assign(ast_nodes->size(), (llvm::Value*)NULL);
+    for(unsigned int param=0; param < param_layout.size(); param++)
+    {
+        llvm::Value *param_ptr =
+            builder.CreateGEP(params, llvm::ConstantInt::get(index_type, param));
+        constant_values[param_layout[param]] = builder.CreateLoad(param_ptr, "param");
+    }
+}
+
 ModuleHandler::ModuleHandler(llvm::Module *module,
                              llvm::ExecutionEngine *execution_engine,
                              llvm::PassManager *pass_manager,
@@ -53,22 +404,131 @@ ModuleHandler::ModuleHandler(llvm::Module *module,
     mExecutionEngine = execution_engine;
     mPassManager = pass_manager;
     mFunctionPassManager = func_pass_manager;
+
+    mSubtreeSharing = false;
+    mForceInline = false;
+    mMaterializeFailed = false;
+    mPrecision = PRECISION_DOUBLE;
+    mGeneratedNodes = 0;
+    mDeduplicatedNodes = 0;
+    mUniquePrefixCount = 0;
+    mAttributesInferred = false;
+
+    mProfile = PROFILE_MAX_THROUGHPUT;
+    for(unsigned int i=0; i <= PROFILE_MAX_THROUGHPUT; i++)
+        mProfilePassManagers[i] = NULL;
+
+    mStatsListener = new StatsListener();
+    mExecutionEngine->RegisterJITEventListener(mStatsListener);
+
+    // The primitive table, the functions generated later aren't primitives
+    for(llvm::Module::iterator func_it = module->begin();
+        func_it != module->end(); ++func_it)
+    {
+        if(func_it->isIntrinsic())
+            continue;
+
+        mFunctionSymbols[func_it->getNameStr()] = mFunctionTable.size();
+        mFunctionTable.push_back(func_it);
+    }
+}
+
+llvm::PassManager *ModuleHandler::create_pass_manager(OptimizationProfile profile)
+{
+    llvm::PassManager *pass_manager = new llvm::PassManager();
+
+    if(profile==PROFILE_FAST_COMPILE)
+    {
+        llvm::createStandardModulePasses(pass_manager,
+                                         1, false, true, false, false,
+                                         false, NULL);
+        return pass_manager;
+    }
+
+    // The standard module passes, without the loop unrolling
+    // and the link time passes of the full profile
+    if(profile==PROFILE_BALANCED)
+    {
+        llvm::createStandardModulePasses(pass_manager,
+                                         2, false, true, false, true,
+                                         false, llvm::createFunctionInliningPass());
+        return pass_manager;
+    }
+
+    llvm::Pass *inlining_pass = llvm::createFunctionInliningPass();
+    llvm::createStandardModulePasses(pass_manager,
+                                     3, false, true, true, true,
+                                     true, inlining_pass);
+    llvm::createStandardLTOPasses(pass_manager, true,
+                                  true, false);
+    return pass_manager;
+}
+
+llvm::FunctionPassManager *ModuleHandler::create_function_pass_manager(llvm::Module *module,
+                                                                       llvm::ExecutionEngine *execution_engine,
+                                                                       OptimizationProfile profile)
+{
+    // FunctionPassManager doesn't takes the ownership of the Module.
+    llvm::FunctionPassManager *func_pass_manager = new llvm::FunctionPassManager(module);
+    const llvm::TargetData *exec_engine_td = execution_engine->getTargetData();
+    llvm::TargetData *target_data = new llvm::TargetData(*exec_engine_td);
+
+    func_pass_manager->add(target_data);
+
+    switch(profile)
+    {
+    case PROFILE_FAST_COMPILE:
+        func_pass_manager->add(llvm::createPromoteMemoryToRegisterPass());
+        func_pass_manager->add(llvm::createEarlyCSEPass());
+        break;
+
+    case PROFILE_BALANCED:
+        llvm::createStandardFunctionPasses(func_pass_manager, 2);
+        func_pass_manager->add(llvm::createInstructionCombiningPass());
+        func_pass_manager->add(llvm::createReassociatePass());
+        func_pass_manager->add(llvm::createGVNPass());
+        break;
+
+    default:
+        llvm::createStandardFunctionPasses(func_pass_manager, 3);
+
+        func_pass_manager->add(llvm::createPromoteMemoryToRegisterPass());
+        func_pass_manager->add(llvm::createInstructionCombiningPass());
+        func_pass_manager->add(llvm::createDeadCodeEliminationPass());
+        func_pass_manager->add(llvm::createReassociatePass());
+        func_pass_manager->add(llvm::createGVNPass());
+        func_pass_manager->add(llvm::createLICMPass());
+        func_pass_manager->add(llvm::createDeadStoreEliminationPass());
+        break;
+    }
+
+    return func_pass_manager;
 }
 
 ModuleHandler* ModuleHandler::create(llvm::Module *module,
                                      std::string &error_string,
                                      llvm::PassManager *pass_manager,
-                                     llvm::FunctionPassManager *func_pass_manager)
+                                     llvm::FunctionPassManager *func_pass_manager,
+                                     OptimizationProfile profile)
 {
     assert(module && "No module provided !");
 
+    if(profile==PROFILE_DEFAULT)
+        profile = PROFILE_MAX_THROUGHPUT;
+
+    llvm::CodeGenOpt::Level codegen_opt_level = llvm::CodeGenOpt::Default;
+    if(profile==PROFILE_FAST_COMPILE)
+        codegen_opt_level = llvm::CodeGenOpt::None;
+    else if(profile==PROFILE_MAX_THROUGHPUT)
+        codegen_opt_level = llvm::CodeGenOpt::Aggressive;
+
     std::string i_error_string;
 
     llvm::ExecutionEngine *execution_engine =
         llvm::EngineBuilder(module)
             .setErrorStr(&i_error_string)
             .setEngineKind(llvm::EngineKind::JIT)
-            .setOptLevel(llvm::CodeGenOpt::Default)
+            .setOptLevel(codegen_opt_level)
             .create();
 
     if(!execution_engine)
@@ -80,40 +540,221 @@ ModuleHandler* ModuleHandler::create(llvm::Module *module,
     llvm::PassManager *created_pass_manager = pass_manager;
 
     if(!pass_manager)
-    {
-        created_pass_manager = new llvm::PassManager();
-        llvm::Pass *inlining_pass = llvm::createFunctionInliningPass();
-        llvm::createStandardModulePasses(created_pass_manager,
-                                         3, false, true, true, true,
-                                         true, inlining_pass);
-        llvm::createStandardLTOPasses(created_pass_manager, true,
-                                      true, false);
-    }
+        created_pass_manager = create_pass_manager(profile);
 
     llvm::FunctionPassManager *created_func_pass_manager = func_pass_manager;
 
     if(!func_pass_manager)
+        created_func_pass_manager = create_function_pass_manager(module, execution_engine, profile);
+
+    ModuleHandler *handler = new ModuleHandler(module, execution_engine,
+                                               created_pass_manager,
+                                               created_func_pass_manager);
+    handler->mProfile = profile;
+    return handler;
+}
+
+/**
+ * The named metadata of the snapshots: the first operand has the
+ * snapshot version and the profile name, the next ones have the
+ * primitive names, in the symbol order.
+ */
+static const char *SNAPSHOT_METADATA = "shine.snapshot";
+static const char *SNAPSHOT_VERSION = "1";
+
+/**
+ * Returns the string operand \p index of the metadata node,
+ * or an empty string if it isn't a string.
+ */
+static std::string get_metadata_string(const llvm::MDNode *node, unsigned int index)
+{
+    if(!node || index >= node->getNumOperands())
+        return "";
+
+    const llvm::MDString *md_string =
+        llvm::dyn_cast_or_null<llvm::MDString>(node->getOperand(index));
+    return md_string ? md_string->getString().str() : "";
+}
+
+ModuleHandler* ModuleHandler::create_from_snapshot(const std::string &filename,
+                                                   std::string &error_string,
+                                                   llvm::LLVMContext *context)
+{
+    ModuleLoader *loader =
+        ModuleLoader::create_from_file(filename, error_string, context, true);
+
+    if(!loader)
+        return NULL;
+
+    llvm::Module *module = loader->release_module();
+    delete loader;
+
+    const llvm::NamedMDNode *snapshot_md = module->getNamedMetadata(SNAPSHOT_METADATA);
+    OptimizationProfile profile;
+
+    if(!snapshot_md || snapshot_md->getNumOperands()==0 ||
+       get_metadata_string(snapshot_md->getOperand(0), 0)!=SNAPSHOT_VERSION ||
+       !parse_profile_name(get_metadata_string(snapshot_md->getOperand(0), 1), profile))
+    {
+        error_string = "Error while loading snapshot: [ Invalid snapshot metadata ]";
+        delete module;
+        return NULL;
+    }
+
+    // The symbol table must be the one of the saved handler
+    unsigned int symbol = 1;
+    for(llvm::Module::iterator func_it = module->begin();
+        func_it != module->end(); ++func_it)
+    {
+        if(func_it->isIntrinsic())
+            continue;
+
+        if(symbol >= snapshot_md->getNumOperands() ||
+           get_metadata_string(snapshot_md->getOperand(symbol), 0)!=func_it->getNameStr())
+        {
+            error_string = "Error while loading snapshot: [ Primitive mismatch: " +
+                           func_it->getNameStr() + " ]";
+            delete module;
+            return NULL;
+        }
+        symbol++;
+    }
+
+    if(symbol!=snapshot_md->getNumOperands())
+    {
+        error_string = "Error while loading snapshot: [ Missing primitives ]";
+        delete module;
+        return NULL;
+    }
+
+    return create(module, error_string, NULL, NULL, profile);
+}
+
+bool ModuleHandler::save_snapshot(const std::string &filename,
+                                  std::string &error_string)
+{
+    std::string i_error_string;
+
+    if(mInternalModule->MaterializeAll(&i_error_string))
+    {
+        error_string = "Error while reading function bodies: [ " + i_error_string + " ]";
+        return false;
+    }
+
+    llvm::Module *snapshot = llvm::CloneModule(mInternalModule);
+    llvm::LLVMContext &context = snapshot->getContext();
+
+    // The generated functions are only called by other generated
+    // functions, so they can be removed once their bodies are dropped
+    std::vector<llvm::Function*> generated_functions;
+    for(llvm::Module::iterator func_it = snapshot->begin();
+        func_it != snapshot->end(); ++func_it)
+    {
+        if(func_it->isIntrinsic() || get_function_symbol(func_it->getNameStr())!=ASTNode::NO_SYMBOL)
+            continue;
+
+        func_it->deleteBody();
+        generated_functions.push_back(func_it);
+    }
+
+    // Every body is dropped before the functions are erased, the
+    // constants left by the dropped bodies are removed too
+    for(unsigned int i=0; i < generated_functions.size(); i++)
+    {
+        llvm::Function *func = generated_functions[i];
+        func->removeDeadConstantUsers();
+
+        if(!func->use_empty())
+        {
+            // A declaration left in the snapshot wouldn't be a primitive
+            error_string = "Generated function still used: " + func->getNameStr();
+            delete snapshot;
+            return false;
+        }
+    }
+
+    for(unsigned int i=0; i < generated_functions.size(); i++)
+        generated_functions[i]->eraseFromParent();
+
+    llvm::NamedMDNode *old_md = snapshot->getNamedMetadata(SNAPSHOT_METADATA);
+    if(old_md)
+        old_md->eraseFromParent();
+
+    llvm::NamedMDNode *snapshot_md = snapshot->getOrInsertNamedMetadata(SNAPSHOT_METADATA);
+
+    llvm::Value *header[2] = { llvm::MDString::get(context, SNAPSHOT_VERSION),
+                               llvm::MDString::get(context, get_profile_name(mProfile)) };
+    snapshot_md->addOperand(llvm::MDNode::get(context, header, 2));
+
+    for(unsigned int symbol=0; symbol < mFunctionTable.size(); symbol++)
+    {
+        llvm::Value *name = llvm::MDString::get(context, mFunctionTable[symbol]->getName());
+        snapshot_md->addOperand(llvm::MDNode::get(context, &name, 1));
+    }
+
+    llvm::raw_fd_ostream snapshot_stream(filename.c_str(), i_error_string,
+                                         llvm::raw_fd_ostream::F_Binary);
+
+    if(!i_error_string.empty())
+    {
+        error_string = "Error while writing snapshot: [ " + i_error_string + " ]";
+        delete snapshot;
+        return false;
+    }
+
+    llvm::WriteBitcodeToFile(snapshot, snapshot_stream);
+    snapshot_stream.close();
+    delete snapshot;
+
+    if(snapshot_stream.has_error())
     {
-        // FunctionPassManager doesn't takes the ownership of the Module.
-        created_func_pass_manager = new llvm::FunctionPassManager(module);
-        const llvm::TargetData *exec_engine_td = execution_engine->getTargetData();
-        llvm::TargetData *target_data = new llvm::TargetData(*exec_engine_td);
+        snapshot_stream.clear_error();
+        error_string = "Error while writing snapshot: [ " + filename + " ]";
+        return false;
+    }
 
-        created_func_pass_manager->add(target_data);
-        llvm::createStandardFunctionPasses(created_func_pass_manager, 3);
+    return true;
+}
+
+const char *ModuleHandler::get_profile_name(OptimizationProfile profile)
+{
+    switch(profile)
+    {
+    case PROFILE_FAST_COMPILE:
+        return "fast-compile";
+    case PROFILE_BALANCED:
+        return "balanced";
+    case PROFILE_MAX_THROUGHPUT:
+        return "max-throughput";
+    default:
+        return "default";
+    }
+}
 
-        created_func_pass_manager->add(llvm::createPromoteMemoryToRegisterPass());
-        created_func_pass_manager->add(llvm::createInstructionCombiningPass());
-        created_func_pass_manager->add(llvm::createDeadCodeEliminationPass());
-        created_func_pass_manager->add(llvm::createReassociatePass());
-        created_func_pass_manager->add(llvm::createGVNPass());
-        created_func_pass_manager->add(llvm::createLICMPass());
-        created_func_pass_manager->add(llvm::createDeadStoreEliminationPass());
+bool ModuleHandler::parse_profile_name(const std::string &name,
+                                       OptimizationProfile &profile)
+{
+    for(unsigned int i=PROFILE_FAST_COMPILE; i <= PROFILE_MAX_THROUGHPUT; i++)
+    {
+        if(name==get_profile_name(static_cast<OptimizationProfile>(i)))
+        {
+            profile = static_cast<OptimizationProfile>(i);
+            return true;
+        }
     }
+    return false;
+}
 
-    return new ModuleHandler(module, execution_engine,
-                             created_pass_manager,
-                             created_func_pass_manager);
+llvm::FunctionPassManager *ModuleHandler::get_function_pass_manager(OptimizationProfile profile)
+{
+    if(profile==PROFILE_DEFAULT || profile==mProfile)
+        return mFunctionPassManager;
+
+    if(!mProfilePassManagers[profile])
+        mProfilePassManagers[profile] =
+            create_function_pass_manager(mInternalModule, mExecutionEngine, profile);
+
+    return mProfilePassManagers[profile];
 }
 
 ModuleHandler::~ModuleHandler()
@@ -123,12 +764,26 @@ ModuleHandler::~ModuleHandler()
     // the Execution Engine
     delete mExecutionEngine;
     delete mPassManager;
+    delete mStatsListener;
+
+    for(unsigned int i=0; i <= PROFILE_MAX_THROUGHPUT; i++)
+        delete mProfilePassManagers[i];
 }
 
 
 bool ModuleHandler::run_module_passes()
 {
+    // The interprocedural passes would see the bodies not read as empty
+    std::string i_error_string;
+    if(mInternalModule->MaterializeAll(&i_error_string))
+    {
+        mMaterializeError = "Error while reading function bodies: [ " + i_error_string + " ]";
+        return false;
+    }
+
+    const double passes_start = wall_time();
     const bool ret = mPassManager->run(*mInternalModule);
+    mCompileStats.module_passes_time += wall_time() - passes_start;
     return ret;
 }
 
@@ -137,41 +792,114 @@ bool ModuleHandler::run_function_passes(const std::string &func_name)
     llvm::Function *func = mExecutionEngine->FindFunctionNamed(func_name.c_str());
     assert(func!=NULL && "Function not found !");
     if(!func) return false;
-    return mFunctionPassManager->run(*func);
+
+    if(mForceInline)
+        inline_primitive_calls(func);
+
+    const double passes_start = wall_time();
+    const bool ret = mFunctionPassManager->run(*func);
+    record_function_passes(func, passes_start);
+    return ret;
 }
 
-std::string ModuleHandler::get_function_ir(const std::string &func_name)
+bool ModuleHandler::run_function_passes(const std::string &func_name,
+                                        OptimizationProfile profile)
 {
     llvm::Function *func = mExecutionEngine->FindFunctionNamed(func_name.c_str());
     assert(func!=NULL && "Function not found !");
-    if(!func) return std::string();
+    if(!func) return false;
 
-    std::stringstream ss;
-    llvm::raw_os_ostream raw_stream(ss);
-    func->print(raw_stream);
-    return ss.str();
-}
+    if(mForceInline)
+        inline_primitive_calls(func);
 
-void ModuleHandler::print_module()
-{
-    mInternalModule->dump();
+    const double passes_start = wall_time();
+    const bool ret = get_function_pass_manager(profile)->run(*func);
+    record_function_passes(func, passes_start);
+    return ret;
 }
 
-void ModuleHandler::print_module(std::ostream &stream)
+ModuleHandler::ProfileMeasure ModuleHandler::measure_profile(const std::vector<ASTNode*> *ast_nodes,
+                                                             OptimizationProfile profile,
+                                                             const double* const* columns,
+                                                             size_t n)
 {
-    llvm::raw_os_ostream raw_stream(stream);
-    mInternalModule->print(raw_stream, NULL);
-}
+    assert(mPrecision==PRECISION_DOUBLE && "Only measured in double precision !");
 
-llvm::Function* ModuleHandler::declare_function(const std::string &function_name,
-                                                std::map<std::string, llvm::Value*> &named_values)
-{
-    std::vector<const llvm::Type*> func_proto(mVariableList.size(),
-                                              llvm::Type::getDoubleTy(llvm::getGlobalContext()));
+    const std::string func_name = "shine_measure_profile";
 
-    llvm::FunctionType *func_type =
-        llvm::FunctionType::get(llvm::Type::getDoubleTy(llvm::getGlobalContext()),
-                                func_proto, false);
+    // The measured kernel isn't counted in the compile statistics
+    const CompileStats compile_stats = mCompileStats;
+
+    ProfileMeasure measure;
+
+    llvm::Function *func = codegen_ast_batch(ast_nodes, func_name);
+    if(!func)
+    {
+        mCompileStats = compile_stats;
+        measure.compile_time = measure.evaluation_time = 0.0;
+        return measure;
+    }
+
+    const double compile_start = wall_time();
+    if(mForceInline)
+        inline_primitive_calls(func);
+    get_function_pass_manager(profile)->run(*func);
+    void *kernel_ptr = mExecutionEngine->getPointerToFunction(func);
+    assert(kernel_ptr!=NULL);
+    measure.compile_time = wall_time() - compile_start;
+
+    typedef void (*BatchKernel)(const double* const*, double*, size_t);
+    BatchKernel kernel = (BatchKernel)(intptr_t)kernel_ptr;
+
+    std::vector<double> out(n);
+    const double evaluation_start = wall_time();
+    kernel(columns, out.empty() ? NULL : &out[0], n);
+    measure.evaluation_time = wall_time() - evaluation_start;
+
+    mExecutionEngine->freeMachineCodeForFunction(func);
+    static_cast<StatsListener*>(mStatsListener)->forget_function(func);
+    func->eraseFromParent();
+
+    static_cast<StatsListener*>(mStatsListener)->take_emitted_bytes();
+    mFunctionStats.erase(func_name);
+    mCompileStats = compile_stats;
+
+    return measure;
+}
+
+std::string ModuleHandler::get_function_ir(const std::string &func_name)
+{
+    llvm::Function *func = mExecutionEngine->FindFunctionNamed(func_name.c_str());
+    assert(func!=NULL && "Function not found !");
+    if(!func) return std::string();
+
+    std::stringstream ss;
+    llvm::raw_os_ostream raw_stream(ss);
+    func->print(raw_stream);
+    return ss.str();
+}
+
+void ModuleHandler::print_module()
+{
+    mInternalModule->dump();
+}
+
+void ModuleHandler::print_module(std::ostream &stream)
+{
+    llvm::raw_os_ostream raw_stream(stream);
+    mInternalModule->print(raw_stream, NULL);
+}
+
+llvm::Function* ModuleHandler::declare_function(const std::string &function_name,
+                                                std::vector<llvm::Value*> &variable_values,
+                                                bool with_params)
+{
+    std::vector<const llvm::Type*> func_proto(mVariableList.size(), get_data_type());
+    if(with_params)
+        func_proto.push_back(llvm::PointerType::getUnqual(get_value_type()));
+
+    llvm::FunctionType *func_type =
+        llvm::FunctionType::get(get_value_type(), func_proto, false);
 
     assert(func_type!=NULL);
 
@@ -181,37 +909,270 @@ llvm::Function* ModuleHandler::declare_function(const std::string &function_name
 
     assert(func!=NULL);
 
+    variable_values.resize(mVariableList.size());
+
     unsigned int var_index = 0;
     for (llvm::Function::arg_iterator arg_it = func->arg_begin();
          var_index != mVariableList.size(); ++arg_it, ++var_index)
     {
-        const std::string var_name = mVariableList[var_index];
-        arg_it->setName(var_name);
-        named_values[var_name] = arg_it;
+        arg_it->setName(mVariableList[var_index]);
+        variable_values[var_index] = arg_it;
     }
 
+    if(with_params)
+        (--func->arg_end())->setName("params");
+
+    return func;
+}
+
+llvm::Function* ModuleHandler::declare_batch_function(const std::string &function_name,
+                                                      bool with_params)
+{
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    const llvm::Type *data_ptr_type = llvm::PointerType::getUnqual(get_data_type());
+    const llvm::Type *value_ptr_type = llvm::PointerType::getUnqual(get_value_type());
+    const llvm::Type *size_type =
+        mExecutionEngine->getTargetData()->getIntPtrType(context);
+
+    std::vector<const llvm::Type*> func_proto;
+    func_proto.push_back(llvm::PointerType::getUnqual(data_ptr_type));
+    func_proto.push_back(value_ptr_type);
+    func_proto.push_back(size_type);
+    if(with_params)
+        func_proto.push_back(value_ptr_type);
+
+    llvm::FunctionType *func_type =
+        llvm::FunctionType::get(llvm::Type::getVoidTy(context),
+                                func_proto, false);
+
+    assert(func_type!=NULL);
+
+    llvm::Function *func =
+        llvm::Function::Create(func_type, llvm::Function::ExternalLinkage,
+                               function_name, mInternalModule);
+
+    assert(func!=NULL);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    (arg_it++)->setName("columns");
+    (arg_it++)->setName("out");
+    (arg_it++)->setName("n");
+    if(with_params)
+        (arg_it++)->setName("params");
+
+    return func;
+}
+
+llvm::Function* ModuleHandler::declare_fitness_function(const std::string &function_name)
+{
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    const llvm::Type *data_ptr_type = llvm::PointerType::getUnqual(get_data_type());
+    const llvm::Type *size_type =
+        mExecutionEngine->getTargetData()->getIntPtrType(context);
+
+    std::vector<const llvm::Type*> func_proto;
+    func_proto.push_back(llvm::PointerType::getUnqual(data_ptr_type));
+    func_proto.push_back(data_ptr_type);
+    func_proto.push_back(size_type);
+
+    llvm::FunctionType *func_type =
+        llvm::FunctionType::get(get_value_type(), func_proto, false);
+
+    assert(func_type!=NULL);
+
+    llvm::Function *func =
+        llvm::Function::Create(func_type, llvm::Function::ExternalLinkage,
+                               function_name, mInternalModule);
+
+    assert(func!=NULL);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    (arg_it++)->setName("columns");
+    (arg_it++)->setName("target");
+    (arg_it++)->setName("n");
+
     return func;
 }
 
-void ModuleHandler::codegen_ast(const std::vector<ASTNode*> *ast_nodes,
-                                const std::string &func_name)
+llvm::Value* ModuleHandler::codegen_vector_call(llvm::BasicBlock *basic_block,
+                                                llvm::Function *scalar_func,
+                                                const std::vector<llvm::Value*> &argument_list,
+                                                unsigned int vector_width)
+{
+    llvm::IRBuilder<> builder(basic_block);
+
+    std::stringstream ss_name;
+    ss_name << scalar_func->getNameStr() << "_v" << vector_width;
+
+    const llvm::VectorType *vector_type =
+        llvm::VectorType::get(scalar_func->getReturnType(), vector_width);
+
+    llvm::Function *vector_func = mInternalModule->getFunction(ss_name.str());
+
+    // The variant must take and return vectors of the width only
+    bool is_variant = vector_func && vector_func->getReturnType()==vector_type &&
+                      vector_func->arg_size()==scalar_func->arg_size();
+    for(unsigned int i=0; is_variant && i < vector_func->arg_size(); i++)
+        is_variant = vector_func->getFunctionType()->getParamType(i)==vector_type;
+
+    if(is_variant)
+    {
+        materialize_function(vector_func);
+        return builder.CreateCall(vector_func, argument_list.begin(),
+                                  argument_list.end(), "tmp_vcall");
+    }
+
+    // There is no vector variant of the function, so we
+    // scalarize it by calling the function for each lane
+    llvm::Value *result = llvm::UndefValue::get(vector_type);
+
+    const llvm::Type *lane_type = llvm::Type::getInt32Ty(mInternalModule->getContext());
+    for(unsigned int lane=0; lane < vector_width; lane++)
+    {
+        llvm::Value *lane_index = llvm::ConstantInt::get(lane_type, lane);
+
+        std::vector<llvm::Value*> lane_arguments;
+        for(unsigned int i=0; i < argument_list.size(); i++)
+            lane_arguments.push_back(builder.CreateExtractElement(argument_list[i], lane_index));
+
+        llvm::Value *lane_call =
+            builder.CreateCall(scalar_func, lane_arguments.begin(),
+                               lane_arguments.end(), "tmp_call");
+        result = builder.CreateInsertElement(result, lane_call, lane_index);
+    }
+
+    return result;
+}
+
+llvm::Value* ModuleHandler::codegen_scalar_call(llvm::BasicBlock *basic_block,
+                                                llvm::Function *func,
+                                                const std::vector<llvm::Value*> &argument_list)
+{
+    llvm::IRBuilder<> builder(basic_block);
+
+    const llvm::Type *value_type = get_value_type();
+    if(func->getReturnType()==value_type)
+        return builder.CreateCall(func, argument_list.begin(),
+                                  argument_list.end(), "tmp_call");
+
+    llvm::Function *float_func = mInternalModule->getFunction(get_float_name(func->getNameStr()));
+
+    if(float_func && float_func->getReturnType()==value_type &&
+       float_func->arg_size()==func->arg_size())
+    {
+        materialize_function(float_func);
+        return builder.CreateCall(float_func, argument_list.begin(),
+                                  argument_list.end(), "tmp_fcall");
+    }
+
+    // There is no variant of the function in the precision, so we
+    // call it with converted values: a double function in single
+    // precision, or a float only function in double precision
+    const llvm::FunctionType *func_type = func->getFunctionType();
+    std::vector<llvm::Value*> converted_arguments;
+    for(unsigned int i=0; i < argument_list.size(); i++)
+        converted_arguments.push_back(convert_fp(builder, argument_list[i],
+                                                 func_type->getParamType(i)));
+
+    llvm::Value *call_inst =
+        builder.CreateCall(func, converted_arguments.begin(),
+                           converted_arguments.end(), "tmp_call");
+    return convert_fp(builder, call_inst, value_type);
+}
+
+void ModuleHandler::set_precision(Precision precision)
+{
+    // The shared helpers have the prototype of their precision
+    if(precision!=mPrecision)
+        mSharedHelpers.clear();
+
+    mPrecision = precision;
+}
+
+std::string ModuleHandler::get_unique_prefix(const std::string &base)
+{
+    for(;;)
+    {
+        std::stringstream ss_prefix;
+        ss_prefix << base << mUniquePrefixCount++ << "_";
+        const std::string prefix = ss_prefix.str();
+
+        // The module can come from a snapshot with the same prefixes
+        bool prefix_used = false;
+        for(llvm::Module::iterator func_it = mInternalModule->begin();
+            !prefix_used && func_it != mInternalModule->end(); func_it++)
+            prefix_used = func_it->getName().startswith(prefix);
+
+        if(!prefix_used)
+            return prefix;
+    }
+}
+
+std::string ModuleHandler::get_float_name(const std::string &func_name)
+{
+    return func_name + "_f";
+}
+
+const llvm::Type* ModuleHandler::get_data_type() const
+{
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    if(mPrecision==PRECISION_DOUBLE)
+        return llvm::Type::getDoubleTy(context);
+    return llvm::Type::getFloatTy(context);
+}
+
+const llvm::Type* ModuleHandler::get_value_type() const
+{
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    if(mPrecision==PRECISION_SINGLE)
+        return llvm::Type::getFloatTy(context);
+    return llvm::Type::getDoubleTy(context);
+}
+
+llvm::Value* ModuleHandler::codegen_ast_nodes(const std::vector<ASTNode*> *ast_nodes,
+                                              llvm::BasicBlock *basic_block,
+                                              const std::vector<llvm::Value*> &variable_values,
+                                              unsigned int vector_width,
+                                              bool share_root,
+                                              const std::vector<llvm::Value*> *constant_values)
 {
     std::vector<llvm::Value*> ast_codegen;
-    std::map<std::string, llvm::Value*> named_values;
 
-    llvm::Function *func = declare_function(func_name, named_values);
+    llvm::IRBuilder<> builder(basic_block);
 
-    llvm::BasicBlock *basic_block = llvm::BasicBlock::Create(llvm::getGlobalContext(), "entry", func);
+    // The shared subtree helpers are scalar functions, with the constants embedded
+    const bool sharing = mSubtreeSharing && vector_width==1 && !constant_values;
 
-    llvm::IRBuilder<> builder(llvm::getGlobalContext());
-    builder.SetInsertPoint(basic_block);
+    std::vector<llvm::Function*> shared_calls;
+    std::vector<bool> covered;
+    if(sharing)
+        find_shared_subtrees(ast_nodes, share_root, shared_calls, covered);
 
-    std::vector<ASTNode*>::const_iterator it_ast_nodes = ast_nodes->end()-1;
+    // The float variables of the mixed precision are converted when first used
+    const llvm::Type *value_type = get_value_type();
+    std::vector<llvm::Value*> converted_values(variable_values.size(), (llvm::Value*)NULL);
 
-    while(it_ast_nodes != ast_nodes->begin()-1)
+    for(int node_index=ast_nodes->size()-1; node_index >= 0; node_index--)
     {
-        const ASTNode *node = *it_ast_nodes;
-        it_ast_nodes--;
+        const ASTNode *node = (*ast_nodes)[node_index];
+
+        if(sharing && covered[node_index])
+            continue;
+
+        mGeneratedNodes++;
+
+        if(sharing && shared_calls[node_index])
+        {
+            llvm::CallInst *call_inst =
+                    builder.CreateCall(shared_calls[node_index], variable_values.begin(),
+                                       variable_values.end(), "tmp_shared");
+            ast_codegen.push_back(call_inst);
+            continue;
+        }
 
         switch(node->get_id())
         {
@@ -219,13 +1180,23 @@ void ModuleHandler::codegen_ast(const std::vector<ASTNode*> *ast_nodes,
         // Handles the ASTConstant node type
         case ASTNode::AST_CONSTANT:
         {
+            if(constant_values)
+            {
+                assert(vector_width==1 && (*constant_values)[node_index]!=NULL);
+                ast_codegen.push_back((*constant_values)[node_index]);
+                break;
+            }
+
             const ASTConstant *constant =
                 static_cast<const ASTConstant*>(node);
 
-            llvm::Value *val =
-                llvm::ConstantFP::get(llvm::getGlobalContext(),
-                                      llvm::APFloat(constant->get_value()));
+            llvm::Constant *val =
+                llvm::ConstantFP::get(value_type, constant->get_value());
             assert(val!=NULL);
+
+            if(vector_width > 1)
+                val = llvm::ConstantVector::get(std::vector<llvm::Constant*>(vector_width, val));
+
             ast_codegen.push_back(val);
             break;
         }
@@ -236,9 +1207,19 @@ void ModuleHandler::codegen_ast(const std::vector<ASTNode*> *ast_nodes,
             const ASTVariable *variable =
                 static_cast<const ASTVariable*>(node);
 
-            llvm::Value *variable_codegen = named_values[variable->get_name()];
+            const int symbol = resolve_variable_symbol(variable);
+            assert(symbol!=ASTNode::NO_SYMBOL && "Variable not found !");
+
+            llvm::Value *variable_codegen = variable_values[symbol];
             assert(variable_codegen!=NULL);
 
+            if(vector_width==1 && variable_codegen->getType()!=value_type)
+            {
+                if(!converted_values[symbol])
+                    converted_values[symbol] = builder.CreateFPExt(variable_codegen, value_type);
+                variable_codegen = converted_values[symbol];
+            }
+
             ast_codegen.push_back(variable_codegen);
             break;
         }
@@ -249,9 +1230,9 @@ void ModuleHandler::codegen_ast(const std::vector<ASTNode*> *ast_nodes,
             const ASTFunction *func_codegen =
                 static_cast<const ASTFunction*>(node);
 
-            llvm::Function *find_func =
-                mInternalModule->getFunction(func_codegen->get_name());
-            assert(find_func!=NULL);
+            llvm::Function *find_func = resolve_function(func_codegen);
+            assert(find_func!=NULL && "Function not found !");
+            materialize_function(find_func);
 
             const int arg_size =
                 find_func->arg_size();
@@ -263,10 +1244,14 @@ void ModuleHandler::codegen_ast(const std::vector<ASTNode*> *ast_nodes,
                 ast_codegen.pop_back();
             }
 
-            llvm::CallInst *call_inst =
-                    builder.CreateCall(find_func, argument_list.begin(),
-                                       argument_list.end(), "tmp_call");
-            ast_codegen.push_back(call_inst);
+            if(vector_width > 1)
+            {
+                ast_codegen.push_back(codegen_vector_call(basic_block, find_func,
+                                                          argument_list, vector_width));
+                break;
+            }
+
+            ast_codegen.push_back(codegen_scalar_call(basic_block, find_func, argument_list));
             break;
         }
 
@@ -275,20 +1260,1933 @@ void ModuleHandler::codegen_ast(const std::vector<ASTNode*> *ast_nodes,
         }
     }
     assert(ast_codegen.size()==1);
-    builder.CreateRet(ast_codegen.back());
+    return ast_codegen.back();
 }
 
-void* ModuleHandler::jit_function(const std::string &func_name)
+llvm::Value* ModuleHandler::codegen_flat_nodes(const ASTArena *arena, const FlatTree &tree,
+                                               llvm::BasicBlock *basic_block,
+                                               const std::vector<llvm::Value*> &variable_values)
 {
-    llvm::Function *func = mExecutionEngine->FindFunctionNamed(func_name.c_str());
-    if(!func) return NULL;
+    assert(tree.size>0 && tree.begin+tree.size <= arena->size());
 
-    void *jit_func = mExecutionEngine->recompileAndRelinkFunction(func);
+    std::vector<llvm::Value*> ast_codegen;
+    ast_codegen.reserve(tree.size);
 
-    if(jit_func)
-        mJITFunctions.insert(std::make_pair(func_name, func));
+    llvm::IRBuilder<> builder(basic_block);
 
-    return jit_func;
+    // The symbols are resolved when first used
+    std::vector<llvm::Function*> function_list(arena->get_num_function_symbols(),
+                                               (llvm::Function*)NULL);
+    std::vector<llvm::Value*> variable_list(arena->get_num_variable_symbols(),
+                                            (llvm::Value*)NULL);
+
+    for(int node_index=tree.begin+tree.size-1; node_index >= (int)tree.begin; node_index--)
+    {
+        const unsigned int payload = arena->get_payload(node_index);
+
+        mGeneratedNodes++;
+
+        switch(arena->get_opcode(node_index))
+        {
+
+        case ASTNode::AST_CONSTANT:
+        {
+            llvm::Constant *val =
+                llvm::ConstantFP::get(get_value_type(), arena->get_constant(payload));
+            assert(val!=NULL);
+
+            ast_codegen.push_back(val);
+            break;
+        }
+
+        case ASTNode::AST_VARIABLE:
+        {
+            if(!variable_list[payload])
+            {
+                const int symbol = get_variable_symbol(arena->get_variable_name(payload));
+                assert(symbol!=ASTNode::NO_SYMBOL && "Variable not found !");
+                variable_list[payload] = variable_values[symbol];
+
+                if(variable_list[payload]->getType()!=get_value_type())
+                    variable_list[payload] =
+                        builder.CreateFPExt(variable_list[payload], get_value_type());
+            }
+
+            assert(variable_list[payload]!=NULL);
+            ast_codegen.push_back(variable_list[payload]);
+            break;
+        }
+
+        case ASTNode::AST_FUNCTION:
+        {
+            if(!function_list[payload])
+            {
+                const int symbol = get_function_symbol(arena->get_function_name(payload));
+                function_list[payload] = (symbol!=ASTNode::NO_SYMBOL) ? mFunctionTable[symbol] :
+                    mInternalModule->getFunction(arena->get_function_name(payload));
+                materialize_function(function_list[payload]);
+            }
+
+            llvm::Function *find_func = function_list[payload];
+            assert(find_func!=NULL);
+
+            const unsigned int arg_size = arena->get_arity(node_index);
+            assert(arg_size==find_func->arg_size());
+
+            std::vector<llvm::Value*> argument_list;
+            for(unsigned int i=0; i < arg_size; i++)
+            {
+                argument_list.push_back(ast_codegen.back());
+                ast_codegen.pop_back();
+            }
+
+            ast_codegen.push_back(codegen_scalar_call(basic_block, find_func, argument_list));
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+    assert(ast_codegen.size()==1);
+    return ast_codegen.back();
+}
+
+void ModuleHandler::compute_subtree_sizes(const std::vector<ASTNode*> *ast_nodes,
+                                          std::vector<unsigned int> &subtree_sizes)
+{
+    subtree_sizes.assign(ast_nodes->size(), 1);
+
+    std::vector<unsigned int> size_stack;
+    for(int node_index=ast_nodes->size()-1; node_index >= 0; node_index--)
+    {
+        const ASTNode *node = (*ast_nodes)[node_index];
+        unsigned int size = 1;
+
+        if(node->get_id()==ASTNode::AST_FUNCTION)
+        {
+            const llvm::Function *func =
+                mInternalModule->getFunction(static_cast<const ASTFunction*>(node)->get_name());
+            assert(func!=NULL);
+
+            for(unsigned int i=0; i < func->arg_size(); i++)
+            {
+                size += size_stack.back();
+                size_stack.pop_back();
+            }
+        }
+
+        subtree_sizes[node_index] = size;
+        size_stack.push_back(size);
+    }
+}
+
+void ModuleHandler::find_shared_subtrees(const std::vector<ASTNode*> *ast_nodes,
+                                         bool share_root,
+                                         std::vector<llvm::Function*> &shared_calls,
+                                         std::vector<bool> &covered)
+{
+    std::vector<unsigned int> subtree_sizes;
+    compute_subtree_sizes(ast_nodes, subtree_sizes);
+
+    shared_calls.assign(ast_nodes->size(), (llvm::Function*)NULL);
+    covered.assign(ast_nodes->size(), false);
+
+    // Only the outermost shared subtrees are replaced, the shared
+    // subtrees nested inside them are handled by the helpers
+    unsigned int node_index = share_root ? 0 : 1;
+    while(node_index < ast_nodes->size())
+    {
+        const unsigned int size = subtree_sizes[node_index];
+        llvm::Function *helper = NULL;
+
+        if(size > 1)
+        {
+            const uint64_t hash = ASTNode::structural_hash(ast_nodes, node_index, size);
+            if(mSharedHashes.count(hash) || mSharedHelpers.count(hash))
+                helper = get_shared_helper(ast_nodes, node_index, size, hash);
+        }
+
+        if(!helper)
+        {
+            node_index++;
+            continue;
+        }
+
+        shared_calls[node_index] = helper;
+        for(unsigned int i=node_index+1; i < node_index+size; i++)
+            covered[i] = true;
+        node_index += size;
+    }
+}
+
+llvm::Function* ModuleHandler::get_shared_helper(const std::vector<ASTNode*> *ast_nodes,
+                                                 unsigned int begin, unsigned int size,
+                                                 uint64_t hash)
+{
+    const std::string key = ASTNode::structural_key(ast_nodes, begin, size);
+
+    SharedHelperMap::const_iterator helper_it = mSharedHelpers.find(hash);
+    if(helper_it!=mSharedHelpers.end())
+        return (helper_it->second.key==key) ? helper_it->second.function : NULL;
+
+    const std::vector<ASTNode*> subtree(ast_nodes->begin()+begin,
+                                        ast_nodes->begin()+begin+size);
+
+    std::stringstream ss_name;
+    ss_name << "shine_shared_" << std::hex << hash;
+
+    std::vector<llvm::Value*> variable_values;
+    llvm::Function *helper = declare_function(ss_name.str(), variable_values);
+    helper->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+    llvm::BasicBlock *basic_block =
+        llvm::BasicBlock::Create(mInternalModule->getContext(), "entry", helper);
+
+    llvm::Value *ret_value =
+        codegen_ast_nodes(&subtree, basic_block, variable_values, 1, false);
+
+    // The function calling the helper is discarded too, see record_codegen()
+    if(mMaterializeFailed)
+    {
+        helper->eraseFromParent();
+        return NULL;
+    }
+
+    llvm::IRBuilder<> builder(basic_block);
+    builder.CreateRet(ret_value);
+
+    // The helper only calls primitives, so it has their attributes
+    std::string reason;
+    const FunctionAttributes attributes =
+        get_body_attributes(helper, AttributeMap(), reason);
+
+    if(attributes.effect==EFFECT_NONE)
+        helper->setDoesNotAccessMemory();
+    if(attributes.no_unwind)
+        helper->setDoesNotThrow();
+
+    SharedHelper shared_helper;
+    shared_helper.key = key;
+    shared_helper.function = helper;
+    mSharedHelpers.insert(std::make_pair(hash, shared_helper));
+    mNewSharedHelpers.push_back(helper);
+
+    return helper;
+}
+
+llvm::Function* ModuleHandler::codegen_ast(const std::vector<ASTNode*> *ast_nodes,
+                                           const std::string &func_name)
+{
+    const double codegen_start = wall_time();
+
+    std::vector<llvm::Value*> variable_values;
+
+    llvm::Function *func = declare_function(func_name, variable_values);
+
+    llvm::BasicBlock *basic_block = llvm::BasicBlock::Create(mInternalModule->getContext(), "entry", func);
+
+    llvm::Value *ret_value = codegen_ast_nodes(ast_nodes, basic_block, variable_values);
+
+    llvm::IRBuilder<> builder(basic_block);
+    builder.CreateRet(ret_value);
+
+    return record_codegen(func, codegen_start);
+}
+
+llvm::Function* ModuleHandler::codegen_ast(const ASTArena *arena, const FlatTree &tree,
+                                           const std::string &func_name)
+{
+    const double codegen_start = wall_time();
+
+    assert(arena!=NULL);
+
+    std::vector<llvm::Value*> variable_values;
+
+    llvm::Function *func = declare_function(func_name, variable_values);
+
+    llvm::BasicBlock *basic_block = llvm::BasicBlock::Create(mInternalModule->getContext(), "entry", func);
+
+    llvm::Value *ret_value = codegen_flat_nodes(arena, tree, basic_block, variable_values);
+
+    llvm::IRBuilder<> builder(basic_block);
+    builder.CreateRet(ret_value);
+
+    return record_codegen(func, codegen_start);
+}
+
+llvm::Function* ModuleHandler::codegen_ast_batch(const std::vector<ASTNode*> *ast_nodes,
+                                                 const std::string &func_name)
+{
+    const double codegen_start = wall_time();
+
+    llvm::Function *func = declare_batch_function(func_name);
+    codegen_batch_body(ast_nodes, func, NULL);
+
+    return record_codegen(func, codegen_start);
+}
+
+void ModuleHandler::codegen_batch_body(const std::vector<ASTNode*> *ast_nodes,
+                                       llvm::Function *func,
+                                       const std::vector<unsigned int> *param_layout)
+{
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    llvm::Value *columns = arg_it++;
+    llvm::Value *out = arg_it++;
+    llvm::Value *n = arg_it++;
+
+    const llvm::Type *size_type = n->getType();
+
+    llvm::BasicBlock *entry_block = llvm::BasicBlock::Create(context, "entry", func);
+    llvm::BasicBlock *loop_block = llvm::BasicBlock::Create(context, "loop", func);
+    llvm::BasicBlock *exit_block = llvm::BasicBlock::Create(context, "exit", func);
+
+    llvm::IRBuilder<> builder(entry_block);
+
+    std::vector<llvm::Value*> column_list =
+        load_column_list(builder, columns, mVariableList);
+
+    // The parameters are loaded once, before the loop
+    std::vector<llvm::Value*> constant_values;
+    if(param_layout)
+        load_parameter_values(builder, arg_it, ast_nodes, *param_layout, constant_values);
+
+    llvm::Value *zero = llvm::ConstantInt::get(size_type, 0);
+    builder.CreateCondBr(builder.CreateICmpEQ(n, zero), exit_block, loop_block);
+
+    builder.SetInsertPoint(loop_block);
+    llvm::PHINode *index = builder.CreatePHI(size_type, "i");
+    index->addIncoming(zero, entry_block);
+
+    std::vector<llvm::Value*> variable_values;
+    load_row_values(builder, column_list, index, mVariableList, variable_values);
+
+    llvm::Value *ret_value =
+        codegen_ast_nodes(ast_nodes, loop_block, variable_values, 1, true,
+                          param_layout ? &constant_values : NULL);
+
+    builder.SetInsertPoint(loop_block);
+    builder.CreateStore(ret_value, builder.CreateGEP(out, index));
+
+    llvm::Value *next_index =
+        builder.CreateAdd(index, llvm::ConstantInt::get(size_type, 1), "next_i");
+    index->addIncoming(next_index, loop_block);
+    builder.CreateCondBr(builder.CreateICmpEQ(next_index, n), exit_block, loop_block);
+
+    builder.SetInsertPoint(exit_block);
+    builder.CreateRetVoid();
+}
+
+llvm::Function* ModuleHandler::codegen_ast_params(const std::vector<ASTNode*> *ast_nodes,
+                                                  const std::string &func_name,
+                                                  std::vector<unsigned int> &param_layout,
+                                                  KernelType kernel_type)
+{
+    const double codegen_start = wall_time();
+
+    get_parameter_layout(ast_nodes, param_layout);
+
+    llvm::Function *func = NULL;
+
+    if(kernel_type==KERNEL_BATCH)
+    {
+        func = declare_batch_function(func_name, true);
+        codegen_batch_body(ast_nodes, func, &param_layout);
+    }
+    else
+    {
+        std::vector<llvm::Value*> variable_values;
+        func = declare_function(func_name, variable_values, true);
+
+        llvm::BasicBlock *basic_block =
+            llvm::BasicBlock::Create(mInternalModule->getContext(), "entry", func);
+        llvm::IRBuilder<> builder(basic_block);
+
+        std::vector<llvm::Value*> constant_values;
+        load_parameter_values(builder, --func->arg_end(), ast_nodes,
+                              param_layout, constant_values);
+
+        llvm::Value *ret_value =
+            codegen_ast_nodes(ast_nodes, basic_block, variable_values, 1, true,
+                              &constant_values);
+
+        builder.SetInsertPoint(basic_block);
+        builder.CreateRet(ret_value);
+    }
+
+    return record_codegen(func, codegen_start);
+}
+
+void ModuleHandler::get_parameter_layout(const std::vector<ASTNode*> *ast_nodes,
+                                         std::vector<unsigned int> &param_layout)
+{
+    param_layout.clear();
+    for(unsigned int node_index=0; node_index < ast_nodes->size(); node_index++)
+    {
+        if((*ast_nodes)[node_index]->get_id()==ASTNode::AST_CONSTANT)
+            param_layout.push_back(node_index);
+    }
+}
+
+void ModuleHandler::get_parameter_values(const std::vector<ASTNode*> *ast_nodes,
+                                         const std::vector<unsigned int> &param_layout,
+                                         std::vector<double> &params)
+{
+    params.resize(param_layout.size());
+    for(unsigned int param=0; param < param_layout.size(); param++)
+    {
+        const ASTNode *node = (*ast_nodes)[param_layout[param]];
+        assert(node->get_id()==ASTNode::AST_CONSTANT);
+        params[param] = static_cast<const ASTConstant*>(node)->get_value();
+    }
+}
+
+void ModuleHandler::set_parameter_values(const std::vector<ASTNode*> *ast_nodes,
+                                         const std::vector<unsigned int> &param_layout,
+                                         const double *params)
+{
+    for(unsigned int param=0; param < param_layout.size(); param++)
+    {
+        ASTNode *node = (*ast_nodes)[param_layout[param]];
+        assert(node->get_id()==ASTNode::AST_CONSTANT);
+        static_cast<ASTConstant*>(node)->set_value(params[param]);
+    }
+}
+
+std::string ModuleHandler::get_derivative_name(const std::string &func_name,
+                                               unsigned int arg_index)
+{
+    std::stringstream ss_name;
+    ss_name << "d_" << func_name << "_" << arg_index;
+    return ss_name.str();
+}
+
+llvm::Function* ModuleHandler::declare_gradient_function(const std::string &function_name,
+                                                         std::vector<llvm::Value*> &variable_values)
+{
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    const llvm::Type *double_type = llvm::Type::getDoubleTy(context);
+    const llvm::Type *double_ptr_type = llvm::PointerType::getUnqual(double_type);
+
+    std::vector<const llvm::Type*> func_proto(mVariableList.size(), double_type);
+    func_proto.push_back(double_ptr_type);
+    func_proto.push_back(double_ptr_type);
+
+    llvm::FunctionType *func_type =
+        llvm::FunctionType::get(double_type, func_proto, false);
+
+    assert(func_type!=NULL);
+
+    llvm::Function *func =
+        llvm::Function::Create(func_type, llvm::Function::ExternalLinkage,
+                               function_name, mInternalModule);
+
+    assert(func!=NULL);
+
+    variable_values.resize(mVariableList.size());
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    for(unsigned int var_index=0; var_index < mVariableList.size(); ++arg_it, ++var_index)
+    {
+        arg_it->setName(mVariableList[var_index]);
+        variable_values[var_index] = arg_it;
+    }
+
+    (arg_it++)->setName("params");
+    (arg_it++)->setName("grad");
+
+    return func;
+}
+
+llvm::Function* ModuleHandler::declare_fitness_gradient_function(const std::string &function_name)
+{
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    const llvm::Type *double_ptr_type =
+        llvm::PointerType::getUnqual(llvm::Type::getDoubleTy(context));
+    const llvm::Type *size_type =
+        mExecutionEngine->getTargetData()->getIntPtrType(context);
+
+    std::vector<const llvm::Type*> func_proto;
+    func_proto.push_back(llvm::PointerType::getUnqual(double_ptr_type));
+    func_proto.push_back(double_ptr_type);
+    func_proto.push_back(size_type);
+    func_proto.push_back(double_ptr_type);
+    func_proto.push_back(double_ptr_type);
+
+    llvm::FunctionType *func_type =
+        llvm::FunctionType::get(llvm::Type::getDoubleTy(context),
+                                func_proto, false);
+
+    assert(func_type!=NULL);
+
+    llvm::Function *func =
+        llvm::Function::Create(func_type, llvm::Function::ExternalLinkage,
+                               function_name, mInternalModule);
+
+    assert(func!=NULL);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    (arg_it++)->setName("columns");
+    (arg_it++)->setName("target");
+    (arg_it++)->setName("n");
+    (arg_it++)->setName("params");
+    (arg_it++)->setName("grad");
+
+    return func;
+}
+
+bool ModuleHandler::check_derivatives(const std::vector<ASTNode*> *ast_nodes,
+                                      std::string &error_string)
+{
+    for(unsigned int node_index=0; node_index < ast_nodes->size(); node_index++)
+    {
+        const ASTNode *node = (*ast_nodes)[node_index];
+        if(node->get_id()!=ASTNode::AST_FUNCTION)
+            continue;
+
+        const std::string &func_name = static_cast<const ASTFunction*>(node)->get_name();
+        const llvm::Function *func = mInternalModule->getFunction(func_name);
+        assert(func!=NULL && "Function not found !");
+
+        for(unsigned int arg_index=0; arg_index < func->arg_size(); arg_index++)
+        {
+            const std::string derivative_name = get_derivative_name(func_name, arg_index);
+            const llvm::Function *derivative = mInternalModule->getFunction(derivative_name);
+
+            if(!derivative || derivative->getFunctionType()!=func->getFunctionType())
+            {
+                error_string = "Derivative primitive not found: " + derivative_name;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+llvm::Value* ModuleHandler::codegen_gradient_nodes(const std::vector<ASTNode*> *ast_nodes,
+                                                   llvm::BasicBlock *basic_block,
+                                                   const std::vector<llvm::Value*> &variable_values,
+                                                   const std::vector<llvm::Value*> &constant_values,
+                                                   const std::vector<unsigned int> &param_layout,
+                                                   std::vector<llvm::Value*> &param_adjoints,
+                                                   std::vector<llvm::Value*> *variable_adjoints)
+{
+    llvm::IRBuilder<> builder(basic_block);
+
+    const llvm::Type *double_type = llvm::Type::getDoubleTy(mInternalModule->getContext());
+    llvm::Value *zero_fp = llvm::ConstantFP::get(double_type, 0.0);
+
+    const unsigned int node_count = ast_nodes->size();
+
+    // The forward pass keeps the value, the arguments and the primitive of each node
+    std::vector<llvm::Value*> node_values(node_count, (llvm::Value*)NULL);
+    std::vector<std::vector<unsigned int> > node_args(node_count);
+    std::vector<llvm::Function*> node_functions(node_count, (llvm::Function*)NULL);
+    std::vector<int> node_symbols(node_count, ASTNode::NO_SYMBOL);
+
+    // true if the subtree has a parameter, the other
+    // subtrees only matter for the variable gradient
+    std::vector<bool> has_params(node_count, false);
+
+    std::vector<unsigned int> node_stack;
+    for(int node_index=node_count-1; node_index >= 0; node_index--)
+    {
+        const ASTNode *node = (*ast_nodes)[node_index];
+        mGeneratedNodes++;
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_CONSTANT:
+            node_values[node_index] = constant_values[node_index];
+            has_params[node_index] = true;
+            break;
+
+        case ASTNode::AST_VARIABLE:
+        {
+            const ASTVariable *variable = static_cast<const ASTVariable*>(node);
+
+            const int symbol = resolve_variable_symbol(variable);
+            assert(symbol!=ASTNode::NO_SYMBOL && "Variable not found !");
+
+            node_values[node_index] = variable_values[symbol];
+            node_symbols[node_index] = symbol;
+            break;
+        }
+
+        case ASTNode::AST_FUNCTION:
+        {
+            const ASTFunction *func_codegen = static_cast<const ASTFunction*>(node);
+
+            llvm::Function *find_func = resolve_function(func_codegen);
+            assert(find_func!=NULL && "Function not found !");
+            materialize_function(find_func);
+
+            std::vector<llvm::Value*> argument_list;
+            for(unsigned int i=0; i < find_func->arg_size(); i++)
+            {
+                const unsigned int arg_node = node_stack.back();
+                node_stack.pop_back();
+
+                node_args[node_index].push_back(arg_node);
+                argument_list.push_back(node_values[arg_node]);
+                has_params[node_index] = has_params[node_index] || has_params[arg_node];
+            }
+
+            node_values[node_index] =
+                builder.CreateCall(find_func, argument_list.begin(),
+                                   argument_list.end(), "tmp_call");
+            node_functions[node_index] = find_func;
+            break;
+        }
+        }
+
+        node_stack.push_back(node_index);
+    }
+
+    // The reverse pass, the adjoints flow from the root to the
+    // leaves, a pre-order node is always after its parent
+    std::vector<llvm::Value*> adjoints(node_count, (llvm::Value*)NULL);
+    adjoints[0] = llvm::ConstantFP::get(double_type, 1.0);
+
+    if(variable_adjoints)
+        variable_adjoints->assign(mVariableList.size(), zero_fp);
+
+    for(unsigned int node_index=0; node_index < node_count; node_index++)
+    {
+        llvm::Value *adjoint = adjoints[node_index];
+        if(!adjoint)
+            continue;
+
+        if(node_symbols[node_index]!=ASTNode::NO_SYMBOL && variable_adjoints)
+        {
+            llvm::Value *&variable_adjoint = (*variable_adjoints)[node_symbols[node_index]];
+            variable_adjoint = builder.CreateFAdd(variable_adjoint, adjoint, "var_adjoint");
+            continue;
+        }
+
+        llvm::Function *func = node_functions[node_index];
+        if(!func)
+            continue;
+
+        const std::vector<unsigned int> &args = node_args[node_index];
+
+        std::vector<llvm::Value*> argument_list;
+        for(unsigned int i=0; i < args.size(); i++)
+            argument_list.push_back(node_values[args[i]]);
+
+        for(unsigned int i=0; i < args.size(); i++)
+        {
+            if(!variable_adjoints && !has_params[args[i]])
+                continue;
+
+            llvm::Function *derivative =
+                mInternalModule->getFunction(get_derivative_name(func->getNameStr(), i));
+            assert(derivative!=NULL && "Derivative not found !");
+            materialize_function(derivative);
+
+            llvm::Value *partial =
+                builder.CreateCall(derivative, argument_list.begin(),
+                                   argument_list.end(), "tmp_partial");
+            adjoints[args[i]] = builder.CreateFMul(adjoint, partial, "adjoint");
+        }
+    }
+
+    param_adjoints.resize(param_layout.size());
+    for(unsigned int param=0; param < param_layout.size(); param++)
+    {
+        llvm::Value *adjoint = adjoints[param_layout[param]];
+        param_adjoints[param] = adjoint ? adjoint : zero_fp;
+    }
+
+    return node_values[0];
+}
+
+llvm::Function* ModuleHandler::codegen_ast_gradient(const std::vector<ASTNode*> *ast_nodes,
+                                                    const std::string &func_name,
+                                                    std::vector<unsigned int> &param_layout,
+                                                    std::string &error_string)
+{
+    assert(mPrecision==PRECISION_DOUBLE && "Only generated in double precision !");
+
+    const double codegen_start = wall_time();
+
+    if(!check_derivatives(ast_nodes, error_string))
+        return NULL;
+
+    get_parameter_layout(ast_nodes, param_layout);
+
+    std::vector<llvm::Value*> variable_values;
+    llvm::Function *func = declare_gradient_function(func_name, variable_values);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    for(unsigned int var_index=0; var_index < mVariableList.size(); var_index++)
+        ++arg_it;
+    llvm::Value *params = arg_it++;
+    llvm::Value *grad = arg_it++;
+
+    llvm::BasicBlock *basic_block =
+        llvm::BasicBlock::Create(mInternalModule->getContext(), "entry", func);
+    llvm::IRBuilder<> builder(basic_block);
+
+    std::vector<llvm::Value*> constant_values;
+    load_parameter_values(builder, params, ast_nodes, param_layout, constant_values);
+
+    std::vector<llvm::Value*> param_adjoints;
+    std::vector<llvm::Value*> variable_adjoints;
+    llvm::Value *ret_value =
+        codegen_gradient_nodes(ast_nodes, basic_block, variable_values, constant_values,
+                               param_layout, param_adjoints, &variable_adjoints);
+
+    // The parameters first, then the variables
+    param_adjoints.insert(param_adjoints.end(), variable_adjoints.begin(),
+                          variable_adjoints.end());
+
+    builder.SetInsertPoint(basic_block);
+    const llvm::Type *index_type = llvm::Type::getInt32Ty(mInternalModule->getContext());
+    for(unsigned int i=0; i < param_adjoints.size(); i++)
+        builder.CreateStore(param_adjoints[i],
+                            builder.CreateGEP(grad, llvm::ConstantInt::get(index_type, i)));
+
+    builder.CreateRet(ret_value);
+
+    return record_codegen(func, codegen_start);
+}
+
+std::string ModuleHandler::get_interval_name(const std::string &func_name,
+                                             bool upper)
+{
+    return func_name + (upper ? "_hi" : "_lo");
+}
+
+bool ModuleHandler::check_interval_primitives(const std::vector<ASTNode*> *ast_nodes,
+                                              std::string &error_string)
+{
+    const llvm::Type *double_type = llvm::Type::getDoubleTy(mInternalModule->getContext());
+
+    for(unsigned int node_index=0; node_index < ast_nodes->size(); node_index++)
+    {
+        const ASTNode *node = (*ast_nodes)[node_index];
+        if(node->get_id()!=ASTNode::AST_FUNCTION)
+            continue;
+
+        const std::string &func_name = static_cast<const ASTFunction*>(node)->get_name();
+        const llvm::Function *func = mInternalModule->getFunction(func_name);
+        assert(func!=NULL && "Function not found !");
+
+        for(unsigned int upper=0; upper < 2; upper++)
+        {
+            const std::string interval_name = get_interval_name(func_name, upper);
+            const llvm::Function *interval = mInternalModule->getFunction(interval_name);
+
+            if(!interval)
+            {
+                error_string = "Interval primitive not found: " + interval_name;
+                return false;
+            }
+
+            // The bounds of every argument and the bound of the result are double
+            const llvm::FunctionType *interval_type = interval->getFunctionType();
+            bool valid_signature = interval_type->getReturnType()==double_type &&
+                                   interval->arg_size()==2*func->arg_size();
+            for(unsigned int i=0; valid_signature && i < interval->arg_size(); i++)
+                valid_signature = interval_type->getParamType(i)==double_type;
+
+            if(!valid_signature)
+            {
+                error_string = "Interval primitive with an invalid signature: " + interval_name;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+llvm::Function* ModuleHandler::codegen_ast_interval(const std::vector<ASTNode*> *ast_nodes,
+                                                    const std::string &func_name,
+                                                    std::string &error_string)
+{
+    assert(mPrecision==PRECISION_DOUBLE && "Only generated in double precision !");
+
+    const double codegen_start = wall_time();
+
+    if(!check_interval_primitives(ast_nodes, error_string))
+        return NULL;
+
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    const llvm::Type *double_type = llvm::Type::getDoubleTy(context);
+    const llvm::Type *double_ptr_type = llvm::PointerType::getUnqual(double_type);
+    const llvm::Type *index_type = llvm::Type::getInt32Ty(context);
+
+    std::vector<const llvm::Type*> func_proto(3, double_ptr_type);
+
+    llvm::FunctionType *func_type =
+        llvm::FunctionType::get(llvm::Type::getVoidTy(context), func_proto, false);
+
+    llvm::Function *func =
+        llvm::Function::Create(func_type, llvm::Function::ExternalLinkage,
+                               func_name, mInternalModule);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    llvm::Value *var_lo = arg_it++;
+    llvm::Value *var_hi = arg_it++;
+    llvm::Value *bounds = arg_it++;
+    var_lo->setName("var_lo");
+    var_hi->setName("var_hi");
+    bounds->setName("bounds");
+
+    llvm::BasicBlock *basic_block = llvm::BasicBlock::Create(context, "entry", func);
+    llvm::IRBuilder<> builder(basic_block);
+
+    std::vector<llvm::Value*> lo_values;
+    std::vector<llvm::Value*> hi_values;
+    for(unsigned int var_index=0; var_index < mVariableList.size(); var_index++)
+    {
+        llvm::Value *index = llvm::ConstantInt::get(index_type, var_index);
+        lo_values.push_back(builder.CreateLoad(builder.CreateGEP(var_lo, index),
+                                               mVariableList[var_index] + "_lo"));
+        hi_values.push_back(builder.CreateLoad(builder.CreateGEP(var_hi, index),
+                                               mVariableList[var_index] + "_hi"));
+    }
+
+    // The intervals of the subtrees, the first argument is on the top
+    std::vector<llvm::Value*> lo_stack;
+    std::vector<llvm::Value*> hi_stack;
+
+    for(int node_index=ast_nodes->size()-1; node_index >= 0; node_index--)
+    {
+        const ASTNode *node = (*ast_nodes)[node_index];
+        mGeneratedNodes++;
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_CONSTANT:
+        {
+            llvm::Value *value =
+                llvm::ConstantFP::get(double_type, static_cast<const ASTConstant*>(node)->get_value());
+            lo_stack.push_back(value);
+            hi_stack.push_back(value);
+            break;
+        }
+
+        case ASTNode::AST_VARIABLE:
+        {
+            const ASTVariable *variable = static_cast<const ASTVariable*>(node);
+
+            const int symbol = resolve_variable_symbol(variable);
+            assert(symbol!=ASTNode::NO_SYMBOL && "Variable not found !");
+
+            lo_stack.push_back(lo_values[symbol]);
+            hi_stack.push_back(hi_values[symbol]);
+            break;
+        }
+
+        case ASTNode::AST_FUNCTION:
+        {
+            const std::string &prim_name = static_cast<const ASTFunction*>(node)->get_name();
+
+            llvm::Function *lo_func = mInternalModule->getFunction(get_interval_name(prim_name, false));
+            llvm::Function *hi_func = mInternalModule->getFunction(get_interval_name(prim_name, true));
+            materialize_function(lo_func);
+            materialize_function(hi_func);
+
+            std::vector<llvm::Value*> argument_list;
+            for(unsigned int i=0; i < lo_func->arg_size()/2; i++)
+            {
+                argument_list.push_back(lo_stack.back());
+                argument_list.push_back(hi_stack.back());
+                lo_stack.pop_back();
+                hi_stack.pop_back();
+            }
+
+            lo_stack.push_back(builder.CreateCall(lo_func, argument_list.begin(),
+                                                  argument_list.end(), "tmp_lo"));
+            hi_stack.push_back(builder.CreateCall(hi_func, argument_list.begin(),
+                                                  argument_list.end(), "tmp_hi"));
+            break;
+        }
+        }
+    }
+
+    assert(lo_stack.size()==1 && hi_stack.size()==1 && "Malformed AST !");
+
+    builder.CreateStore(lo_stack.back(),
+                        builder.CreateGEP(bounds, llvm::ConstantInt::get(index_type, 0)));
+    builder.CreateStore(hi_stack.back(),
+                        builder.CreateGEP(bounds, llvm::ConstantInt::get(index_type, 1)));
+    builder.CreateRetVoid();
+
+    return record_codegen(func, codegen_start);
+}
+
+llvm::Function* ModuleHandler::codegen_ast_fitness_gradient(const std::vector<ASTNode*> *ast_nodes,
+                                                            const std::string &func_name,
+                                                            std::vector<unsigned int> &param_layout,
+                                                            std::string &error_string)
+{
+    assert(mPrecision==PRECISION_DOUBLE && "Only generated in double precision !");
+
+    const double codegen_start = wall_time();
+
+    if(!check_derivatives(ast_nodes, error_string))
+        return NULL;
+
+    get_parameter_layout(ast_nodes, param_layout);
+
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    llvm::Function *func = declare_fitness_gradient_function(func_name);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    llvm::Value *columns = arg_it++;
+    llvm::Value *target = arg_it++;
+    llvm::Value *n = arg_it++;
+    llvm::Value *params = arg_it++;
+    llvm::Value *grad = arg_it++;
+
+    const llvm::Type *size_type = n->getType();
+    const llvm::Type *double_type = llvm::Type::getDoubleTy(context);
+    const llvm::Type *index_type = llvm::Type::getInt32Ty(context);
+
+    llvm::BasicBlock *entry_block = llvm::BasicBlock::Create(context, "entry", func);
+    llvm::BasicBlock *loop_block = llvm::BasicBlock::Create(context, "loop", func);
+    llvm::BasicBlock *done_block = llvm::BasicBlock::Create(context, "done", func);
+    llvm::BasicBlock *empty_block = llvm::BasicBlock::Create(context, "empty", func);
+
+    llvm::IRBuilder<> builder(entry_block);
+
+    std::vector<llvm::Value*> column_list =
+        load_column_list(builder, columns, mVariableList);
+
+    // The parameters are loaded once, before the loop
+    std::vector<llvm::Value*> constant_values;
+    load_parameter_values(builder, params, ast_nodes, param_layout, constant_values);
+
+    llvm::Value *zero = llvm::ConstantInt::get(size_type, 0);
+    llvm::Value *zero_fp = llvm::ConstantFP::get(double_type, 0.0);
+    builder.CreateCondBr(builder.CreateICmpEQ(n, zero), empty_block, loop_block);
+
+    builder.SetInsertPoint(loop_block);
+    llvm::PHINode *index = builder.CreatePHI(size_type, "i");
+    index->addIncoming(zero, entry_block);
+    llvm::PHINode *error = builder.CreatePHI(double_type, "error");
+    error->addIncoming(zero_fp, entry_block);
+
+    std::vector<llvm::PHINode*> gradient;
+    for(unsigned int param=0; param < param_layout.size(); param++)
+    {
+        gradient.push_back(builder.CreatePHI(double_type, "gradient"));
+        gradient.back()->addIncoming(zero_fp, entry_block);
+    }
+
+    std::vector<llvm::Value*> variable_values;
+    load_row_values(builder, column_list, index, mVariableList, variable_values);
+
+    std::vector<llvm::Value*> param_adjoints;
+    llvm::Value *ret_value =
+        codegen_gradient_nodes(ast_nodes, loop_block, variable_values, constant_values,
+                               param_layout, param_adjoints, NULL);
+
+    builder.SetInsertPoint(loop_block);
+    llvm::Value *target_value = builder.CreateLoad(builder.CreateGEP(target, index), "y");
+    llvm::Value *residual = builder.CreateFSub(ret_value, target_value, "residual");
+    llvm::Value *next_error =
+        builder.CreateFAdd(error, builder.CreateFMul(residual, residual), "next_error");
+
+    // d(r^2)/dp = 2 r dr/dp
+    llvm::Value *twice_residual = builder.CreateFAdd(residual, residual, "twice_residual");
+
+    std::vector<llvm::Value*> next_gradient;
+    for(unsigned int param=0; param < param_layout.size(); param++)
+    {
+        next_gradient.push_back(
+            builder.CreateFAdd(gradient[param],
+                               builder.CreateFMul(twice_residual, param_adjoints[param]),
+                               "next_gradient"));
+        gradient[param]->addIncoming(next_gradient.back(), loop_block);
+    }
+
+    llvm::Value *next_index =
+        builder.CreateAdd(index, llvm::ConstantInt::get(size_type, 1), "next_i");
+    index->addIncoming(next_index, loop_block);
+    error->addIncoming(next_error, loop_block);
+    builder.CreateCondBr(builder.CreateICmpEQ(next_index, n), done_block, loop_block);
+
+    builder.SetInsertPoint(done_block);
+    for(unsigned int param=0; param < param_layout.size(); param++)
+        builder.CreateStore(next_gradient[param],
+                            builder.CreateGEP(grad, llvm::ConstantInt::get(index_type, param)));
+    builder.CreateRet(next_error);
+
+    builder.SetInsertPoint(empty_block);
+    for(unsigned int param=0; param < param_layout.size(); param++)
+        builder.CreateStore(zero_fp,
+                            builder.CreateGEP(grad, llvm::ConstantInt::get(index_type, param)));
+    builder.CreateRet(zero_fp);
+
+    return record_codegen(func, codegen_start);
+}
+
+llvm::Function* ModuleHandler::codegen_ast_vector(const std::vector<ASTNode*> *ast_nodes,
+                                                  const std::string &func_name,
+                                                  unsigned int vector_width)
+{
+    assert(mPrecision==PRECISION_DOUBLE && "Only generated in double precision !");
+
+    const double codegen_start = wall_time();
+
+    assert(vector_width > 0 && (vector_width & (vector_width-1))==0 &&
+           "Vector width must be a power of two !");
+
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    llvm::Function *func = declare_batch_function(func_name);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    llvm::Value *columns = arg_it++;
+    llvm::Value *out = arg_it++;
+    llvm::Value *n = arg_it++;
+
+    const llvm::Type *size_type = n->getType();
+    const llvm::Type *vector_ptr_type =
+        llvm::PointerType::getUnqual(llvm::VectorType::get(llvm::Type::getDoubleTy(context),
+                                                           vector_width));
+
+    llvm::BasicBlock *entry_block = llvm::BasicBlock::Create(context, "entry", func);
+    llvm::BasicBlock *vector_block = llvm::BasicBlock::Create(context, "vector_loop", func);
+    llvm::BasicBlock *check_block = llvm::BasicBlock::Create(context, "scalar_check", func);
+    llvm::BasicBlock *scalar_block = llvm::BasicBlock::Create(context, "scalar_loop", func);
+    llvm::BasicBlock *exit_block = llvm::BasicBlock::Create(context, "exit", func);
+
+    llvm::IRBuilder<> builder(entry_block);
+
+    std::vector<llvm::Value*> column_list =
+        load_column_list(builder, columns, mVariableList);
+
+    // Number of rows handled by the vector loop, the
+    // rest is handled by the scalar loop
+    llvm::Value *zero = llvm::ConstantInt::get(size_type, 0);
+    llvm::Value *vector_n =
+        builder.CreateAnd(n, llvm::ConstantInt::get(size_type, ~(uint64_t)(vector_width-1)),
+                          "vector_n");
+    builder.CreateCondBr(builder.CreateICmpEQ(vector_n, zero), check_block, vector_block);
+
+    // Vector loop
+    builder.SetInsertPoint(vector_block);
+    llvm::PHINode *vector_index = builder.CreatePHI(size_type, "i");
+    vector_index->addIncoming(zero, entry_block);
+
+    std::vector<llvm::Value*> vector_values;
+    for(unsigned int var_index=0; var_index < mVariableList.size(); var_index++)
+    {
+        llvm::Value *var_ptr =
+            builder.CreateBitCast(builder.CreateGEP(column_list[var_index], vector_index),
+                                  vector_ptr_type);
+        llvm::LoadInst *var_load = builder.CreateLoad(var_ptr, mVariableList[var_index]);
+        var_load->setAlignment(sizeof(double));
+        vector_values.push_back(var_load);
+    }
+
+    llvm::Value *vector_ret =
+        codegen_ast_nodes(ast_nodes, vector_block, vector_values, vector_width);
+
+    builder.SetInsertPoint(vector_block);
+    llvm::Value *out_ptr =
+        builder.CreateBitCast(builder.CreateGEP(out, vector_index), vector_ptr_type);
+    builder.CreateStore(vector_ret, out_ptr)->setAlignment(sizeof(double));
+
+    llvm::Value *next_vector_index =
+        builder.CreateAdd(vector_index, llvm::ConstantInt::get(size_type, vector_width), "next_i");
+    vector_index->addIncoming(next_vector_index, vector_block);
+    builder.CreateCondBr(builder.CreateICmpEQ(next_vector_index, vector_n),
+                         check_block, vector_block);
+
+    // Remaining rows
+    builder.SetInsertPoint(check_block);
+    builder.CreateCondBr(builder.CreateICmpEQ(vector_n, n), exit_block, scalar_block);
+
+    builder.SetInsertPoint(scalar_block);
+    llvm::PHINode *index = builder.CreatePHI(size_type, "j");
+    index->addIncoming(vector_n, check_block);
+
+    std::vector<llvm::Value*> variable_values;
+    load_row_values(builder, column_list, index, mVariableList, variable_values);
+
+    llvm::Value *ret_value = codegen_ast_nodes(ast_nodes, scalar_block, variable_values);
+
+    builder.SetInsertPoint(scalar_block);
+    builder.CreateStore(ret_value, builder.CreateGEP(out, index));
+
+    llvm::Value *next_index =
+        builder.CreateAdd(index, llvm::ConstantInt::get(size_type, 1), "next_j");
+    index->addIncoming(next_index, scalar_block);
+    builder.CreateCondBr(builder.CreateICmpEQ(next_index, n), exit_block, scalar_block);
+
+    builder.SetInsertPoint(exit_block);
+    builder.CreateRetVoid();
+
+    return record_codegen(func, codegen_start);
+}
+
+llvm::Function* ModuleHandler::codegen_ast_fitness(const std::vector<ASTNode*> *ast_nodes,
+                                                   const std::string &func_name,
+                                                   FitnessMetric metric)
+{
+    const double codegen_start = wall_time();
+
+    llvm::LLVMContext &context = mInternalModule->getContext();
+
+    llvm::Function *func = declare_fitness_function(func_name);
+
+    llvm::Function::arg_iterator arg_it = func->arg_begin();
+    llvm::Value *columns = arg_it++;
+    llvm::Value *target = arg_it++;
+    llvm::Value *n = arg_it++;
+
+    const llvm::Type *size_type = n->getType();
+    const llvm::Type *double_type = get_value_type();
+
+    llvm::BasicBlock *entry_block = llvm::BasicBlock::Create(context, "entry", func);
+    llvm::BasicBlock *loop_block = llvm::BasicBlock::Create(context, "loop", func);
+    llvm::BasicBlock *done_block = llvm::BasicBlock::Create(context, "done", func);
+    llvm::BasicBlock *empty_block = llvm::BasicBlock::Create(context, "empty", func);
+
+    llvm::IRBuilder<> builder(entry_block);
+
+    std::vector<llvm::Value*> column_list =
+        load_column_list(builder, columns, mVariableList);
+
+    llvm::Value *zero = llvm::ConstantInt::get(size_type, 0);
+    llvm::Value *zero_fp = llvm::ConstantFP::get(double_type, 0.0);
+    builder.CreateCondBr(builder.CreateICmpEQ(n, zero), empty_block, loop_block);
+
+    builder.SetInsertPoint(loop_block);
+    llvm::PHINode *index = builder.CreatePHI(size_type, "i");
+    index->addIncoming(zero, entry_block);
+    llvm::PHINode *error = builder.CreatePHI(double_type, "error");
+    error->addIncoming(zero_fp, entry_block);
+
+    std::vector<llvm::Value*> variable_values;
+    load_row_values(builder, column_list, index, mVariableList, variable_values);
+
+    llvm::Value *ret_value = codegen_ast_nodes(ast_nodes, loop_block, variable_values);
+
+    builder.SetInsertPoint(loop_block);
+    llvm::Value *target_value = builder.CreateLoad(builder.CreateGEP(target, index), "y");
+    if(target_value->getType()!=double_type)
+        target_value = builder.CreateFPExt(target_value, double_type);
+    llvm::Value *residual = builder.CreateFSub(ret_value, target_value, "residual");
+
+    llvm::Value *next_error = NULL;
+    switch(metric)
+    {
+    case FITNESS_SSE:
+    case FITNESS_MSE:
+        next_error = builder.CreateFAdd(error, builder.CreateFMul(residual, residual),
+                                        "next_error");
+        break;
+
+    case FITNESS_MAE:
+    case FITNESS_MAX_ABS:
+    {
+        llvm::Value *abs_residual =
+            builder.CreateSelect(builder.CreateFCmpOLT(residual, zero_fp),
+                                 builder.CreateFNeg(residual), residual, "abs_residual");
+
+        if(metric==FITNESS_MAE)
+        {
+            next_error = builder.CreateFAdd(error, abs_residual, "next_error");
+            break;
+        }
+
+        // The unordered comparison keeps a NaN error, and the
+        // second select makes a NaN residual stick as well
+        llvm::Value *max_error =
+            builder.CreateSelect(builder.CreateFCmpUGE(error, abs_residual),
+                                 error, abs_residual);
+        next_error =
+            builder.CreateSelect(builder.CreateFCmpUNO(abs_residual, abs_residual),
+                                 abs_residual, max_error, "next_error");
+        break;
+    }
+
+    default:
+        assert(false && "Unknown fitness metric !");
+        break;
+    }
+
+    llvm::Value *next_index =
+        builder.CreateAdd(index, llvm::ConstantInt::get(size_type, 1), "next_i");
+    index->addIncoming(next_index, loop_block);
+    error->addIncoming(next_error, loop_block);
+    builder.CreateCondBr(builder.CreateICmpEQ(next_index, n), done_block, loop_block);
+
+    builder.SetInsertPoint(done_block);
+    if(metric==FITNESS_MSE || metric==FITNESS_MAE)
+        builder.CreateRet(builder.CreateFDiv(next_error, builder.CreateUIToFP(n, double_type)));
+    else
+        builder.CreateRet(next_error);
+
+    builder.SetInsertPoint(empty_block);
+    builder.CreateRet(zero_fp);
+
+    return record_codegen(func, codegen_start);
+}
+
+std::vector<void*> ModuleHandler::compile_population(const std::vector<std::vector<ASTNode*> > &population,
+                                                     const std::string &name_prefix,
+                                                     KernelType kernel_type,
+                                                     OptimizationProfile profile)
+{
+    std::vector<std::string> func_names(population.size());
+    for(unsigned int i=0; i < population.size(); i++)
+    {
+        std::stringstream ss_name;
+        ss_name << name_prefix << i;
+        func_names[i] = ss_name.str();
+
+        // The module would rename the new functions, a prefix
+        // already in use is rejected
+        if(mInternalModule->getFunction(func_names[i]))
+            return std::vector<void*>(population.size(), static_cast<void*>(NULL));
+    }
+
+    std::vector<llvm::Function*> func_list;
+    func_list.reserve(population.size());
+
+    unsigned long population_nodes = 0;
+    for(unsigned int i=0; i < population.size(); i++)
+        population_nodes += population[i].size();
+
+    if(mSubtreeSharing)
+    {
+        // Counts the subtrees of the population, the ones
+        // found more than once will be shared
+        typedef tr1impl::unordered_map<uint64_t, unsigned int> SubtreeCountMap;
+        SubtreeCountMap subtree_count;
+
+        std::vector<unsigned int> subtree_sizes;
+        for(unsigned int i=0; i < population.size(); i++)
+        {
+            compute_subtree_sizes(&population[i], subtree_sizes);
+
+            for(unsigned int node_index=0; node_index < subtree_sizes.size(); node_index++)
+            {
+                if(subtree_sizes[node_index] < 2)
+                    continue;
+
+                const uint64_t hash =
+                    ASTNode::structural_hash(&population[i], node_index,
+                                             subtree_sizes[node_index]);
+                if(++subtree_count[hash]==2)
+                    mSharedHashes.insert(hash);
+            }
+        }
+    }
+
+    mGeneratedNodes = 0;
+
+    for(unsigned int i=0; i < population.size(); i++)
+    {
+        if(kernel_type==KERNEL_BATCH)
+            func_list.push_back(codegen_ast_batch(&population[i], func_names[i]));
+        else
+            func_list.push_back(codegen_ast(&population[i], func_names[i]));
+    }
+
+    mDeduplicatedNodes =
+        (population_nodes > mGeneratedNodes) ? population_nodes - mGeneratedNodes : 0;
+
+    // The pass initialization/finalization is done once for
+    // the entire population
+    llvm::FunctionPassManager *func_pass_manager = get_function_pass_manager(profile);
+    func_pass_manager->doInitialization();
+
+    const double helpers_start = wall_time();
+    for(unsigned int i=0; i < mNewSharedHelpers.size(); i++)
+    {
+        if(mForceInline)
+            inline_primitive_calls(mNewSharedHelpers[i]);
+        func_pass_manager->run(*mNewSharedHelpers[i]);
+    }
+    mCompileStats.function_passes_time += wall_time() - helpers_start;
+
+    for(unsigned int i=0; i < func_list.size(); i++)
+    {
+        if(!func_list[i])
+            continue;
+
+        if(mForceInline)
+            inline_primitive_calls(func_list[i]);
+
+        const double passes_start = wall_time();
+        func_pass_manager->run(*func_list[i]);
+        record_function_passes(func_list[i], passes_start);
+    }
+    func_pass_manager->doFinalization();
+
+    mSharedHashes.clear();
+    mNewSharedHelpers.clear();
+
+    std::vector<void*> func_ptrs;
+    func_ptrs.reserve(func_list.size());
+
+    for(unsigned int i=0; i < func_list.size(); i++)
+    {
+        llvm::Function *func = func_list[i];
+        if(!func)
+        {
+            func_ptrs.push_back(NULL);
+            continue;
+        }
+
+        const double jit_start = wall_time();
+        void *jit_func = mExecutionEngine->getPointerToFunction(func);
+        record_jit(func, jit_start);
+
+        if(jit_func)
+            mJITFunctions.insert(std::make_pair(func->getNameStr(), func));
+
+        func_ptrs.push_back(jit_func);
+    }
+
+    return func_ptrs;
+}
+
+llvm::Function* ModuleHandler::record_codegen(llvm::Function *func, double start_time)
+{
+    // The calls to a body not read couldn't be resolved by the JIT
+    if(mMaterializeFailed)
+    {
+        mMaterializeFailed = false;
+        func->eraseFromParent();
+        return NULL;
+    }
+
+    FunctionStats &stats = mFunctionStats[func->getNameStr()];
+    stats.codegen_time = wall_time() - start_time;
+    stats.instructions_before = count_instructions(func);
+
+    mCompileStats.codegen_time += stats.codegen_time;
+    mCompileStats.instructions_before += stats.instructions_before;
+    mCompileStats.generated_functions++;
+
+    return func;
+}
+
+void ModuleHandler::record_function_passes(llvm::Function *func, double start_time)
+{
+    const double passes_time = wall_time() - start_time;
+
+    FunctionStats &stats = mFunctionStats[func->getNameStr()];
+    stats.function_passes_time += passes_time;
+    stats.instructions_after = count_instructions(func);
+
+    mCompileStats.function_passes_time += passes_time;
+    mCompileStats.instructions_after += stats.instructions_after;
+    mCompileStats.optimized_functions++;
+}
+
+void ModuleHandler::record_jit(llvm::Function *func, double start_time)
+{
+    const double jit_time = wall_time() - start_time;
+
+    StatsListener *listener = static_cast<StatsListener*>(mStatsListener);
+
+    FunctionStats &stats = mFunctionStats[func->getNameStr()];
+    stats.jit_time += jit_time;
+    stats.machine_code_bytes = listener->get_function_bytes(func);
+
+    mCompileStats.jit_time += jit_time;
+    mCompileStats.machine_code_bytes += listener->take_emitted_bytes();
+    mCompileStats.jit_functions++;
+}
+
+ModuleHandler::CompileStats ModuleHandler::get_compile_stats() const
+{
+    CompileStats stats = mCompileStats;
+    stats.live_functions = mJITFunctions.size();
+    stats.live_machine_code_bytes =
+        static_cast<const StatsListener*>(mStatsListener)->get_live_bytes();
+    return stats;
+}
+
+bool ModuleHandler::get_function_stats(const std::string &func_name,
+                                       FunctionStats &stats) const
+{
+    FunctionStatsMap::const_iterator stats_it = mFunctionStats.find(func_name);
+    if(stats_it==mFunctionStats.end())
+        return false;
+
+    stats = stats_it->second;
+    return true;
+}
+
+void ModuleHandler::reset_compile_stats()
+{
+    mCompileStats = CompileStats();
+    mFunctionStats.clear();
+    static_cast<StatsListener*>(mStatsListener)->take_emitted_bytes();
+}
+
+void ModuleHandler::print_compile_stats(std::ostream &stream, bool function_stats) const
+{
+    const CompileStats stats = get_compile_stats();
+
+    stream << "{"
+           << "\"codegen_time\": " << stats.codegen_time
+           << ", \"function_passes_time\": " << stats.function_passes_time
+           << ", \"module_passes_time\": " << stats.module_passes_time
+           << ", \"jit_time\": " << stats.jit_time
+           << ", \"generated_functions\": " << stats.generated_functions
+           << ", \"optimized_functions\": " << stats.optimized_functions
+           << ", \"jit_functions\": " << stats.jit_functions
+           << ", \"instructions_before\": " << stats.instructions_before
+           << ", \"instructions_after\": " << stats.instructions_after
+           << ", \"machine_code_bytes\": " << stats.machine_code_bytes
+           << ", \"live_functions\": " << stats.live_functions
+           << ", \"live_machine_code_bytes\": " << stats.live_machine_code_bytes;
+
+    if(function_stats)
+    {
+        stream << ", \"functions\": {";
+
+        for(FunctionStatsMap::const_iterator it = mFunctionStats.begin();
+            it != mFunctionStats.end(); it++)
+        {
+            if(it!=mFunctionStats.begin())
+                stream << ", ";
+
+            const FunctionStats &func_stats = it->second;
+            print_json_string(stream, it->first);
+            stream << ": {"
+                   << "\"codegen_time\": " << func_stats.codegen_time
+                   << ", \"function_passes_time\": " << func_stats.function_passes_time
+                   << ", \"jit_time\": " << func_stats.jit_time
+                   << ", \"instructions_before\": " << func_stats.instructions_before
+                   << ", \"instructions_after\": " << func_stats.instructions_after
+                   << ", \"machine_code_bytes\": " << func_stats.machine_code_bytes
+                   << "}";
+        }
+
+        stream << "}";
+    }
+
+    stream << "}";
+}
+
+void ModuleHandler::set_variable_list(const std::vector<std::string> &var_list)
+{
+    assert(var_list.size()>0);
+    mVariableList = var_list;
+
+    mVariableSymbols.clear();
+    for(unsigned int var_index=0; var_index < var_list.size(); var_index++)
+        mVariableSymbols[var_list[var_index]] = var_index;
+
+    // The helpers have the prototype of the previous list
+    mSharedHelpers.clear();
+}
+
+int ModuleHandler::get_function_symbol(const std::string &func_name) const
+{
+    SymbolMap::const_iterator symbol_it = mFunctionSymbols.find(func_name);
+    if(symbol_it==mFunctionSymbols.end())
+        return ASTNode::NO_SYMBOL;
+    return symbol_it->second;
+}
+
+int ModuleHandler::get_variable_symbol(const std::string &var_name) const
+{
+    SymbolMap::const_iterator symbol_it = mVariableSymbols.find(var_name);
+    if(symbol_it==mVariableSymbols.end())
+        return ASTNode::NO_SYMBOL;
+    return symbol_it->second;
+}
+
+int ModuleHandler::resolve_variable_symbol(const ASTVariable *variable) const
+{
+    // A symbol resolved before a set_variable_list() may be stale
+    const int symbol = variable->get_symbol();
+    if(symbol >= 0 && symbol < (int)mVariableList.size() &&
+       mVariableList[symbol]==variable->get_name())
+        return symbol;
+
+    return get_variable_symbol(variable->get_name());
+}
+
+llvm::Function *ModuleHandler::resolve_function(const ASTFunction *function) const
+{
+    // A symbol resolved against another handler may be stale
+    const int symbol = function->get_symbol();
+    if(symbol >= 0 && symbol < (int)mFunctionTable.size() &&
+       mFunctionTable[symbol]->getName()==function->get_name())
+        return mFunctionTable[symbol];
+
+    return mInternalModule->getFunction(function->get_name());
+}
+
+bool ModuleHandler::resolve_symbols(const std::vector<ASTNode*> *ast_nodes,
+                                    std::string &error_string) const
+{
+    bool ret_resolve = true;
+
+    for(unsigned int i=0; i < ast_nodes->size(); i++)
+    {
+        ASTNode *node = (*ast_nodes)[i];
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_VARIABLE:
+        {
+            ASTVariable *variable = static_cast<ASTVariable*>(node);
+            variable->set_symbol(get_variable_symbol(variable->get_name()));
+            if(variable->get_symbol()==ASTNode::NO_SYMBOL)
+            {
+                error_string = "Variable not found: " + variable->get_name();
+                ret_resolve = false;
+            }
+            break;
+        }
+
+        case ASTNode::AST_FUNCTION:
+        {
+            ASTFunction *function = static_cast<ASTFunction*>(node);
+            function->set_symbol(get_function_symbol(function->get_name()));
+            if(function->get_symbol()==ASTNode::NO_SYMBOL)
+            {
+                error_string = "Function not found: " + function->get_name();
+                ret_resolve = false;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    return ret_resolve;
+}
+
+void* ModuleHandler::jit_function(const std::string &func_name)
+{
+    llvm::Function *func = mExecutionEngine->FindFunctionNamed(func_name.c_str());
+    if(!func) return NULL;
+
+    const double jit_start = wall_time();
+    void *jit_func = mExecutionEngine->recompileAndRelinkFunction(func);
+    record_jit(func, jit_start);
+
+    if(jit_func)
+        mJITFunctions.insert(std::make_pair(func_name, func));
+
+    return jit_func;
+}
+
+void* ModuleHandler::get_primitive_pointer(const std::string &func_name,
+                                           unsigned int *arg_size)
+{
+    llvm::Function *func = mInternalModule->getFunction(func_name);
+    if(!func) return NULL;
+
+    if(!materialize_function(func))
+    {
+        mMaterializeFailed = false;
+        return NULL;
+    }
+
+    if(arg_size)
+        *arg_size = func->arg_size();
+
+    return mExecutionEngine->getPointerToFunction(func);
+}
+
+uint64_t ModuleHandler::get_primitive_hash() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for(unsigned int symbol=0; symbol < mFunctionTable.size(); symbol++)
+    {
+        // The bodies of a lazily loaded module are part of the hash
+        std::string i_error_string;
+        mFunctionTable[symbol]->Materialize(&i_error_string);
+
+        std::string function_ir;
+        llvm::raw_string_ostream ir_stream(function_ir);
+        mFunctionTable[symbol]->print(ir_stream);
+        ir_stream.flush();
+
+        // FNV-1a
+        for(unsigned int i=0; i < function_ir.size(); i++)
+        {
+            hash ^= static_cast<unsigned char>(function_ir[i]);
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+bool ModuleHandler::get_function_bitcode(const std::string &func_name,
+                                         std::string &bitcode,
+                                         std::string &error_string) const
+{
+    llvm::Function *func = mInternalModule->getFunction(func_name);
+    if(!func || func->isDeclaration())
+    {
+        error_string = "Function not found: " + func_name;
+        return false;
+    }
+
+    llvm::Module *module = new llvm::Module(func_name, mInternalModule->getContext());
+    module->setDataLayout(mInternalModule->getDataLayout());
+    module->setTargetTriple(mInternalModule->getTargetTriple());
+
+    llvm::ValueToValueMapTy value_map;
+
+    // The called functions are declared in the new module
+    for(llvm::inst_iterator inst_it = llvm::inst_begin(func);
+        inst_it != llvm::inst_end(func); ++inst_it)
+    {
+        for(unsigned int i=0; i < inst_it->getNumOperands(); i++)
+        {
+            llvm::GlobalValue *global = llvm::dyn_cast<llvm::GlobalValue>(inst_it->getOperand(i));
+            if(!global || value_map.count(global))
+                continue;
+
+            llvm::Function *callee = llvm::dyn_cast<llvm::Function>(global);
+            if(!callee || callee->hasLocalLinkage())
+            {
+                error_string = "Function references an internal value: " + global->getNameStr();
+                delete module;
+                return false;
+            }
+
+            llvm::Function *declaration =
+                llvm::Function::Create(callee->getFunctionType(), llvm::Function::ExternalLinkage,
+                                       callee->getName(), module);
+            declaration->setAttributes(callee->getAttributes());
+            value_map[callee] = declaration;
+        }
+    }
+
+    llvm::Function *new_func =
+        llvm::Function::Create(func->getFunctionType(), func->getLinkage(),
+                               func->getName(), module);
+
+    llvm::Function::arg_iterator new_arg_it = new_func->arg_begin();
+    for(llvm::Function::const_arg_iterator arg_it = func->arg_begin();
+        arg_it != func->arg_end(); ++arg_it, ++new_arg_it)
+    {
+        new_arg_it->setName(arg_it->getName());
+        value_map[arg_it] = new_arg_it;
+    }
+
+    llvm::SmallVector<llvm::ReturnInst*, 4> returns;
+    llvm::CloneFunctionInto(new_func, func, value_map, true, returns);
+
+    bitcode.clear();
+    llvm::raw_string_ostream bitcode_stream(bitcode);
+    llvm::WriteBitcodeToFile(module, bitcode_stream);
+    bitcode_stream.flush();
+
+    delete module;
+    return true;
+}
+
+llvm::Function *ModuleHandler::link_function_bitcode(const std::string &bitcode,
+                                                     const std::string &func_name,
+                                                     std::string &error_string)
+{
+    if(mInternalModule->getFunction(func_name))
+    {
+        error_string = "Function already exists: " + func_name;
+        return NULL;
+    }
+
+    llvm::MemoryBuffer *buffer = llvm::MemoryBuffer::getMemBufferCopy(bitcode, func_name);
+
+    std::string i_error_string;
+    llvm::Module *module =
+        llvm::ParseBitcodeFile(buffer, mInternalModule->getContext(), &i_error_string);
+    delete buffer;
+
+    if(!module)
+    {
+        error_string = "Error while parsing bitcode: [ " + i_error_string + " ]";
+        return NULL;
+    }
+
+    // The only function defined is the generated one
+    llvm::Function *func = NULL;
+    for(llvm::Module::iterator func_it = module->begin();
+        func_it != module->end(); ++func_it)
+    {
+        if(func_it->isDeclaration())
+            continue;
+
+        if(func)
+        {
+            error_string = "Bitcode with more than one function defined.";
+            delete module;
+            return NULL;
+        }
+        func = func_it;
+    }
+
+    if(!func)
+    {
+        error_string = "Bitcode without functions defined.";
+        delete module;
+        return NULL;
+    }
+
+    func->setName(func_name);
+    if(func->getName()!=func_name)
+    {
+        error_string = "Function name conflicts with a primitive: " + func_name;
+        delete module;
+        return NULL;
+    }
+
+    const bool ret_link = llvm::Linker::LinkModules(mInternalModule, module, &i_error_string);
+    delete module;
+
+    if(ret_link)
+    {
+        error_string = "Error while linking function: [ " + i_error_string + " ]";
+        return NULL;
+    }
+
+    return mInternalModule->getFunction(func_name);
+}
+
+bool ModuleHandler::infer_primitive_attributes(std::string &report)
+{
+    std::string i_error_string;
+
+    if(mInternalModule->MaterializeAll(&i_error_string))
+    {
+        report = "Error while reading function bodies: [ " + i_error_string + " ]";
+        return false;
+    }
+
+    // The defined primitives start without effects, and their effects
+    // grow until nothing changes, so the recursive primitives are handled
+    AttributeMap inferred;
+    for(unsigned int symbol=0; symbol < mFunctionTable.size(); symbol++)
+    {
+        if(mFunctionTable[symbol]->isDeclaration())
+            continue;
+
+        FunctionAttributes &attributes = inferred[mFunctionTable[symbol]];
+        attributes.effect = EFFECT_NONE;
+        attributes.no_unwind = true;
+    }
+
+    std::map<const llvm::Function*, std::string> reasons;
+    bool changed = true;
+    while(changed)
+    {
+        changed = false;
+        for(AttributeMap::iterator attr_it = inferred.begin();
+            attr_it != inferred.end(); ++attr_it)
+        {
+            std::string reason;
+            const FunctionAttributes attributes =
+                get_body_attributes(attr_it->first, inferred, reason);
+
+            if(attributes.effect!=attr_it->second.effect ||
+               attributes.no_unwind!=attr_it->second.no_unwind)
+            {
+                attr_it->second = attributes;
+                reasons[attr_it->first] = reason;
+                changed = true;
+            }
+        }
+    }
+
+    std::stringstream ss_report;
+    for(unsigned int symbol=0; symbol < mFunctionTable.size(); symbol++)
+    {
+        llvm::Function *func = mFunctionTable[symbol];
+        ss_report << func->getNameStr() << ": ";
+
+        AttributeMap::const_iterator attr_it = inferred.find(func);
+        if(attr_it==inferred.end())
+        {
+            ss_report << "external\n";
+            continue;
+        }
+
+        // The attributes already declared are kept
+        switch(attr_it->second.effect)
+        {
+        case EFFECT_NONE:
+            func->setDoesNotAccessMemory();
+            ss_report << "readnone";
+            break;
+
+        case EFFECT_READ:
+            if(!func->doesNotAccessMemory())
+                func->setOnlyReadsMemory();
+            ss_report << "readonly (" << reasons[func] << ")";
+            break;
+
+        default:
+            ss_report << "side effects (" << reasons[func] << ")";
+            break;
+        }
+
+        if(attr_it->second.no_unwind)
+        {
+            func->setDoesNotThrow();
+            ss_report << ", nounwind";
+        }
+        ss_report << "\n";
+    }
+
+    report = ss_report.str();
+    mAttributesInferred = true;
+    return true;
+}
+
+bool ModuleHandler::is_primitive_pure(const std::string &func_name) const
+{
+    const int symbol = get_function_symbol(func_name);
+    if(symbol==ASTNode::NO_SYMBOL)
+        return false;
+
+    const llvm::Function *func = mFunctionTable[symbol];
+    return func->doesNotAccessMemory() && func->doesNotThrow();
+}
+
+unsigned int ModuleHandler::get_materializable_count() const
+{
+    unsigned int materializable_count = 0;
+
+    for(unsigned int symbol=0; symbol < mFunctionTable.size(); symbol++)
+    {
+        if(mFunctionTable[symbol]->isMaterializable())
+            materializable_count++;
+    }
+
+    return materializable_count;
+}
+
+bool ModuleHandler::materialize_function(llvm::Function *func)
+{
+    assert(func!=NULL);
+
+    if(!func->isMaterializable())
+        return true;
+
+    std::string i_error_string;
+    if(func->Materialize(&i_error_string))
+    {
+        mMaterializeFailed = true;
+        mMaterializeError = "Error while reading the body of " + func->getNameStr() +
+                            ": [ " + i_error_string + " ]";
+        return false;
+    }
+
+    return true;
+}
+
+bool ModuleHandler::is_recursive_function(llvm::Function *func)
+{
+    // Depth-first search of the callees, looking for the function
+    std::vector<llvm::Function*> caller_stack(1, func);
+    tr1impl::unordered_set<llvm::Function*> visited;
+
+    while(!caller_stack.empty())
+    {
+        llvm::Function *caller = caller_stack.back();
+        caller_stack.pop_back();
+
+        if(!materialize_function(caller))
+            continue;
+
+        for(llvm::inst_iterator inst_it = llvm::inst_begin(caller);
+            inst_it != llvm::inst_end(caller); ++inst_it)
+        {
+            const llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&*inst_it);
+            if(!call)
+                continue;
+
+            llvm::Function *callee = call->getCalledFunction();
+            if(!callee || callee->isIntrinsic())
+                continue;
+
+            if(callee==func)
+                return true;
+
+            if(visited.insert(callee).second)
+                caller_stack.push_back(callee);
+        }
+    }
+
+    return false;
+}
+
+unsigned int ModuleHandler::inline_primitive_calls(llvm::Function *func)
+{
+    llvm::InlineFunctionInfo inline_info(NULL, mExecutionEngine->getTargetData());
+
+    // Inlining a recursive primitive would only bring its calls back
+    tr1impl::unordered_map<llvm::Function*, bool> recursive_map;
+
+    // Each round inlines the calls brought by the previous one
+    for(unsigned int depth=0; depth < MAX_INLINE_DEPTH; depth++)
+    {
+        std::vector<llvm::CallInst*> primitive_calls;
+
+        for(llvm::inst_iterator inst_it = llvm::inst_begin(func);
+            inst_it != llvm::inst_end(func); ++inst_it)
+        {
+            llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&*inst_it);
+            if(!call)
+                continue;
+
+            llvm::Function *callee = call->getCalledFunction();
+            if(!callee || get_function_symbol(callee->getNameStr())==ASTNode::NO_SYMBOL)
+                continue;
+
+            if(!materialize_function(callee) || callee->isDeclaration())
+                continue;
+
+            if(!recursive_map.count(callee))
+                recursive_map[callee] = is_recursive_function(callee);
+
+            if(!recursive_map[callee])
+                primitive_calls.push_back(call);
+        }
+
+        if(primitive_calls.empty())
+            break;
+
+        for(unsigned int i=0; i < primitive_calls.size(); i++)
+            llvm::InlineFunction(primitive_calls[i], inline_info);
+    }
+
+    // The calls to the bodies not read are left, the JIT reports them
+    mMaterializeFailed = false;
+
+    return count_calls(func);
+}
+
+unsigned int ModuleHandler::get_call_count(const std::string &func_name) const
+{
+    const llvm::Function *func = mInternalModule->getFunction(func_name);
+    assert(func!=NULL && "Function not found !");
+    return func ? count_calls(func) : 0;
 }
 
 bool ModuleHandler::free_jit_memory(const std::string &func_name)
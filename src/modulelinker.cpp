@@ -31,12 +31,16 @@ namespace shine
 {
 
 ModuleLinker::ModuleLinker(const std::string &prog_name,
-                           const std::string &module_name)
+                           const std::string &module_name,
+                           llvm::LLVMContext *context)
 {
+    if(!context)
+        context = &llvm::getGlobalContext();
+
     mInternalLinker =
         new llvm::Linker(prog_name.c_str(),
                          module_name.c_str(),
-                         llvm::getGlobalContext());
+                         *context);
 
     assert(mInternalLinker!=NULL);
 }
@@ -58,6 +62,10 @@ bool ModuleLinker::link_module_loader(ModuleLoader *module_loader,
 
     assert(llvm_module!=NULL);
 
+    // The linker needs the bodies of a lazily loaded module
+    if(!module_loader->materialize_all(error_string))
+        return false;
+
     const bool ret_link =
         mInternalLinker->LinkInModule(llvm_module, &i_error_string);
 
@@ -27,12 +27,24 @@
 #include <llvm/LLVMContext.h>
 #include <llvm/Support/system_error.h>
 #include <llvm/Type.h>
+#include <llvm/DerivedTypes.h>
 
 #include <sstream>
 
 namespace shine
 {
 
+/**
+ * Returns the scalar type of the type, the element type of the
+ * vectors used by the vector variants of the functions.
+ */
+static const llvm::Type *get_scalar_type(const llvm::Type *type)
+{
+    if(type->isVectorTy())
+        return llvm::cast<llvm::VectorType>(type)->getElementType();
+    return type;
+}
+
 ModuleLoader::ModuleLoader(llvm::Module *module)
 : mInternalModule(module)
 {
@@ -44,8 +56,44 @@ ModuleLoader::~ModuleLoader()
     delete mInternalModule;
 }
 
+llvm::Module *ModuleLoader::release_module()
+{
+    llvm::Module *module = mInternalModule;
+    mInternalModule = NULL;
+    return module;
+}
+
+unsigned int ModuleLoader::get_materializable_count() const
+{
+    unsigned int materializable_count = 0;
+
+    for(llvm::Module::const_iterator func_it = mInternalModule->begin();
+        func_it != mInternalModule->end(); ++func_it)
+    {
+        if(func_it->isMaterializable())
+            materializable_count++;
+    }
+
+    return materializable_count;
+}
+
+bool ModuleLoader::materialize_all(std::string &error_string)
+{
+    std::string i_error_string;
+
+    if(mInternalModule->MaterializeAll(&i_error_string))
+    {
+        error_string = "Error while reading function bodies: [" + i_error_string + "]";
+        return false;
+    }
+
+    return true;
+}
+
 ModuleLoader *ModuleLoader::create_from_memory_buffer(llvm::MemoryBuffer *memory_buffer,
-                                                      std::string &error_string)
+                                                      std::string &error_string,
+                                                      llvm::LLVMContext *context,
+                                                      bool lazy)
 {
 
     if(!memory_buffer)
@@ -56,8 +104,13 @@ ModuleLoader *ModuleLoader::create_from_memory_buffer(llvm::MemoryBuffer *memory
 
     std::string i_error_string;
 
-    llvm::Module *module =
-        llvm::ParseBitcodeFile(memory_buffer, llvm::getGlobalContext(), &i_error_string);
+    if(!context)
+        context = &llvm::getGlobalContext();
+
+    // The lazy module reads the function bodies from the buffer when needed
+    llvm::Module *module = lazy ?
+        llvm::getLazyBitcodeModule(memory_buffer, *context, &i_error_string) :
+        llvm::ParseBitcodeFile(memory_buffer, *context, &i_error_string);
 
     if(!module)
     {
@@ -71,7 +124,9 @@ ModuleLoader *ModuleLoader::create_from_memory_buffer(llvm::MemoryBuffer *memory
 
 
 ModuleLoader *ModuleLoader::create_from_file(const std::string &filename,
-                                             std::string &error_string)
+                                             std::string &error_string,
+                                             llvm::LLVMContext *context,
+                                             bool lazy)
 {
     llvm::OwningPtr<llvm::MemoryBuffer> buffer;
 
@@ -88,12 +143,17 @@ ModuleLoader *ModuleLoader::create_from_file(const std::string &filename,
     }
 
     ModuleLoader *loader =
-        ModuleLoader::create_from_memory_buffer(buffer.get(), error_string);
+        ModuleLoader::create_from_memory_buffer(buffer.get(), error_string, context, lazy);
+
+    // The lazy module owns the buffer, large files are mapped
+    // in memory by the MemoryBuffer instead of being read
+    if(loader && lazy)
+        buffer.take();
 
     return loader;
 }
 
-bool ModuleLoader::check_closure(std::string &error_string)
+bool ModuleLoader::check_closure(std::string &error_string, bool accept_float)
 {
     bool closure_checking = true;
     std::stringstream ss_error;
@@ -105,12 +165,18 @@ bool ModuleLoader::check_closure(std::string &error_string)
         it != f_list.end(); it++)
     {
         const llvm::Function *func = it;
-        const bool is_ret_double = func->getReturnType()->isDoubleTy();
 
-        if(!is_ret_double)
+        // The return type selects the closure of the function, the
+        // arguments of the vector variants are vectors of the same width
+        const llvm::Type *closure_type = func->getReturnType();
+        const llvm::Type *scalar_type = get_scalar_type(closure_type);
+        const bool is_float = accept_float && scalar_type->isFloatTy();
+
+        if(!scalar_type->isDoubleTy() && !is_float)
         {
             ss_error << "Function " << func->getNameStr() << " isn't returning double !\n";
             closure_checking = false;
+            closure_type = llvm::Type::getDoubleTy(func->getContext());
         }
 
         const llvm::Function::ArgumentListType &a_list = func->getArgumentList();
@@ -118,10 +184,11 @@ bool ModuleLoader::check_closure(std::string &error_string)
             it_arg != a_list.end(); it_arg++)
         {
             const llvm::Argument *arg = it_arg;
-            const bool is_arg_double = arg->getType()->isDoubleTy();
-            if(!is_arg_double)
+            const bool is_arg_closure = arg->getType()==closure_type;
+            if(!is_arg_closure)
             {
-                ss_error << "Argument " << func->getNameStr() << "[" << arg->getNameStr() << "] isn't double !\n";
+                ss_error << "Argument " << func->getNameStr() << "[" << arg->getNameStr()
+                         << "] isn't " << closure_type->getDescription() << " !\n";
                 closure_checking = false;
             }
         }
@@ -0,0 +1,339 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "simplifier.h"
+
+#include "modulehandler.h"
+#include "interpreter.h"
+#include "astnode.h"
+
+#include <cassert>
+
+namespace shine
+{
+
+/**
+ * Returns true if the node is a wildcard of a PatternRule.
+ */
+static bool is_wildcard(const ASTNode *node)
+{
+    if(node->get_id()!=ASTNode::AST_VARIABLE)
+        return false;
+
+    const std::string &name = static_cast<const ASTVariable*>(node)->get_name();
+    return !name.empty() && name[0]=='?';
+}
+
+/**
+ * Deletes the nodes of the tree and clears it.
+ */
+static void delete_nodes(std::vector<ASTNode*> &ast_nodes)
+{
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    ast_nodes.clear();
+}
+
+PatternRule::PatternRule(const std::vector<ASTNode*> &pattern,
+                         const std::vector<ASTNode*> &replacement)
+{
+    assert(!pattern.empty() && !replacement.empty());
+
+    for(unsigned int i=0; i < pattern.size(); i++)
+        mPattern.push_back(Simplifier::clone_node(pattern[i]));
+
+    for(unsigned int i=0; i < replacement.size(); i++)
+        mReplacement.push_back(Simplifier::clone_node(replacement[i]));
+}
+
+PatternRule::~PatternRule()
+{
+    delete_nodes(mPattern);
+    delete_nodes(mReplacement);
+}
+
+bool PatternRule::rewrite(Simplifier &simplifier,
+                          const std::vector<ASTNode*> &subtree,
+                          std::vector<ASTNode*> &rewritten)
+{
+    BindingMap bindings;
+    unsigned int subtree_index = 0;
+
+    // The functions have the same number of arguments in both trees,
+    // so they are walked together, skipping the wildcard subtrees
+    for(unsigned int pattern_index=0; pattern_index < mPattern.size(); pattern_index++)
+    {
+        if(subtree_index >= subtree.size())
+            return false;
+
+        const ASTNode *pattern_node = mPattern[pattern_index];
+        const ASTNode *node = subtree[subtree_index];
+
+        if(is_wildcard(pattern_node))
+        {
+            const std::string &name = static_cast<const ASTVariable*>(pattern_node)->get_name();
+
+            Binding binding;
+            binding.begin = subtree_index;
+            binding.size = simplifier.get_subtree_size(subtree, subtree_index);
+
+            BindingMap::const_iterator bind_it = bindings.find(name);
+            if(bind_it==bindings.end())
+                bindings[name] = binding;
+            else if(bind_it->second.size!=binding.size ||
+                    ASTNode::structural_key(&subtree, bind_it->second.begin, bind_it->second.size)!=
+                    ASTNode::structural_key(&subtree, binding.begin, binding.size))
+                return false;
+
+            subtree_index += binding.size;
+            continue;
+        }
+
+        if(pattern_node->get_id()!=node->get_id())
+            return false;
+
+        switch(node->get_id())
+        {
+        case ASTNode::AST_VARIABLE:
+            if(static_cast<const ASTVariable*>(pattern_node)->get_name()!=
+               static_cast<const ASTVariable*>(node)->get_name())
+                return false;
+            break;
+
+        case ASTNode::AST_CONSTANT:
+            if(static_cast<const ASTConstant*>(pattern_node)->get_value()!=
+               static_cast<const ASTConstant*>(node)->get_value())
+                return false;
+            break;
+
+        case ASTNode::AST_FUNCTION:
+            if(static_cast<const ASTFunction*>(pattern_node)->get_name()!=
+               static_cast<const ASTFunction*>(node)->get_name())
+                return false;
+            break;
+        }
+
+        subtree_index++;
+    }
+
+    if(subtree_index!=subtree.size())
+        return false;
+
+    for(unsigned int i=0; i < mReplacement.size(); i++)
+    {
+        if(!is_wildcard(mReplacement[i]))
+        {
+            rewritten.push_back(Simplifier::clone_node(mReplacement[i]));
+            continue;
+        }
+
+        BindingMap::const_iterator bind_it =
+            bindings.find(static_cast<const ASTVariable*>(mReplacement[i])->get_name());
+        assert(bind_it!=bindings.end() && "Replacement wildcard not in the pattern !");
+
+        for(unsigned int j=0; j < bind_it->second.size; j++)
+            rewritten.push_back(Simplifier::clone_node(subtree[bind_it->second.begin + j]));
+    }
+
+    return true;
+}
+
+Simplifier::Simplifier(ModuleHandler *handler, unsigned int max_rewrites)
+: mHandler(handler), mMaxRewrites(max_rewrites),
+  mFoldedCount(0), mRewrittenCount(0)
+{
+    assert(handler && "No Module Handler provided !");
+
+    // The constant folding needs to know the pure primitives
+    if(!mHandler->get_attributes_inferred())
+    {
+        std::string report;
+        mHandler->infer_primitive_attributes(report);
+    }
+}
+
+Simplifier::~Simplifier()
+{
+    for(unsigned int i=0; i < mRules.size(); i++)
+        delete mRules[i];
+}
+
+void Simplifier::add_rule(RewriteRule *rule)
+{
+    assert(rule!=NULL);
+    mRules.push_back(rule);
+}
+
+ASTNode *Simplifier::clone_node(const ASTNode *node)
+{
+    switch(node->get_id())
+    {
+    case ASTNode::AST_VARIABLE:
+    {
+        const ASTVariable *variable = static_cast<const ASTVariable*>(node);
+        ASTVariable *new_variable = new ASTVariable(variable->get_name());
+        new_variable->set_symbol(variable->get_symbol());
+        return new_variable;
+    }
+
+    case ASTNode::AST_CONSTANT:
+        return new ASTConstant(static_cast<const ASTConstant*>(node)->get_value());
+
+    case ASTNode::AST_FUNCTION:
+    default:
+    {
+        const ASTFunction *function = static_cast<const ASTFunction*>(node);
+        ASTFunction *new_function = new ASTFunction(function->get_name());
+        new_function->set_symbol(function->get_symbol());
+        return new_function;
+    }
+    }
+}
+
+const Simplifier::Primitive &Simplifier::get_primitive(const std::string &func_name)
+{
+    PrimitiveMap::const_iterator prim_it = mPrimitives.find(func_name);
+    if(prim_it!=mPrimitives.end())
+        return prim_it->second;
+
+    Primitive primitive;
+    primitive.pointer = mHandler->get_primitive_pointer(func_name, &primitive.arg_size);
+    primitive.pure = mHandler->is_primitive_pure(func_name);
+    assert(primitive.pointer!=NULL && "Primitive not found !");
+
+    return mPrimitives[func_name] = primitive;
+}
+
+unsigned int Simplifier::get_arity(const std::string &func_name)
+{
+    return get_primitive(func_name).arg_size;
+}
+
+unsigned int Simplifier::get_subtree_size(const std::vector<ASTNode*> &ast_nodes,
+                                          unsigned int begin)
+{
+    unsigned int node_index = begin;
+    unsigned int pending = 1;
+
+    while(pending > 0)
+    {
+        assert(node_index < ast_nodes.size() && "Malformed AST !");
+        const ASTNode *node = ast_nodes[node_index++];
+        pending--;
+
+        if(node->get_id()==ASTNode::AST_FUNCTION)
+            pending += get_arity(static_cast<const ASTFunction*>(node)->get_name());
+    }
+
+    return node_index - begin;
+}
+
+bool Simplifier::fold_constants(std::vector<ASTNode*> &subtree)
+{
+    const Primitive &primitive =
+        get_primitive(static_cast<const ASTFunction*>(subtree[0])->get_name());
+
+    // A call with side effects must be kept
+    if(!primitive.pure || primitive.arg_size > Interpreter::MAX_ARG_SIZE ||
+       subtree.size()!=primitive.arg_size+1)
+        return false;
+
+    double args[Interpreter::MAX_ARG_SIZE];
+    for(unsigned int i=0; i < primitive.arg_size; i++)
+    {
+        const ASTNode *arg = subtree[i+1];
+        if(arg->get_id()!=ASTNode::AST_CONSTANT)
+            return false;
+        args[i] = static_cast<const ASTConstant*>(arg)->get_value();
+    }
+
+    const double value =
+        Interpreter::call_primitive(primitive.pointer, primitive.arg_size, args);
+
+    delete_nodes(subtree);
+    subtree.push_back(new ASTConstant(value));
+    mFoldedCount++;
+    return true;
+}
+
+void Simplifier::simplify_nodes(const std::vector<ASTNode*> &ast_nodes,
+                                std::vector<ASTNode*> &simplified,
+                                unsigned int &rewrites)
+{
+    // The simplified subtrees, the first argument is on the top
+    std::vector<std::vector<ASTNode*> > subtree_stack;
+
+    for(int node_index=ast_nodes.size()-1; node_index >= 0; node_index--)
+    {
+        const ASTNode *node = ast_nodes[node_index];
+        std::vector<ASTNode*> subtree(1, clone_node(node));
+
+        if(node->get_id()==ASTNode::AST_FUNCTION)
+        {
+            const unsigned int arg_size =
+                get_arity(static_cast<const ASTFunction*>(node)->get_name());
+            assert(subtree_stack.size() >= arg_size && "Malformed AST !");
+
+            for(unsigned int i=0; i < arg_size; i++)
+            {
+                subtree.insert(subtree.end(), subtree_stack.back().begin(),
+                               subtree_stack.back().end());
+                subtree_stack.pop_back();
+            }
+
+            if(!fold_constants(subtree))
+            {
+                for(unsigned int rule_index=0; rule_index < mRules.size() &&
+                    rewrites < mMaxRewrites; rule_index++)
+                {
+                    std::vector<ASTNode*> rewritten;
+                    if(!mRules[rule_index]->rewrite(*this, subtree, rewritten))
+                        continue;
+
+                    rewrites++;
+                    mRewrittenCount++;
+
+                    // The rewritten subtree may be simplified again
+                    delete_nodes(subtree);
+                    simplify_nodes(rewritten, subtree, rewrites);
+                    delete_nodes(rewritten);
+                    break;
+                }
+            }
+        }
+
+        subtree_stack.push_back(std::vector<ASTNode*>());
+        subtree_stack.back().swap(subtree);
+    }
+
+    assert(subtree_stack.size()==1 && "Malformed AST !");
+    simplified.insert(simplified.end(), subtree_stack.back().begin(),
+                      subtree_stack.back().end());
+}
+
+void Simplifier::simplify(const std::vector<ASTNode*> *ast_nodes,
+                          std::vector<ASTNode*> &simplified)
+{
+    assert(ast_nodes && !ast_nodes->empty());
+
+    unsigned int rewrites = 0;
+    simplify_nodes(*ast_nodes, simplified, rewrites);
+}
+
+}
@@ -0,0 +1,123 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "threadpool.h"
+
+#include <cassert>
+
+namespace shine
+{
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+: mTask(NULL), mGeneration(0), mPending(0), mShutdown(false)
+{
+    assert(num_threads>0);
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_mutex_init(&mRunMutex, NULL);
+    pthread_cond_init(&mTaskCond, NULL);
+    pthread_cond_init(&mDoneCond, NULL);
+
+    // The WorkerInfo addresses must be stable before
+    // starting the threads
+    mWorkerInfo.resize(num_threads);
+    mThreads.resize(num_threads);
+
+    for(unsigned int i=0; i < num_threads; i++)
+    {
+        mWorkerInfo[i].pool = this;
+        mWorkerInfo[i].worker_index = i;
+
+        const int ret = pthread_create(&mThreads[i], NULL,
+                                       ThreadPool::worker_main, &mWorkerInfo[i]);
+        assert(ret==0 && "Error while creating the worker thread !");
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&mMutex);
+    mShutdown = true;
+    pthread_cond_broadcast(&mTaskCond);
+    pthread_mutex_unlock(&mMutex);
+
+    for(unsigned int i=0; i < mThreads.size(); i++)
+        pthread_join(mThreads[i], NULL);
+
+    pthread_cond_destroy(&mDoneCond);
+    pthread_cond_destroy(&mTaskCond);
+    pthread_mutex_destroy(&mRunMutex);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void ThreadPool::run(ThreadTask *task)
+{
+    assert(task!=NULL);
+
+    pthread_mutex_lock(&mRunMutex);
+    pthread_mutex_lock(&mMutex);
+
+    mTask = task;
+    mPending = mThreads.size();
+    mGeneration++;
+    pthread_cond_broadcast(&mTaskCond);
+
+    while(mPending > 0)
+        pthread_cond_wait(&mDoneCond, &mMutex);
+
+    mTask = NULL;
+
+    pthread_mutex_unlock(&mMutex);
+    pthread_mutex_unlock(&mRunMutex);
+}
+
+void *ThreadPool::worker_main(void *worker)
+{
+    WorkerInfo *info = static_cast<WorkerInfo*>(worker);
+    info->pool->worker_loop(info->worker_index);
+    return NULL;
+}
+
+void ThreadPool::worker_loop(unsigned int worker_index)
+{
+    unsigned long seen_generation = 0;
+
+    pthread_mutex_lock(&mMutex);
+    while(true)
+    {
+        while(!mShutdown && seen_generation==mGeneration)
+            pthread_cond_wait(&mTaskCond, &mMutex);
+
+        if(mShutdown)
+            break;
+
+        seen_generation = mGeneration;
+        ThreadTask *task = mTask;
+        pthread_mutex_unlock(&mMutex);
+
+        task->run(worker_index);
+
+        pthread_mutex_lock(&mMutex);
+        if(--mPending==0)
+            pthread_cond_signal(&mDoneCond);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+}
@@ -0,0 +1,131 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "tieredevaluator.h"
+
+#include "modulehandler.h"
+#include "astnode.h"
+#include "evaluator.h"
+
+#include <cassert>
+#include <sstream>
+#include <stdint.h>
+
+namespace shine
+{
+
+TieredEvaluator::TieredEvaluator(ModuleHandler *handler,
+                                 unsigned int promote_evaluations,
+                                 unsigned long promote_cost)
+: mHandler(handler), mInterpreter(handler),
+  mPromoteEvaluations(promote_evaluations), mPromoteCost(promote_cost),
+  mInterpretedEvaluations(0), mCompiledEvaluations(0), mPromotions(0)
+{
+    assert(handler && "No Module Handler provided !");
+}
+
+TieredEvaluator::~TieredEvaluator()
+{ clear(); }
+
+unsigned int TieredEvaluator::add_tree(const std::vector<ASTNode*> *ast_nodes)
+{
+    assert(ast_nodes && ast_nodes->size()>0);
+
+    Tree tree;
+    tree.ast_nodes = ast_nodes;
+    tree.evaluations = 0;
+    tree.cost = 0;
+    tree.function = NULL;
+
+    mTrees.push_back(tree);
+    return mTrees.size()-1;
+}
+
+bool TieredEvaluator::is_compiled(unsigned int tree_id) const
+{
+    assert(tree_id < mTrees.size());
+    return mTrees[tree_id].function!=NULL;
+}
+
+void TieredEvaluator::promote(unsigned int tree_id)
+{
+    Tree &tree = mTrees[tree_id];
+
+    // The kernels are called with the double columns, the trees of
+    // a single precision handler stay in the interpreter
+    if(mHandler->get_precision()!=ModuleHandler::PRECISION_DOUBLE)
+        return;
+
+    // The prefix is unique to the handler, other evaluators can share it
+    std::stringstream ss_name;
+    ss_name << mHandler->get_unique_prefix("shine_tiered_") << tree_id;
+
+    // On failure the tree stays in the interpreter
+    if(!mHandler->codegen_ast_batch(tree.ast_nodes, ss_name.str()))
+        return;
+
+    mHandler->run_function_passes(ss_name.str());
+    tree.function = mHandler->jit_function(ss_name.str());
+    tree.func_name = ss_name.str();
+    mPromotions++;
+}
+
+bool TieredEvaluator::evaluate(unsigned int tree_id, const double* const* columns,
+                               double *out, size_t n, std::string &error_string)
+{
+    assert(tree_id < mTrees.size());
+    Tree &tree = mTrees[tree_id];
+
+    if(!tree.function)
+    {
+        const unsigned long cost = tree.ast_nodes->size() * n;
+        if(tree.evaluations+1 >= mPromoteEvaluations ||
+           tree.cost + cost >= mPromoteCost)
+            promote(tree_id);
+    }
+
+    tree.evaluations++;
+
+    if(tree.function)
+    {
+        Evaluator::BatchKernel kernel =
+            (Evaluator::BatchKernel)(intptr_t)tree.function;
+        kernel(columns, out, n);
+        mCompiledEvaluations++;
+        return true;
+    }
+
+    if(!mInterpreter.evaluate_batch(tree.ast_nodes, columns, out, n, error_string))
+        return false;
+
+    tree.cost += tree.ast_nodes->size() * n;
+    mInterpretedEvaluations++;
+    return true;
+}
+
+void TieredEvaluator::clear()
+{
+    for(unsigned int i=0; i < mTrees.size(); i++)
+        if(mTrees[i].function)
+            mHandler->free_jit_memory(mTrees[i].func_name);
+
+    mTrees.clear();
+}
+
+}
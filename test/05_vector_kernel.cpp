@@ -0,0 +1,196 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <glib.h>
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+gboolean stack_traversal(GNode *node, gpointer stack)
+{
+    std::vector<ASTNode*> *ast_stack =
+        static_cast<std::vector<ASTNode*>*>(stack);
+
+    ASTNode *ast_node = static_cast<ASTNode*>(node->data);
+    ast_stack->push_back(ast_node);
+    return FALSE;
+}
+
+gboolean destroy_traversal(GNode *node, gpointer data)
+{
+    ASTNode *ast_node = static_cast<ASTNode*>(node->data);
+    delete ast_node;
+    return FALSE;
+}
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLoader *loader6 =
+            ModuleLoader::create_from_file("mod6.o", error_string);
+
+    if(!loader6)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    // The variant H_v2 mixes vectors and scalars
+    assert(!loader6->check_closure(error_string));
+    assert(error_string.find("H_v2") != std::string::npos);
+    assert(error_string.find("F_v2") == std::string::npos);
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(link_ret)
+        link_ret = link->link_module_loader(loader6, error_string);
+    delete loader6;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                         NODES
+     ************************************************************/
+    GNode *n_f = g_node_new(new ASTFunction("F"));
+        GNode *n_x = g_node_append_data(n_f, new ASTVariable("x"));
+        GNode *n_g = g_node_append_data(n_f, new ASTFunction("G"));
+            GNode *n_h = g_node_append_data(n_g, new ASTFunction("H"));
+                GNode *n_h1 = g_node_append_data(n_h, new ASTVariable("y"));
+                GNode *n_h2 = g_node_append_data(n_h, new ASTConstant(2));
+            GNode *n_g2 = g_node_append_data(n_g, new ASTConstant(2));
+            GNode *n_i = g_node_append_data(n_g, new ASTFunction("I"));
+                GNode *n_i0 = g_node_append_data(n_i, new ASTConstant(0));
+
+    std::vector<ASTNode*> ast_nodes;
+    g_node_traverse(n_f, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+                    stack_traversal, &ast_nodes);
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    mod_handler->codegen_ast_vector(&ast_nodes, "my_vector_func", 4);
+
+    std::cout << mod_handler->get_function_ir("my_vector_func") << std::endl;
+    mod_handler->run_function_passes("my_vector_func");
+
+    void *func_ptr = mod_handler->jit_function("my_vector_func");
+
+    if(!func_ptr)
+    {
+        std::cout << "Error: function not found !" << std::endl;
+        return -1;
+    }
+
+    // Not a multiple of the vector width, so the scalar loop also runs
+    const size_t rows = 103;
+    std::vector<double> x(rows), y(rows), out(rows);
+    for(size_t i=0; i<rows; i++)
+    {
+        x[i] = i * 0.5;
+        y[i] = i + 1.0;
+    }
+
+    const double *columns[] = { &x[0], &y[0] };
+
+    void (*FP)(const double* const*, double*, size_t) =
+        (void (*)(const double* const*, double*, size_t))(intptr_t)func_ptr;
+    FP(columns, &out[0], rows);
+
+    for(size_t i=0; i<rows; i++)
+        assert(out[i] == x[i] + (y[i]/2.0 + 2.0 - 0.0));
+
+    // An empty dataset must not touch the output
+    FP(columns, NULL, 0);
+
+    std::cout << "JIT Vector Run Func: " << out[rows-1] << std::endl;
+
+    // The width 2 calls the variant F_v2, H_v2 isn't a variant
+    mod_handler->codegen_ast_vector(&ast_nodes, "my_vector_func2", 2);
+
+    const std::string ir2 = mod_handler->get_function_ir("my_vector_func2");
+    std::cout << ir2 << std::endl;
+    assert(ir2.find("@F_v2") != std::string::npos);
+    assert(ir2.find("@H_v2") == std::string::npos);
+
+    mod_handler->run_function_passes("my_vector_func2");
+
+    void *func_ptr2 = mod_handler->jit_function("my_vector_func2");
+
+    if(!func_ptr2)
+    {
+        std::cout << "Error: function not found !" << std::endl;
+        return -1;
+    }
+
+    std::vector<double> out2(rows);
+    void (*FP2)(const double* const*, double*, size_t) =
+        (void (*)(const double* const*, double*, size_t))(intptr_t)func_ptr2;
+    FP2(columns, &out2[0], rows);
+
+    for(size_t i=0; i<rows; i++)
+        assert(out2[i] == x[i] + (y[i]/2.0 + 2.0 - 0.0));
+
+    delete mod_handler;
+
+    g_node_traverse(n_f, G_IN_ORDER, G_TRAVERSE_ALL, -1,
+                    destroy_traversal, NULL);
+    g_node_destroy(n_f);
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <limits>
+
+#include <glib.h>
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+gboolean stack_traversal(GNode *node, gpointer stack)
+{
+    std::vector<ASTNode*> *ast_stack =
+        static_cast<std::vector<ASTNode*>*>(stack);
+
+    ASTNode *ast_node = static_cast<ASTNode*>(node->data);
+    ast_stack->push_back(ast_node);
+    return FALSE;
+}
+
+gboolean destroy_traversal(GNode *node, gpointer data)
+{
+    ASTNode *ast_node = static_cast<ASTNode*>(node->data);
+    delete ast_node;
+    return FALSE;
+}
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                         NODES
+     ************************************************************/
+    GNode *n_f = g_node_new(new ASTFunction("F"));
+        GNode *n_x = g_node_append_data(n_f, new ASTVariable("x"));
+        GNode *n_g = g_node_append_data(n_f, new ASTFunction("G"));
+            GNode *n_h = g_node_append_data(n_g, new ASTFunction("H"));
+                GNode *n_h1 = g_node_append_data(n_h, new ASTVariable("y"));
+                GNode *n_h2 = g_node_append_data(n_h, new ASTConstant(2));
+            GNode *n_g2 = g_node_append_data(n_g, new ASTConstant(2));
+            GNode *n_i = g_node_append_data(n_g, new ASTFunction("I"));
+                GNode *n_i0 = g_node_append_data(n_i, new ASTConstant(0));
+
+    std::vector<ASTNode*> ast_nodes;
+    g_node_traverse(n_f, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+                    stack_traversal, &ast_nodes);
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    mod_handler->codegen_ast_fitness(&ast_nodes, "my_sse", ModuleHandler::FITNESS_SSE);
+    mod_handler->codegen_ast_fitness(&ast_nodes, "my_mse", ModuleHandler::FITNESS_MSE);
+    mod_handler->codegen_ast_fitness(&ast_nodes, "my_mae", ModuleHandler::FITNESS_MAE);
+    mod_handler->codegen_ast_fitness(&ast_nodes, "my_max_abs", ModuleHandler::FITNESS_MAX_ABS);
+
+    std::cout << mod_handler->get_function_ir("my_mae") << std::endl;
+
+    const size_t rows = 100;
+    std::vector<double> x(rows), y(rows), target(rows);
+    double sse = 0.0, sae = 0.0, max_abs = 0.0;
+    for(size_t i=0; i<rows; i++)
+    {
+        x[i] = i * 0.5;
+        y[i] = i + 1.0;
+        target[i] = i * 0.7;
+
+        const double residual = (x[i] + (y[i]/2.0 + 2.0 - 0.0)) - target[i];
+        sse += residual*residual;
+        sae += fabs(residual);
+        if(fabs(residual) > max_abs) max_abs = fabs(residual);
+    }
+
+    const double *columns[] = { &x[0], &y[0] };
+
+    typedef double (*FitnessFunction)(const double* const*, const double*, size_t);
+
+    const char *names[] = { "my_sse", "my_mse", "my_mae", "my_max_abs" };
+    const double expected[] = { sse, sse/rows, sae/rows, max_abs };
+
+    for(int i=0; i<4; i++)
+    {
+        mod_handler->run_function_passes(names[i]);
+        void *func_ptr = mod_handler->jit_function(names[i]);
+
+        if(!func_ptr)
+        {
+            std::cout << "Error: function not found !" << std::endl;
+            return -1;
+        }
+
+        FitnessFunction FP = (FitnessFunction)(intptr_t)func_ptr;
+        const double error = FP(columns, &target[0], rows);
+        std::cout << "JIT Fitness " << names[i] << ": " << error << std::endl;
+
+        assert(fabs(error - expected[i]) < 1e-9);
+        assert(FP(columns, NULL, 0) == 0.0);
+    }
+
+    // NaN predictions must not be hidden by the maximum
+    target[rows/2] = std::numeric_limits<double>::quiet_NaN();
+    FitnessFunction FP = (FitnessFunction)(intptr_t)mod_handler->jit_function("my_max_abs");
+    const double nan_error = FP(columns, &target[0], rows);
+    assert(nan_error != nan_error);
+
+    delete mod_handler;
+
+    g_node_traverse(n_f, G_IN_ORDER, G_TRAVERSE_ALL, -1,
+                    destroy_traversal, NULL);
+    g_node_destroy(n_f);
+
+    shine_shutdown();
+
+    return 0;
+}
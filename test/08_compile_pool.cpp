@@ -0,0 +1,127 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    CompilePool *pool =
+            CompilePool::create(link->get_composite_module(), vars, 4, error_string);
+
+    if(!pool)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+    assert(pool->get_num_workers()==4);
+
+    /************************************************************
+     *                       POPULATION
+     ************************************************************/
+    const unsigned int pop_size = 500;
+    std::vector<std::vector<ASTNode*> > population(pop_size);
+
+    // Individual i: F(x, H(y, i+1))
+    for(unsigned int i=0; i < pop_size; i++)
+    {
+        population[i].push_back(new ASTFunction("F"));
+        population[i].push_back(new ASTVariable("x"));
+        population[i].push_back(new ASTFunction("H"));
+        population[i].push_back(new ASTVariable("y"));
+        population[i].push_back(new ASTConstant(i+1));
+    }
+
+    std::vector<void*> func_ptrs =
+        pool->compile_population(population, "individual_", ModuleHandler::KERNEL_SCALAR, 16);
+    assert(func_ptrs.size()==pop_size);
+
+    typedef double (*ScalarFunction)(double, double);
+    for(unsigned int i=0; i < pop_size; i++)
+    {
+        assert(func_ptrs[i]!=NULL);
+        ScalarFunction FP = (ScalarFunction)(intptr_t)func_ptrs[i];
+        assert(FP(1.0, 6.0) == 1.0 + 6.0/(i+1));
+    }
+
+    std::vector<void*> kernel_ptrs =
+        pool->compile_population(population, "kernel_", ModuleHandler::KERNEL_BATCH);
+    assert(kernel_ptrs.size()==pop_size);
+
+    const size_t rows = 10;
+    std::vector<double> x(rows, 1.0), y(rows, 6.0), out(rows);
+    const double *columns[] = { &x[0], &y[0] };
+
+    typedef void (*BatchFunction)(const double* const*, double*, size_t);
+    for(unsigned int i=0; i < pop_size; i++)
+    {
+        BatchFunction FP = (BatchFunction)(intptr_t)kernel_ptrs[i];
+        FP(columns, &out[0], rows);
+        assert(out[rows-1] == 1.0 + 6.0/(i+1));
+    }
+
+    std::cout << "Compile Pool: " << pop_size << " individuals" << std::endl;
+
+    assert(pool->free_jit_memory());
+    delete pool;
+
+    for(unsigned int i=0; i < pop_size; i++)
+        for(unsigned int j=0; j < population[i].size(); j++)
+            delete population[i][j];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <cmath>
+
+#include <glib.h>
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+gboolean stack_traversal(GNode *node, gpointer stack)
+{
+    std::vector<ASTNode*> *ast_stack =
+        static_cast<std::vector<ASTNode*>*>(stack);
+
+    ASTNode *ast_node = static_cast<ASTNode*>(node->data);
+    ast_stack->push_back(ast_node);
+    return FALSE;
+}
+
+gboolean destroy_traversal(GNode *node, gpointer data)
+{
+    ASTNode *ast_node = static_cast<ASTNode*>(node->data);
+    delete ast_node;
+    return FALSE;
+}
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                         NODES
+     ************************************************************/
+    GNode *n_f = g_node_new(new ASTFunction("F"));
+        GNode *n_x = g_node_append_data(n_f, new ASTVariable("x"));
+        GNode *n_g = g_node_append_data(n_f, new ASTFunction("G"));
+            GNode *n_h = g_node_append_data(n_g, new ASTFunction("H"));
+                GNode *n_h1 = g_node_append_data(n_h, new ASTVariable("y"));
+                GNode *n_h2 = g_node_append_data(n_h, new ASTConstant(2));
+            GNode *n_g2 = g_node_append_data(n_g, new ASTConstant(2));
+            GNode *n_i = g_node_append_data(n_g, new ASTFunction("I"));
+                GNode *n_i0 = g_node_append_data(n_i, new ASTConstant(0));
+
+    std::vector<ASTNode*> ast_nodes;
+    g_node_traverse(n_f, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+                    stack_traversal, &ast_nodes);
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    mod_handler->codegen_ast_batch(&ast_nodes, "my_batch");
+    mod_handler->codegen_ast_fitness(&ast_nodes, "my_sse", ModuleHandler::FITNESS_SSE);
+    mod_handler->codegen_ast_fitness(&ast_nodes, "my_mse", ModuleHandler::FITNESS_MSE);
+    mod_handler->codegen_ast_fitness(&ast_nodes, "my_max_abs", ModuleHandler::FITNESS_MAX_ABS);
+
+    // Not a multiple of the chunk size
+    const size_t rows = 10007;
+    std::vector<double> x(rows), y(rows), target(rows), out(rows);
+    for(size_t i=0; i<rows; i++)
+    {
+        x[i] = i * 0.5;
+        y[i] = i + 1.0;
+        target[i] = i * 0.7;
+    }
+
+    std::vector<const double*> columns;
+    columns.push_back(&x[0]);
+    columns.push_back(&y[0]);
+
+    Evaluator evaluator(4, 1000);
+    assert(evaluator.get_num_threads()==4);
+    assert(evaluator.get_chunk_size()==1000);
+
+    evaluator.evaluate(mod_handler->jit_function("my_batch"), columns, rows, &out[0]);
+
+    double sse = 0.0, max_abs = 0.0;
+    for(size_t i=0; i<rows; i++)
+    {
+        assert(out[i] == x[i] + (y[i]/2.0 + 2.0 - 0.0));
+
+        const double residual = out[i] - target[i];
+        sse += residual*residual;
+        if(fabs(residual) > max_abs) max_abs = fabs(residual);
+    }
+
+    std::vector<void*> kernels;
+    kernels.push_back(mod_handler->jit_function("my_sse"));
+    kernels.push_back(mod_handler->jit_function("my_mse"));
+    kernels.push_back(mod_handler->jit_function("my_max_abs"));
+
+    const double sse_error =
+        evaluator.evaluate_fitness(kernels[0], columns, &target[0], rows,
+                                   ModuleHandler::FITNESS_SSE);
+    std::cout << "Evaluator SSE: " << sse_error << std::endl;
+    assert(fabs(sse_error - sse) < 1e-6 * sse);
+
+    evaluator.set_chunk_size(333);
+
+    const double mse_error =
+        evaluator.evaluate_fitness(kernels[1], columns, &target[0], rows,
+                                   ModuleHandler::FITNESS_MSE);
+    std::cout << "Evaluator MSE: " << mse_error << std::endl;
+    assert(fabs(mse_error - sse/rows) < 1e-6 * (sse/rows));
+
+    const double max_abs_error =
+        evaluator.evaluate_fitness(kernels[2], columns, &target[0], rows,
+                                   ModuleHandler::FITNESS_MAX_ABS);
+    assert(max_abs_error == max_abs);
+
+    // The same kernel many times, like a population
+    std::vector<void*> population(100, kernels[0]);
+    std::vector<double> errors =
+        evaluator.evaluate_fitness(population, columns, &target[0], rows,
+                                   ModuleHandler::FITNESS_SSE);
+    assert(errors.size()==population.size());
+    for(unsigned int i=0; i < errors.size(); i++)
+        assert(errors[i] == errors[0]);
+
+    delete mod_handler;
+
+    g_node_traverse(n_f, G_IN_ORDER, G_TRAVERSE_ALL, -1,
+                    destroy_traversal, NULL);
+    g_node_destroy(n_f);
+
+    shine_shutdown();
+
+    return 0;
+}
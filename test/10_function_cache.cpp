@@ -0,0 +1,163 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                       POPULATION
+     ************************************************************/
+    const unsigned int pop_size = 60;
+    std::vector<std::vector<ASTNode*> > population(pop_size);
+
+    // Individual i: F(x, H(y, (i%10)+1)), so each tree has 6 clones
+    for(unsigned int i=0; i < pop_size; i++)
+    {
+        population[i].push_back(new ASTFunction("F"));
+        population[i].push_back(new ASTVariable("x"));
+        population[i].push_back(new ASTFunction("H"));
+        population[i].push_back(new ASTVariable("y"));
+        population[i].push_back(new ASTConstant((i%10)+1));
+    }
+
+    assert(ASTNode::structural_hash(&population[0])==ASTNode::structural_hash(&population[10]));
+    assert(ASTNode::structural_key(&population[0])==ASTNode::structural_key(&population[10]));
+    assert(ASTNode::structural_key(&population[0])!=ASTNode::structural_key(&population[1]));
+
+    // Constants are compared bit by bit
+    std::vector<ASTNode*> zero_tree(population[0]), neg_zero_tree(population[0]);
+    ASTConstant zero(0.0), neg_zero(-0.0);
+    zero_tree[4] = &zero;
+    neg_zero_tree[4] = &neg_zero;
+    assert(ASTNode::structural_key(&zero_tree)!=ASTNode::structural_key(&neg_zero_tree));
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    FunctionCache cache(mod_handler);
+
+    std::vector<void*> func_ptrs = cache.compile_population(population);
+    assert(func_ptrs.size()==pop_size);
+    assert(cache.get_misses()==10);
+    assert(cache.get_hits()==pop_size-10);
+    assert(cache.size()==10);
+
+    typedef double (*ScalarFunction)(double, double);
+    for(unsigned int i=0; i < pop_size; i++)
+    {
+        assert(func_ptrs[i]==func_ptrs[i%10]);
+        ScalarFunction FP = (ScalarFunction)(intptr_t)func_ptrs[i];
+        assert(FP(1.0, 6.0) == 1.0 + 6.0/((i%10)+1));
+    }
+
+    // A clone in a later generation only hits the cache
+    cache.reset_counters();
+    assert(cache.get_function(&population[3])==func_ptrs[3]);
+    assert(cache.get_hits()==1 && cache.get_misses()==0);
+
+    // Another variable list changes the prototype, so the tree is compiled again
+    std::vector<std::string> reordered_vars;
+    reordered_vars.push_back("y");
+    reordered_vars.push_back("x");
+
+    mod_handler->set_variable_list(reordered_vars);
+
+    cache.reset_counters();
+    void *reordered_ptr = cache.get_function(&population[3]);
+    assert(reordered_ptr!=func_ptrs[3]);
+    assert(cache.get_hits()==0 && cache.get_misses()==1);
+
+    ScalarFunction RP = (ScalarFunction)(intptr_t)reordered_ptr;
+    assert(RP(6.0, 1.0) == 1.0 + 6.0/4.0);
+
+    // The functions of the previous list are still cached
+    mod_handler->set_variable_list(vars);
+    assert(cache.get_function(&population[3])==func_ptrs[3]);
+    assert(cache.get_hits()==1);
+
+    // Another cache on the same handler doesn't reuse the function names
+    FunctionCache other_cache(mod_handler);
+    void *other_ptr = other_cache.get_function(&population[3]);
+    assert(other_ptr!=NULL && other_ptr!=func_ptrs[3]);
+
+    ScalarFunction OP = (ScalarFunction)(intptr_t)other_ptr;
+    assert(OP(1.0, 6.0) == 1.0 + 6.0/4.0);
+    other_cache.clear();
+
+    std::cout << "Function Cache: " << cache.size() << " functions" << std::endl;
+
+    cache.clear();
+    assert(cache.size()==0);
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < pop_size; i++)
+        for(unsigned int j=0; j < population[i].size(); j++)
+            delete population[i][j];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                       POPULATION
+     ************************************************************/
+    const unsigned int pop_size = 20;
+    std::vector<std::vector<ASTNode*> > population(pop_size);
+
+    // Individual i: F(H(G(x, y, 2), 4), i), all the individuals
+    // share the H(G(x, y, 2), 4) subtree
+    for(unsigned int i=0; i < pop_size; i++)
+    {
+        population[i].push_back(new ASTFunction("F"));
+        population[i].push_back(new ASTFunction("H"));
+        population[i].push_back(new ASTFunction("G"));
+        population[i].push_back(new ASTVariable("x"));
+        population[i].push_back(new ASTVariable("y"));
+        population[i].push_back(new ASTConstant(2));
+        population[i].push_back(new ASTConstant(4));
+        population[i].push_back(new ASTConstant(i));
+    }
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    mod_handler->set_subtree_sharing(true);
+    assert(mod_handler->get_subtree_sharing());
+
+    std::vector<void*> func_ptrs =
+        mod_handler->compile_population(population, "individual_");
+    assert(func_ptrs.size()==pop_size);
+
+    // Each individual generates F, the helper call and its constant,
+    // the H helper generates H, the G helper call and 4, and the G
+    // helper generates its 4 nodes
+    const unsigned long generated_nodes = pop_size*3 + 3 + 4;
+    std::cout << "Deduplicated nodes: " << mod_handler->get_deduplicated_nodes() << std::endl;
+    assert(mod_handler->get_deduplicated_nodes()==pop_size*8 - generated_nodes);
+
+    typedef double (*ScalarFunction)(double, double);
+    for(unsigned int i=0; i < pop_size; i++)
+    {
+        ScalarFunction FP = (ScalarFunction)(intptr_t)func_ptrs[i];
+        assert(FP(5.0, 3.0) == (5.0 + 3.0 - 2.0)/4.0 + i);
+    }
+
+    // The next generation reuses the helpers, even without repetitions
+    std::vector<std::vector<ASTNode*> > next_population(1, population[0]);
+    std::vector<void*> next_ptrs =
+        mod_handler->compile_population(next_population, "next_individual_");
+    assert(mod_handler->get_deduplicated_nodes()==8 - 3);
+
+    ScalarFunction FP = (ScalarFunction)(intptr_t)next_ptrs[0];
+    assert(FP(5.0, 3.0) == (5.0 + 3.0 - 2.0)/4.0);
+
+    // Another variable list, the helpers of the previous one aren't called
+    std::vector<std::string> reordered_vars;
+    reordered_vars.push_back("y");
+    reordered_vars.push_back("z");
+    reordered_vars.push_back("x");
+
+    mod_handler->set_variable_list(reordered_vars);
+
+    std::vector<std::vector<ASTNode*> > reordered_population(population.begin(),
+                                                             population.begin()+2);
+    std::vector<void*> reordered_ptrs =
+        mod_handler->compile_population(reordered_population, "reordered_individual_");
+
+    typedef double (*ReorderedFunction)(double, double, double);
+    for(unsigned int i=0; i < reordered_ptrs.size(); i++)
+    {
+        ReorderedFunction RP = (ReorderedFunction)(intptr_t)reordered_ptrs[i];
+        assert(RP(3.0, 100.0, 9.0) == (9.0 + 3.0 - 2.0)/4.0 + i);
+    }
+
+    std::cout << mod_handler->get_function_ir("individual_0") << std::endl;
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < pop_size; i++)
+        for(unsigned int j=0; j < population[i].size(); j++)
+            delete population[i][j];
+
+    shine_shutdown();
+
+    return 0;
+}
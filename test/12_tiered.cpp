@@ -0,0 +1,207 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                        TIERED
+     ************************************************************/
+    // F(x, H(y, 2.0)) = x + y/2
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    const size_t n = 100;
+    std::vector<double> x(n), y(n), out(n);
+    for(size_t i=0; i < n; i++)
+    {
+        x[i] = i;
+        y[i] = 2.0*i + 1.0;
+    }
+
+    const double *columns[] = { &x[0], &y[0] };
+
+    Interpreter interpreter(mod_handler);
+    const double row[] = { 3.0, 4.0 };
+    double row_value = 0.0;
+    const bool row_evaluated = interpreter.evaluate(&ast_nodes, row, row_value, error_string);
+    assert(row_evaluated && row_value == 3.0 + 4.0/2.0);
+
+    // The interpreter follows the changes of the variable list
+    std::vector<std::string> reordered_vars;
+    reordered_vars.push_back("y");
+    reordered_vars.push_back("x");
+    mod_handler->set_variable_list(reordered_vars);
+
+    const double reordered_row[] = { 4.0, 3.0 };
+    const bool reordered_evaluated =
+        interpreter.evaluate(&ast_nodes, reordered_row, row_value, error_string);
+    assert(reordered_evaluated && row_value == 3.0 + 4.0/2.0);
+
+    mod_handler->set_variable_list(vars);
+
+    // The unknown variables and primitives are reported
+    ASTVariable unknown_var("z");
+    std::vector<ASTNode*> unknown_var_tree(1, &unknown_var);
+    const bool unknown_var_evaluated =
+        interpreter.evaluate(&unknown_var_tree, row, row_value, error_string);
+    assert(!unknown_var_evaluated);
+    std::cout << "Interpreter: " << error_string << std::endl;
+
+    ASTFunction unknown_func("UNKNOWN");
+    std::vector<ASTNode*> unknown_func_tree(1, &unknown_func);
+    const bool unknown_func_evaluated =
+        interpreter.evaluate(&unknown_func_tree, row, row_value, error_string);
+    assert(!unknown_func_evaluated);
+
+    TieredEvaluator tiered(mod_handler, 3);
+    const unsigned int tree_id = tiered.add_tree(&ast_nodes);
+
+    for(unsigned int evaluation=0; evaluation < 5; evaluation++)
+    {
+        const bool tree_evaluated = tiered.evaluate(tree_id, columns, &out[0], n, error_string);
+        assert(tree_evaluated);
+        for(size_t i=0; i < n; i++)
+            assert(out[i] == x[i] + y[i]/2.0);
+
+        // JITed on the third evaluation
+        assert(tiered.is_compiled(tree_id) == (evaluation >= 2));
+    }
+
+    assert(tiered.get_interpreted_evaluations()==2);
+    assert(tiered.get_compiled_evaluations()==3);
+    assert(tiered.get_promotions()==1);
+
+    // Expensive trees are JITed before the evaluation threshold
+    tiered.clear();
+    tiered.set_promote_cost(ast_nodes.size()*n);
+    const unsigned int hot_id = tiered.add_tree(&ast_nodes);
+    const bool hot_evaluated = tiered.evaluate(hot_id, columns, &out[0], n, error_string);
+    assert(hot_evaluated);
+    assert(tiered.is_compiled(hot_id));
+    assert(tiered.get_promotions()==2);
+
+    // The kernels of a single precision handler aren't called
+    mod_handler->set_precision(ModuleHandler::PRECISION_SINGLE);
+    const unsigned int single_id = tiered.add_tree(&ast_nodes);
+    for(unsigned int evaluation=0; evaluation < 5; evaluation++)
+    {
+        const bool single_evaluated = tiered.evaluate(single_id, columns, &out[0], n, error_string);
+        assert(single_evaluated);
+        for(size_t i=0; i < n; i++)
+            assert(out[i] == x[i] + y[i]/2.0);
+    }
+    assert(!tiered.is_compiled(single_id));
+    assert(tiered.get_promotions()==2);
+    mod_handler->set_precision(ModuleHandler::PRECISION_DOUBLE);
+
+    // Another evaluator on the same handler gets its own kernels
+    // F(x, x) = 2x
+    std::vector<ASTNode*> other_nodes;
+    other_nodes.push_back(new ASTFunction("F"));
+    other_nodes.push_back(new ASTVariable("x"));
+    other_nodes.push_back(new ASTVariable("x"));
+
+    TieredEvaluator other_tiered(mod_handler, 1);
+    const unsigned int other_id = other_tiered.add_tree(&other_nodes);
+    const unsigned int tiered_id = tiered.add_tree(&ast_nodes);
+
+    const bool other_evaluated = other_tiered.evaluate(other_id, columns, &out[0], n, error_string);
+    assert(other_evaluated);
+    assert(other_tiered.is_compiled(other_id));
+    for(size_t i=0; i < n; i++)
+        assert(out[i] == 2.0*x[i]);
+
+    tiered.set_promote_evaluations(1);
+    const bool tiered_evaluated = tiered.evaluate(tiered_id, columns, &out[0], n, error_string);
+    assert(tiered_evaluated);
+    assert(tiered.is_compiled(tiered_id));
+    for(size_t i=0; i < n; i++)
+        assert(out[i] == x[i] + y[i]/2.0);
+
+    other_tiered.clear();
+
+    std::cout << "Tiered: " << tiered.get_interpreted_evaluations() << " interpreted, "
+              << tiered.get_compiled_evaluations() << " compiled" << std::endl;
+
+    tiered.clear();
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    for(unsigned int i=0; i < other_nodes.size(); i++)
+        delete other_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                      BYTECODE VM
+     ************************************************************/
+    // G(F(x, 2.0), H(y, 2.0), I(x)) = x + 2 + y/2 - x
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("G"));
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+    ast_nodes.push_back(new ASTFunction("I"));
+    ast_nodes.push_back(new ASTVariable("x"));
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // Not a multiple of the block size
+    const size_t n = 1000;
+    std::vector<double> x(n), y(n), out(n);
+    for(size_t i=0; i < n; i++)
+    {
+        x[i] = i;
+        y[i] = 2.0*i + 1.0;
+    }
+
+    const double *columns[] = { &x[0], &y[0] };
+
+    BytecodeVM vm(mod_handler, 64);
+
+    BytecodeProgram *program = vm.compile(&ast_nodes, error_string);
+    if(!program)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    assert(program->size()==4);
+
+    vm.evaluate(program, columns, &out[0], n);
+    for(size_t i=0; i < n; i++)
+        assert(out[i] == (x[i] + 2.0) + y[i]/2.0 - x[i]);
+
+    delete program;
+
+    // A tree without functions
+    std::vector<ASTNode*> var_tree(1, ast_nodes[5]);
+    program = vm.compile(&var_tree, error_string);
+    assert(program);
+    vm.evaluate(program, columns, &out[0], n);
+    for(size_t i=0; i < n; i++)
+        assert(out[i] == y[i]);
+    delete program;
+
+    // The programs follow the changes of the variable list
+    std::vector<std::string> reordered_vars;
+    reordered_vars.push_back("y");
+    reordered_vars.push_back("x");
+    mod_handler->set_variable_list(reordered_vars);
+
+    program = vm.compile(&ast_nodes, error_string);
+    assert(program);
+
+    const double *reordered_columns[] = { &y[0], &x[0] };
+    vm.evaluate(program, reordered_columns, &out[0], n);
+    for(size_t i=0; i < n; i++)
+        assert(out[i] == (x[i] + 2.0) + y[i]/2.0 - x[i]);
+    delete program;
+
+    mod_handler->set_variable_list(vars);
+
+    // Unknown primitives are reported
+    ASTFunction unknown("UNKNOWN");
+    std::vector<ASTNode*> bad_tree(1, &unknown);
+    const BytecodeProgram *bad_program = vm.compile(&bad_tree, error_string);
+    assert(bad_program==NULL);
+
+    std::cout << "Bytecode VM: " << error_string << std::endl;
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                        ARENA
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    ASTArena arena;
+    const unsigned int F = arena.add_function_symbol("F", 2);
+    const unsigned int H = arena.add_function_symbol("H", 2);
+    const unsigned int x = arena.add_variable_symbol("x");
+    const unsigned int y = arena.add_variable_symbol("y");
+    assert(arena.add_function_symbol("F", 2)==F);
+
+    // F(x, H(y, 2.0)) = x + y/2
+    unsigned int begin = arena.size();
+    arena.push_function(F);
+    arena.push_variable(x);
+    arena.push_function(H);
+    arena.push_variable(y);
+    arena.push_constant(2.0);
+    const FlatTree tree1 = arena.end_tree(begin);
+    assert(tree1.size==5);
+
+    // H(F(y, y), x) = (y + y)/x, from an ASTNode tree
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTVariable("x"));
+
+    FlatTree tree2;
+    if(!arena.add_tree(&ast_nodes, tree2, error_string))
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+    assert(tree2.begin==5 && tree2.size==5);
+
+    // The function symbols must be declared
+    ASTFunction unknown("G");
+    std::vector<ASTNode*> bad_tree(1, &unknown);
+    FlatTree bad_flat;
+    assert(!arena.add_tree(&bad_tree, bad_flat, error_string));
+    assert(arena.size()==10);
+
+    mod_handler->codegen_ast(&arena, tree1, "flat1");
+    mod_handler->codegen_ast(&arena, tree2, "flat2");
+    mod_handler->codegen_ast(&ast_nodes, "nodes2");
+
+    // Both representations generate the same code
+    std::string flat_ir = mod_handler->get_function_ir("flat2");
+    std::string nodes_ir = mod_handler->get_function_ir("nodes2");
+    assert(flat_ir.substr(flat_ir.find('(')) == nodes_ir.substr(nodes_ir.find('(')));
+
+    typedef double (*ScalarFunction)(double, double);
+    ScalarFunction FP1 = (ScalarFunction)(intptr_t)mod_handler->jit_function("flat1");
+    ScalarFunction FP2 = (ScalarFunction)(intptr_t)mod_handler->jit_function("flat2");
+    assert(FP1(1.0, 6.0) == 1.0 + 6.0/2.0);
+    assert(FP2(4.0, 6.0) == (6.0 + 6.0)/4.0);
+
+    // The next generation reuses the symbols
+    arena.clear();
+    assert(arena.size()==0 && arena.get_num_function_symbols()==2);
+
+    begin = arena.size();
+    arena.push_function(H);
+    arena.push_variable(x);
+    arena.push_variable(y);
+    const FlatTree tree3 = arena.end_tree(begin);
+
+    mod_handler->codegen_ast(&arena, tree3, "flat3");
+    ScalarFunction FP3 = (ScalarFunction)(intptr_t)mod_handler->jit_function("flat3");
+    assert(FP3(1.0, 4.0) == 1.0/4.0);
+
+    std::cout << "Arena: " << error_string << std::endl;
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
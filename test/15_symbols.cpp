@@ -0,0 +1,155 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                       SYMBOLS
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    assert(mod_handler->get_variable_symbol("y")==1);
+    assert(mod_handler->get_variable_symbol("z")==ASTNode::NO_SYMBOL);
+    assert(mod_handler->get_function_symbol("F")!=ASTNode::NO_SYMBOL);
+    assert(mod_handler->get_function_symbol("UNKNOWN")==ASTNode::NO_SYMBOL);
+
+    // G(y, H(x, 2.0), I(x)) = y + x/2 - x
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("G"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+    ast_nodes.push_back(new ASTFunction("I"));
+    ast_nodes.push_back(new ASTVariable("x"));
+
+    // Not resolved trees are looked up by name
+    mod_handler->codegen_ast(&ast_nodes, "by_name");
+
+    if(!mod_handler->resolve_symbols(&ast_nodes, error_string))
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ASTFunction *root = static_cast<ASTFunction*>(ast_nodes[0]);
+    ASTVariable *var_y = static_cast<ASTVariable*>(ast_nodes[1]);
+    assert(root->get_symbol()==mod_handler->get_function_symbol("G"));
+    assert(var_y->get_symbol()==1);
+
+    mod_handler->codegen_ast(&ast_nodes, "by_symbol");
+
+    typedef double (*ScalarFunction)(double, double);
+    ScalarFunction FP1 = (ScalarFunction)(intptr_t)mod_handler->jit_function("by_name");
+    ScalarFunction FP2 = (ScalarFunction)(intptr_t)mod_handler->jit_function("by_symbol");
+    assert(FP1(4.0, 3.0) == 3.0 + 4.0/2.0 - 4.0);
+    assert(FP2(4.0, 3.0) == FP1(4.0, 3.0));
+
+    // The symbols resolved before a new variable list are stale, so
+    // the variables are looked up by name again
+    std::vector<std::string> new_vars;
+    new_vars.push_back("y");
+    new_vars.push_back("z");
+    new_vars.push_back("x");
+
+    mod_handler->set_variable_list(new_vars);
+    mod_handler->codegen_ast(&ast_nodes, "stale_symbol");
+
+    typedef double (*StaleFunction)(double, double, double);
+    StaleFunction FP3 = (StaleFunction)(intptr_t)mod_handler->jit_function("stale_symbol");
+    assert(FP3(3.0, 100.0, 4.0) == FP1(4.0, 3.0));
+
+    mod_handler->set_variable_list(vars);
+
+    // The function symbols resolved against another handler can be
+    // out of range or name other primitives, they are looked up by name
+    root->set_symbol(1000);
+    static_cast<ASTFunction*>(ast_nodes[2])->set_symbol(mod_handler->get_function_symbol("F"));
+    mod_handler->codegen_ast(&ast_nodes, "foreign_symbol");
+
+    ScalarFunction FP4 = (ScalarFunction)(intptr_t)mod_handler->jit_function("foreign_symbol");
+    assert(FP4(4.0, 3.0) == FP1(4.0, 3.0));
+
+    // Renaming a node resets its symbol
+    var_y->set_name("x");
+    assert(var_y->get_symbol()==ASTNode::NO_SYMBOL);
+
+    ASTFunction unknown("UNKNOWN");
+    std::vector<ASTNode*> bad_tree(1, &unknown);
+    assert(!mod_handler->resolve_symbols(&bad_tree, error_string));
+
+    std::cout << "Symbols: " << error_string << std::endl;
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
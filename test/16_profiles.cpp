@@ -0,0 +1,140 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string,
+                                  NULL, NULL, ModuleHandler::PROFILE_FAST_COMPILE);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                       PROFILES
+     ************************************************************/
+    assert(mod_handler->get_profile()==ModuleHandler::PROFILE_FAST_COMPILE);
+
+    ModuleHandler::OptimizationProfile profile;
+    assert(ModuleHandler::parse_profile_name("balanced", profile));
+    assert(profile==ModuleHandler::PROFILE_BALANCED);
+    assert(!ModuleHandler::parse_profile_name("unknown", profile));
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // F(x, H(y, 2.0)) = x + y/2
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+
+    const size_t n = 1000;
+    std::vector<double> x(n), y(n);
+    for(size_t i=0; i < n; i++)
+    {
+        x[i] = i;
+        y[i] = 2.0*i + 1.0;
+    }
+
+    const double *columns[] = { &x[0], &y[0] };
+
+    typedef double (*ScalarFunction)(double, double);
+
+    // The same tree with the function passes of each profile
+    for(unsigned int i=ModuleHandler::PROFILE_FAST_COMPILE;
+        i <= ModuleHandler::PROFILE_MAX_THROUGHPUT; i++)
+    {
+        const ModuleHandler::OptimizationProfile profile =
+            static_cast<ModuleHandler::OptimizationProfile>(i);
+        const std::string name = ModuleHandler::get_profile_name(profile);
+
+        mod_handler->codegen_ast(&ast_nodes, name);
+        mod_handler->run_function_passes(name, profile);
+
+        ScalarFunction FP = (ScalarFunction)(intptr_t)mod_handler->jit_function(name);
+        assert(FP(1.0, 6.0) == 1.0 + 6.0/2.0);
+
+        const std::vector<std::vector<ASTNode*> > population(4, ast_nodes);
+        std::vector<void*> func_ptrs =
+            mod_handler->compile_population(population, name + "_",
+                                            ModuleHandler::KERNEL_SCALAR, profile);
+        for(unsigned int j=0; j < func_ptrs.size(); j++)
+            assert(((ScalarFunction)(intptr_t)func_ptrs[j])(1.0, 6.0) == 1.0 + 6.0/2.0);
+
+        ModuleHandler::ProfileMeasure measure =
+            mod_handler->measure_profile(&ast_nodes, profile, columns, n);
+        assert(measure.compile_time >= 0.0 && measure.evaluation_time >= 0.0);
+
+        std::cout << name << ": compile " << measure.compile_time
+                  << "s, evaluation " << measure.evaluation_time << "s" << std::endl;
+    }
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                     COMPILE STATS
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // F(x, H(y, 2.0)) = x + y/2
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+
+    mod_handler->codegen_ast(&ast_nodes, "my_func");
+    mod_handler->run_function_passes("my_func");
+    mod_handler->jit_function("my_func");
+
+    const std::vector<std::vector<ASTNode*> > population(3, ast_nodes);
+    mod_handler->compile_population(population, "my_pop_", ModuleHandler::KERNEL_BATCH);
+
+    ModuleHandler::CompileStats stats = mod_handler->get_compile_stats();
+    assert(stats.generated_functions==4);
+    assert(stats.optimized_functions==4);
+    assert(stats.jit_functions==4);
+    assert(stats.live_functions==4);
+    assert(stats.instructions_before > 0 && stats.instructions_after > 0);
+    assert(stats.machine_code_bytes > 0);
+    assert(stats.live_machine_code_bytes > 0);
+    assert(stats.codegen_time >= 0.0 && stats.jit_time >= 0.0);
+
+    ModuleHandler::FunctionStats func_stats;
+    assert(mod_handler->get_function_stats("my_pop_1", func_stats));
+    assert(func_stats.instructions_before > 0);
+    assert(func_stats.machine_code_bytes > 0);
+    assert(!mod_handler->get_function_stats("unknown", func_stats));
+
+    std::stringstream json;
+    mod_handler->print_compile_stats(json);
+    assert(json.str().find("\"jit_functions\": 4")!=std::string::npos);
+    assert(json.str().find("\"my_func\": {")!=std::string::npos);
+    std::cout << json.str() << std::endl;
+
+    // The free'd functions aren't alive anymore
+    mod_handler->free_jit_memory("my_func");
+    const ModuleHandler::CompileStats freed_stats = mod_handler->get_compile_stats();
+    assert(freed_stats.live_functions==3);
+    assert(freed_stats.live_machine_code_bytes < stats.live_machine_code_bytes);
+
+    mod_handler->reset_compile_stats();
+    stats = mod_handler->get_compile_stats();
+    assert(stats.generated_functions==0 && stats.live_functions==3);
+    assert(!mod_handler->get_function_stats("my_pop_1", func_stats));
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                       DISK CACHE
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // A fresh cache directory for each run
+    std::stringstream ss_directory;
+    ss_directory << "disk_cache_" << getpid();
+
+    DiskCache *cache = DiskCache::create(mod_handler, ss_directory.str(),
+                                         error_string);
+    if(!cache)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    // F(x, H(y, 2.0)) = x + y/2
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+
+    typedef double (*func_t)(double, double);
+
+    func_t miss_func = (func_t) cache->get_function(&ast_nodes, "miss_func");
+    assert(miss_func);
+    assert(cache->get_hits()==0 && cache->get_misses()==1);
+    assert(cache->get_unstored()==0);
+    assert(miss_func(1.0, 4.0)==3.0);
+
+    // Another instance on the same directory, as another process would do
+    DiskCache *other_cache = DiskCache::create(mod_handler, ss_directory.str(),
+                                               error_string);
+    assert(other_cache);
+    assert(other_cache->get_directory()==cache->get_directory());
+
+    func_t hit_func = (func_t) other_cache->get_function(&ast_nodes, "hit_func");
+    assert(hit_func);
+    assert(other_cache->get_hits()==1 && other_cache->get_misses()==0);
+    assert(hit_func(1.0, 4.0)==3.0);
+    assert(hit_func(-2.0, 3.0)==miss_func(-2.0, 3.0));
+
+    // A different constant is a different tree
+    delete ast_nodes[4];
+    ast_nodes[4] = new ASTConstant(4.0);
+
+    func_t other_func = (func_t) other_cache->get_function(&ast_nodes, "other_func");
+    assert(other_func);
+    assert(other_cache->get_misses()==1);
+    assert(other_func(1.0, 4.0)==2.0);
+
+    // The batch kernels have their own subdirectory
+    DiskCache *batch_cache = DiskCache::create(mod_handler, ss_directory.str(),
+                                               error_string,
+                                               ModuleHandler::KERNEL_BATCH);
+    assert(batch_cache);
+    assert(batch_cache->get_directory()!=cache->get_directory());
+
+    // The trees calling the shared subtree helpers aren't stored
+    mod_handler->set_subtree_sharing(true);
+    const std::vector<std::vector<ASTNode*> > population(2, ast_nodes);
+    mod_handler->compile_population(population, "shared_");
+
+    // I(H(y, 4.0)) = y/4
+    std::vector<ASTNode*> shared_nodes;
+    shared_nodes.push_back(new ASTFunction("I"));
+    shared_nodes.push_back(new ASTFunction("H"));
+    shared_nodes.push_back(new ASTVariable("y"));
+    shared_nodes.push_back(new ASTConstant(4.0));
+
+    func_t shared_func = (func_t) other_cache->get_function(&shared_nodes, "shared_func");
+    assert(shared_func);
+    assert(shared_func(1.0, 4.0)==1.0);
+    assert(other_cache->get_unstored()==1);
+    mod_handler->set_subtree_sharing(false);
+
+    for(unsigned int i=0; i < shared_nodes.size(); i++)
+        delete shared_nodes[i];
+
+    other_cache->reset_counters();
+    assert(other_cache->get_hits()==0 && other_cache->get_misses()==0);
+    assert(other_cache->get_unstored()==0);
+
+    delete batch_cache;
+    delete other_cache;
+    delete cache;
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader =
+            ModuleLoader::create_from_file("mod1.o", error_string, NULL, true);
+
+    if(!loader)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    // Only the prototypes were read
+    assert(loader->get_materializable_count()==4);
+    const bool closure_checked = loader->check_closure(error_string);
+    assert(closure_checked);
+
+    /************************************************************
+     *                      LAZY LOADING
+     ************************************************************/
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(loader->release_module(), error_string);
+    delete loader;
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    assert(mod_handler->get_materializable_count()==4);
+
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // F(x, I(y)) = x + y
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("I"));
+    ast_nodes.push_back(new ASTVariable("y"));
+
+    mod_handler->codegen_ast(&ast_nodes, "my_func");
+
+    // Only the primitives used were read
+    assert(mod_handler->get_materializable_count()==2);
+
+    mod_handler->run_function_passes("my_func");
+
+    typedef double (*func_t)(double, double);
+    func_t my_func = (func_t) mod_handler->jit_function("my_func");
+    assert(my_func(1.0, 2.0)==3.0);
+    assert(mod_handler->get_materialize_error().empty());
+
+    // The module passes read all the bodies first
+    mod_handler->run_module_passes();
+    assert(mod_handler->get_materializable_count()==0);
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    /************************************************************
+     *                  LINKING A LAZY MODULE
+     ************************************************************/
+    loader = ModuleLoader::create_from_file("mod1.o", error_string, NULL, true);
+    assert(loader);
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+    const bool lazy_linked = link->link_module_loader(loader, error_string);
+    assert(lazy_linked);
+    delete loader;
+
+    mod_handler = ModuleHandler::create(link->release_module(), error_string);
+    delete link;
+
+    assert(mod_handler);
+    assert(mod_handler->get_materializable_count()==0);
+
+    delete mod_handler;
+
+    shine_shutdown();
+
+    return 0;
+}
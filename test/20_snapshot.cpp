@@ -0,0 +1,134 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string,
+                                  NULL, NULL, ModuleHandler::PROFILE_BALANCED);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                        SNAPSHOT
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    // F(x, H(y, 2.0)) = x + y/2
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+
+    mod_handler->run_module_passes();
+
+    // The generated functions aren't part of the snapshot
+    mod_handler->set_variable_list(vars);
+    mod_handler->codegen_ast(&ast_nodes, "my_func");
+
+    const bool snapshot_saved = mod_handler->save_snapshot("snapshot.bc", error_string);
+    assert(snapshot_saved);
+    const int symbol_h = mod_handler->get_function_symbol("H");
+    delete mod_handler;
+
+    mod_handler = ModuleHandler::create_from_snapshot("snapshot.bc", error_string);
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    assert(mod_handler->get_profile()==ModuleHandler::PROFILE_BALANCED);
+    assert(mod_handler->get_function_symbol("H")==symbol_h);
+    assert(mod_handler->get_function_symbol("my_func")==ASTNode::NO_SYMBOL);
+    assert(mod_handler->get_materializable_count()==4);
+
+    mod_handler->set_variable_list(vars);
+    mod_handler->codegen_ast(&ast_nodes, "my_func");
+    mod_handler->run_function_passes("my_func");
+
+    typedef double (*func_t)(double, double);
+    func_t my_func = (func_t) mod_handler->jit_function("my_func");
+    assert(my_func(1.0, 4.0)==3.0);
+
+    // A snapshot of a snapshot handler
+    const bool snapshot2_saved = mod_handler->save_snapshot("snapshot2.bc", error_string);
+    assert(snapshot2_saved);
+    delete mod_handler;
+
+    mod_handler = ModuleHandler::create_from_snapshot("snapshot2.bc", error_string);
+    assert(mod_handler);
+    delete mod_handler;
+
+    // A bitcode file without the snapshot metadata
+    mod_handler = ModuleHandler::create_from_snapshot("mod1.o", error_string);
+    assert(!mod_handler);
+    std::cout << error_string << std::endl;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
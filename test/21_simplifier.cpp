@@ -0,0 +1,177 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                      SIMPLIFIER
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // Only the pure primitives are folded, the simplifier infers them
+    assert(!mod_handler->get_attributes_inferred());
+    Simplifier *simplifier = new Simplifier(mod_handler);
+    assert(mod_handler->get_attributes_inferred());
+
+    // I(?a) -> ?a
+    std::vector<ASTNode*> pattern;
+    pattern.push_back(new ASTFunction("I"));
+    pattern.push_back(new ASTVariable("?a"));
+
+    std::vector<ASTNode*> replacement;
+    replacement.push_back(new ASTVariable("?a"));
+
+    simplifier->add_rule(new PatternRule(pattern, replacement));
+
+    for(unsigned int i=0; i < pattern.size(); i++)
+        delete pattern[i];
+    delete replacement[0];
+
+    // G(?a, ?b, ?b) -> ?a
+    pattern.clear();
+    pattern.push_back(new ASTFunction("G"));
+    pattern.push_back(new ASTVariable("?a"));
+    pattern.push_back(new ASTVariable("?b"));
+    pattern.push_back(new ASTVariable("?b"));
+
+    replacement[0] = new ASTVariable("?a");
+
+    simplifier->add_rule(new PatternRule(pattern, replacement));
+
+    for(unsigned int i=0; i < pattern.size(); i++)
+        delete pattern[i];
+    delete replacement[0];
+
+    // F(x, F(H(1.0, 2.0), I(G(y, I(x), x)))) = x + 0.5 + y
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTConstant(1.0));
+    ast_nodes.push_back(new ASTConstant(2.0));
+    ast_nodes.push_back(new ASTFunction("I"));
+    ast_nodes.push_back(new ASTFunction("G"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTFunction("I"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTVariable("x"));
+
+    std::vector<ASTNode*> simplified;
+    simplifier->simplify(&ast_nodes, simplified);
+
+    // F(x, F(0.5, y))
+    assert(simplified.size()==5);
+    assert(simplified[3]->get_id()==ASTNode::AST_CONSTANT);
+    assert(static_cast<ASTConstant*>(simplified[3])->get_value()==0.5);
+    assert(simplifier->get_folded_count()==1);
+    assert(simplifier->get_rewritten_count()==3);
+
+    for(unsigned int i=0; i < simplified.size(); i++)
+        simplified[i]->print_stream(std::cout);
+    std::cout << std::endl;
+
+    mod_handler->codegen_ast(&ast_nodes, "my_func");
+    mod_handler->codegen_ast(&simplified, "my_simplified_func");
+
+    typedef double (*func_t)(double, double);
+    func_t my_func = (func_t) mod_handler->jit_function("my_func");
+    func_t my_simplified_func = (func_t) mod_handler->jit_function("my_simplified_func");
+
+    assert(my_func(1.0, 2.0)==3.5);
+    assert(my_simplified_func(1.0, 2.0)==3.5);
+
+    // A constant tree is folded into a single constant
+    std::vector<ASTNode*> constant_nodes;
+    constant_nodes.push_back(new ASTFunction("G"));
+    constant_nodes.push_back(new ASTConstant(4.0));
+    constant_nodes.push_back(new ASTFunction("H"));
+    constant_nodes.push_back(new ASTConstant(1.0));
+    constant_nodes.push_back(new ASTConstant(2.0));
+    constant_nodes.push_back(new ASTConstant(1.5));
+
+    std::vector<ASTNode*> constant_simplified;
+    simplifier->simplify(&constant_nodes, constant_simplified);
+    assert(constant_simplified.size()==1);
+    assert(static_cast<ASTConstant*>(constant_simplified[0])->get_value()==3.0);
+
+    delete simplifier;
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    for(unsigned int i=0; i < simplified.size(); i++)
+        delete simplified[i];
+    for(unsigned int i=0; i < constant_nodes.size(); i++)
+        delete constant_nodes[i];
+    delete constant_simplified[0];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLoader *loader2 =
+            ModuleLoader::create_from_file("mod2.o", error_string);
+
+    if(!loader2)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    link_ret = link->link_module_loader(loader2, error_string);
+    delete loader2;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                  ATTRIBUTE INFERENCE
+     ************************************************************/
+    std::string report;
+    const bool attributes_inferred = mod_handler->infer_primitive_attributes(report);
+    assert(attributes_inferred);
+    assert(mod_handler->get_attributes_inferred());
+    std::cout << report;
+
+    assert(mod_handler->is_primitive_pure("F"));
+    assert(mod_handler->is_primitive_pure("H"));
+    assert(mod_handler->is_primitive_pure("L"));
+    assert(!mod_handler->is_primitive_pure("J"));
+    assert(!mod_handler->is_primitive_pure("K"));
+    assert(!mod_handler->is_primitive_pure("M"));
+    assert(!mod_handler->is_primitive_pure("P"));
+    assert(!mod_handler->is_primitive_pure("unknown"));
+
+    assert(report.find("F: readnone")!=std::string::npos);
+    assert(report.find("K: readonly")!=std::string::npos);
+    assert(report.find("M: readonly")!=std::string::npos);
+    assert(report.find("J: side effects")!=std::string::npos);
+    assert(report.find("P: side effects (calls printf)")!=std::string::npos);
+
+    // The calls with side effects aren't folded
+    std::vector<std::string> vars;
+    vars.push_back("x");
+
+    mod_handler->set_variable_list(vars);
+
+    Simplifier *simplifier = new Simplifier(mod_handler);
+
+    // F(J(1.0), L(1.0))
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTFunction("J"));
+    ast_nodes.push_back(new ASTConstant(1.0));
+    ast_nodes.push_back(new ASTFunction("L"));
+    ast_nodes.push_back(new ASTConstant(1.0));
+
+    std::vector<ASTNode*> simplified;
+    simplifier->simplify(&ast_nodes, simplified);
+
+    // F(J(1.0), 2.0)
+    assert(simplified.size()==4);
+    assert(simplified[1]->get_id()==ASTNode::AST_FUNCTION);
+    assert(static_cast<ASTConstant*>(simplified[3])->get_value()==2.0);
+
+    delete simplifier;
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    for(unsigned int i=0; i < simplified.size(); i++)
+        delete simplified[i];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLoader *loader2 =
+            ModuleLoader::create_from_file("mod2.o", error_string);
+
+    if(!loader2)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    link_ret = link->link_module_loader(loader2, error_string);
+    delete loader2;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                      FORCE INLINE
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // G(F(x, y), H(y, 2.0), I(x)) = x + y + y/2 - x
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("G"));
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+    ast_nodes.push_back(new ASTFunction("I"));
+    ast_nodes.push_back(new ASTVariable("x"));
+
+    // The function passes alone never inline
+    assert(!mod_handler->get_force_inline());
+    mod_handler->codegen_ast(&ast_nodes, "called_func");
+    mod_handler->run_function_passes("called_func");
+    assert(mod_handler->get_call_count("called_func")==4);
+
+    mod_handler->set_force_inline(true);
+    assert(mod_handler->get_force_inline());
+
+    mod_handler->codegen_ast(&ast_nodes, "inlined_func");
+    mod_handler->run_function_passes("inlined_func");
+    assert(mod_handler->get_call_count("inlined_func")==0);
+
+    typedef double (*func_t)(double, double);
+    func_t called_func = (func_t) mod_handler->jit_function("called_func");
+    func_t inlined_func = (func_t) mod_handler->jit_function("inlined_func");
+
+    assert(called_func(1.0, 4.0)==6.0);
+    assert(inlined_func(1.0, 4.0)==6.0);
+    assert(inlined_func(-3.0, 2.0)==called_func(-3.0, 2.0));
+
+    // The population kernels are inlined too
+    const std::vector<std::vector<ASTNode*> > population(2, ast_nodes);
+    mod_handler->compile_population(population, "my_pop_", ModuleHandler::KERNEL_BATCH);
+    assert(mod_handler->get_call_count("my_pop_0")==0);
+    assert(mod_handler->get_call_count("my_pop_1")==0);
+
+    // The recursive primitives are still called, F(R(x), y) = fib(x) + y
+    std::vector<ASTNode*> recursive_nodes;
+    recursive_nodes.push_back(new ASTFunction("F"));
+    recursive_nodes.push_back(new ASTFunction("R"));
+    recursive_nodes.push_back(new ASTVariable("x"));
+    recursive_nodes.push_back(new ASTVariable("y"));
+
+    mod_handler->codegen_ast(&recursive_nodes, "recursive_func");
+    mod_handler->run_function_passes("recursive_func");
+    assert(mod_handler->get_call_count("recursive_func")==1);
+
+    func_t recursive_func = (func_t) mod_handler->jit_function("recursive_func");
+    assert(recursive_func(10.0, 1.0)==56.0);
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    for(unsigned int i=0; i < recursive_nodes.size(); i++)
+        delete recursive_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
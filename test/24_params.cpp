@@ -0,0 +1,138 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                    CONSTANT PARAMETERS
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    // G(F(x, 3.0), H(y, 2.0), 1.0) = x + 3 + y/2 - 1
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("G"));
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTConstant(3.0));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+    ast_nodes.push_back(new ASTConstant(1.0));
+
+    std::vector<unsigned int> param_layout;
+    mod_handler->codegen_ast_params(&ast_nodes, "my_func", param_layout);
+    mod_handler->run_function_passes("my_func");
+
+    assert(param_layout.size()==3);
+    assert(param_layout[0]==3 && param_layout[1]==6 && param_layout[2]==7);
+
+    std::vector<double> params;
+    ModuleHandler::get_parameter_values(&ast_nodes, param_layout, params);
+    assert(params[0]==3.0 && params[1]==2.0 && params[2]==1.0);
+
+    typedef double (*func_t)(double, double, const double*);
+    func_t my_func = (func_t) mod_handler->jit_function("my_func");
+
+    assert(my_func(1.0, 4.0, &params[0])==5.0);
+
+    // Other constants, without generating the code again
+    const double other_params[] = { 0.0, 4.0, 0.0 };
+    assert(my_func(1.0, 4.0, other_params)==2.0);
+
+    // The batch kernel
+    mod_handler->codegen_ast_params(&ast_nodes, "my_kernel", param_layout,
+                                    ModuleHandler::KERNEL_BATCH);
+    mod_handler->run_function_passes("my_kernel");
+
+    typedef void (*kernel_t)(const double* const*, double*, size_t, const double*);
+    kernel_t my_kernel = (kernel_t) mod_handler->jit_function("my_kernel");
+
+    const double x_values[] = { 1.0, 2.0, 3.0 };
+    const double y_values[] = { 4.0, 6.0, 8.0 };
+    const double *columns[] = { x_values, y_values };
+    double out[3];
+
+    my_kernel(columns, out, 3, &params[0]);
+    assert(out[0]==5.0 && out[1]==7.0 && out[2]==9.0);
+
+    my_kernel(columns, out, 3, other_params);
+    assert(out[0]==2.0 && out[1]==3.5 && out[2]==5.0);
+
+    // The best parameters are written back into the tree
+    ModuleHandler::set_parameter_values(&ast_nodes, param_layout, other_params);
+    assert(static_cast<ASTConstant*>(ast_nodes[6])->get_value()==4.0);
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
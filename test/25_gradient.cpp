@@ -0,0 +1,171 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLoader *loader3 =
+            ModuleLoader::create_from_file("mod3.o", error_string);
+
+    if(!loader3)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    link_ret = link->link_module_loader(loader3, error_string);
+    delete loader3;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                        GRADIENT
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    assert(ModuleHandler::get_derivative_name("H", 1)=="d_H_1");
+
+    // G(F(x, 3.0), H(y, 2.0), 1.0) = x + 3 + y/2 - 1
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("G"));
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTConstant(3.0));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+    ast_nodes.push_back(new ASTConstant(1.0));
+
+    std::vector<unsigned int> param_layout;
+    const bool gradient_generated =
+        mod_handler->codegen_ast_gradient(&ast_nodes, "my_gradient",
+                                          param_layout, error_string);
+    assert(gradient_generated);
+    mod_handler->run_function_passes("my_gradient");
+    assert(param_layout.size()==3);
+
+    std::vector<double> params;
+    ModuleHandler::get_parameter_values(&ast_nodes, param_layout, params);
+
+    typedef double (*gradient_t)(double, double, const double*, double*);
+    gradient_t my_gradient = (gradient_t) mod_handler->jit_function("my_gradient");
+
+    // The parameters, then the variables
+    double grad[5];
+    assert(my_gradient(1.0, 4.0, &params[0], grad)==5.0);
+    assert(grad[0]==1.0 && grad[1]==-1.0 && grad[2]==-1.0);
+    assert(grad[3]==1.0 && grad[4]==0.5);
+
+    // The fused sum of squared errors and gradient
+    const bool fitness_gradient_generated =
+        mod_handler->codegen_ast_fitness_gradient(&ast_nodes, "my_fitness_gradient",
+                                                  param_layout, error_string);
+    assert(fitness_gradient_generated);
+    mod_handler->run_function_passes("my_fitness_gradient");
+
+    typedef double (*fitness_gradient_t)(const double* const*, const double*, size_t,
+                                         const double*, double*);
+    fitness_gradient_t my_fitness_gradient =
+        (fitness_gradient_t) mod_handler->jit_function("my_fitness_gradient");
+
+    const double x_values[] = { 1.0, 2.0, 3.0 };
+    const double y_values[] = { 4.0, 6.0, 8.0 };
+    const double target[] = { 4.0, 7.0, 8.0 };
+    const double *columns[] = { x_values, y_values };
+
+    assert(my_fitness_gradient(columns, target, 3, &params[0], grad)==2.0);
+    assert(grad[0]==4.0 && grad[1]==-6.0 && grad[2]==-4.0);
+
+    assert(my_fitness_gradient(columns, target, 0, &params[0], grad)==0.0);
+    assert(grad[0]==0.0 && grad[1]==0.0 && grad[2]==0.0);
+
+    // I has no derivative primitive
+    std::vector<ASTNode*> no_derivative_nodes;
+    no_derivative_nodes.push_back(new ASTFunction("I"));
+    no_derivative_nodes.push_back(new ASTConstant(1.0));
+
+    const bool no_gradient_generated =
+        mod_handler->codegen_ast_gradient(&no_derivative_nodes, "no_gradient",
+                                          param_layout, error_string);
+    assert(!no_gradient_generated);
+    std::cout << error_string << std::endl;
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    delete no_derivative_nodes[0];
+    delete no_derivative_nodes[1];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLoader *loader4 =
+            ModuleLoader::create_from_file("mod4.o", error_string);
+
+    if(!loader4)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    link_ret = link->link_module_loader(loader4, error_string);
+    delete loader4;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                        INTERVAL
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    assert(ModuleHandler::get_interval_name("H", true)=="H_hi");
+
+    // F(I(x), H(y, 2.0)) over x in [0, 1], y in [2, 4] is in [1, 3]
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTFunction("I"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+
+    const bool interval_generated =
+        mod_handler->codegen_ast_interval(&ast_nodes, "my_interval", error_string);
+    assert(interval_generated);
+    mod_handler->run_function_passes("my_interval");
+
+    typedef void (*interval_t)(const double*, const double*, double*);
+    interval_t my_interval = (interval_t) mod_handler->jit_function("my_interval");
+
+    const double var_lo[] = { 0.0, 2.0 };
+    const double var_hi[] = { 1.0, 4.0 };
+    double bounds[2];
+
+    my_interval(var_lo, var_hi, bounds);
+    assert(bounds[0]==1.0 && bounds[1]==3.0);
+
+    // H(x, y) is unbounded when the interval of y contains zero
+    std::vector<ASTNode*> unbounded_nodes;
+    unbounded_nodes.push_back(new ASTFunction("H"));
+    unbounded_nodes.push_back(new ASTVariable("x"));
+    unbounded_nodes.push_back(new ASTVariable("y"));
+
+    const bool unbounded_generated =
+        mod_handler->codegen_ast_interval(&unbounded_nodes, "my_unbounded", error_string);
+    assert(unbounded_generated);
+    interval_t my_unbounded = (interval_t) mod_handler->jit_function("my_unbounded");
+
+    const double zero_lo[] = { 1.0, -1.0 };
+    const double zero_hi[] = { 2.0, 1.0 };
+
+    my_unbounded(zero_lo, zero_hi, bounds);
+    assert(bounds[0] < -1e300 && bounds[1] > 1e300);
+
+    // G_lo takes a float bound and G has no upper bound
+    std::vector<ASTNode*> no_interval_nodes;
+    no_interval_nodes.push_back(new ASTFunction("G"));
+    no_interval_nodes.push_back(new ASTConstant(1.0));
+    no_interval_nodes.push_back(new ASTConstant(2.0));
+    no_interval_nodes.push_back(new ASTConstant(3.0));
+
+    const bool no_interval_generated =
+        mod_handler->codegen_ast_interval(&no_interval_nodes, "no_interval",
+                                          error_string);
+    assert(!no_interval_generated);
+    std::cout << error_string << std::endl;
+    assert(error_string.find("invalid signature: G_lo") != std::string::npos);
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    for(unsigned int i=0; i < unbounded_nodes.size(); i++)
+        delete unbounded_nodes[i];
+    for(unsigned int i=0; i < no_interval_nodes.size(); i++)
+        delete no_interval_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shine.h"
+
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include <llvm/Support/ManagedStatic.h>
+
+using namespace shine;
+
+int main(void)
+{
+    std::string error_string;
+
+    shine_initialize();
+
+    ModuleLoader *loader1 =
+            ModuleLoader::create_from_file("mod1.o", error_string);
+
+    if(!loader1)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLinker *link = new ModuleLinker("lala", "lero");
+
+    bool link_ret = link->link_module_loader(loader1, error_string);
+    delete loader1;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleLoader *loader5 =
+            ModuleLoader::create_from_file("mod5.o", error_string);
+
+    if(!loader5)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    // The float variants are only accepted when asked
+    const bool double_closure = loader5->check_closure(error_string);
+    assert(!double_closure);
+    std::cout << error_string;
+    const bool float_closure = loader5->check_closure(error_string, true);
+    assert(float_closure);
+
+    link_ret = link->link_module_loader(loader5, error_string);
+    delete loader5;
+
+    if(!link_ret)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    ModuleHandler *mod_handler =
+            ModuleHandler::create(link->release_module(), error_string);
+
+    if(!mod_handler)
+    {
+        std::cout << "Error: " << error_string << std::endl;
+        return -1;
+    }
+
+    delete link;
+
+    /************************************************************
+     *                        PRECISION
+     ************************************************************/
+    std::vector<std::string> vars;
+    vars.push_back("x");
+    vars.push_back("y");
+
+    mod_handler->set_variable_list(vars);
+
+    assert(ModuleHandler::get_float_name("F")=="F_f");
+    assert(mod_handler->get_precision()==ModuleHandler::PRECISION_DOUBLE);
+
+    // F(x, H(y, 2.0)) = x + y/2
+    std::vector<ASTNode*> ast_nodes;
+    ast_nodes.push_back(new ASTFunction("F"));
+    ast_nodes.push_back(new ASTVariable("x"));
+    ast_nodes.push_back(new ASTFunction("H"));
+    ast_nodes.push_back(new ASTVariable("y"));
+    ast_nodes.push_back(new ASTConstant(2.0));
+
+    // Single precision, F_f is called and H is converted
+    mod_handler->set_precision(ModuleHandler::PRECISION_SINGLE);
+
+    const bool single_generated = mod_handler->codegen_ast(&ast_nodes, "my_single");
+    assert(single_generated);
+    mod_handler->run_function_passes("my_single");
+    assert(mod_handler->get_function_ir("my_single").find("@F_f")!=std::string::npos);
+
+    typedef float (*single_t)(float, float);
+    single_t my_single = (single_t) mod_handler->jit_function("my_single");
+    assert(my_single(1.0f, 4.0f)==3.0f);
+
+    const bool single_batch_generated =
+        mod_handler->codegen_ast_batch(&ast_nodes, "my_single_batch");
+    assert(single_batch_generated);
+    mod_handler->run_function_passes("my_single_batch");
+
+    typedef void (*single_batch_t)(const float* const*, float*, size_t);
+    single_batch_t my_single_batch =
+        (single_batch_t) mod_handler->jit_function("my_single_batch");
+
+    const float x_values[] = { 1.0f, 2.0f, 3.0f };
+    const float y_values[] = { 4.0f, 6.0f, 8.0f };
+    const float *columns[] = { x_values, y_values };
+    float single_out[3];
+
+    my_single_batch(columns, single_out, 3);
+    assert(single_out[0]==3.0f && single_out[1]==5.0f && single_out[2]==7.0f);
+
+    // Mixed precision, float data and double results
+    mod_handler->set_precision(ModuleHandler::PRECISION_MIXED);
+
+    const bool mixed_batch_generated =
+        mod_handler->codegen_ast_batch(&ast_nodes, "my_mixed_batch");
+    assert(mixed_batch_generated);
+    mod_handler->run_function_passes("my_mixed_batch");
+    assert(mod_handler->get_function_ir("my_mixed_batch").find("@F_f")==std::string::npos);
+
+    typedef void (*mixed_batch_t)(const float* const*, double*, size_t);
+    mixed_batch_t my_mixed_batch =
+        (mixed_batch_t) mod_handler->jit_function("my_mixed_batch");
+
+    double mixed_out[3];
+    my_mixed_batch(columns, mixed_out, 3);
+    assert(mixed_out[0]==3.0 && mixed_out[1]==5.0 && mixed_out[2]==7.0);
+
+    const bool mixed_fitness_generated =
+        mod_handler->codegen_ast_fitness(&ast_nodes, "my_mixed_fitness",
+                                         ModuleHandler::FITNESS_SSE);
+    assert(mixed_fitness_generated);
+    mod_handler->run_function_passes("my_mixed_fitness");
+
+    typedef double (*mixed_fitness_t)(const float* const*, const float*, size_t);
+    mixed_fitness_t my_mixed_fitness =
+        (mixed_fitness_t) mod_handler->jit_function("my_mixed_fitness");
+
+    const float target[] = { 3.0f, 6.0f, 7.0f };
+    assert(my_mixed_fitness(columns, target, 3)==1.0);
+    assert(my_mixed_fitness(columns, target, 0)==0.0);
+
+    // Back to double precision
+    mod_handler->set_precision(ModuleHandler::PRECISION_DOUBLE);
+
+    const bool double_generated = mod_handler->codegen_ast(&ast_nodes, "my_double");
+    assert(double_generated);
+
+    typedef double (*double_func_t)(double, double);
+    double_func_t my_double = (double_func_t) mod_handler->jit_function("my_double");
+    assert(my_double(1.0, 4.0)==3.0);
+
+    // A float only primitive is called with truncated values
+    std::vector<ASTNode*> float_nodes;
+    float_nodes.push_back(new ASTFunction("F_f"));
+    float_nodes.push_back(new ASTVariable("x"));
+    float_nodes.push_back(new ASTVariable("y"));
+
+    const bool float_double = mod_handler->codegen_ast(&float_nodes, "my_float_double");
+    assert(float_double);
+    assert(mod_handler->get_function_ir("my_float_double").find("fptrunc")!=std::string::npos);
+
+    double_func_t my_float_double =
+        (double_func_t) mod_handler->jit_function("my_float_double");
+    assert(my_float_double(1.0, 4.0)==5.0);
+
+    // The function cache doesn't return the kernels of another precision
+    FunctionCache cache(mod_handler);
+
+    void *cached_double = cache.get_function(&ast_nodes);
+    assert(((double_func_t)(intptr_t)cached_double)(1.0, 4.0)==3.0);
+
+    mod_handler->set_precision(ModuleHandler::PRECISION_SINGLE);
+
+    void *cached_single = cache.get_function(&ast_nodes);
+    assert(cached_single!=cached_double);
+    assert(cache.get_misses()==2);
+    assert(((single_t)(intptr_t)cached_single)(1.0f, 4.0f)==3.0f);
+
+    mod_handler->set_precision(ModuleHandler::PRECISION_DOUBLE);
+    assert(cache.get_function(&ast_nodes)==cached_double);
+    assert(cache.get_hits()==1);
+
+    cache.clear();
+
+    delete mod_handler;
+
+    for(unsigned int i=0; i < ast_nodes.size(); i++)
+        delete ast_nodes[i];
+    for(unsigned int i=0; i < float_nodes.size(); i++)
+        delete float_nodes[i];
+
+    shine_shutdown();
+
+    return 0;
+}
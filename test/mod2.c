@@ -0,0 +1,63 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+
+double mod2_total = 0.0;
+const double mod2_scale = 2.0;
+
+/* Writes a global: side effects */
+double J(double a)
+{
+    mod2_total += a;
+    return mod2_total;
+}
+
+/* Reads a global: readonly */
+double K(double a)
+{
+    return a + mod2_total;
+}
+
+/* Reads a constant global: readnone */
+double L(double a)
+{
+    return a * mod2_scale;
+}
+
+/* Calls a readonly primitive: readonly */
+double M(double a, double b)
+{
+    return L(a) + K(b);
+}
+
+/* Calls the I/O: side effects */
+double P(double a)
+{
+    printf("%f\n", a);
+    return a;
+}
+
+/* Calls itself twice: recursive */
+double R(double a)
+{
+    if(a < 2.0)
+        return a;
+    return R(a - 1.0) + R(a - 2.0);
+}
@@ -0,0 +1,59 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The derivative primitives of mod1.c, d_F_k is the partial
+ * derivative of F with respect to its argument k. The primitive
+ * I has no derivatives, to test the missing derivatives.
+ */
+
+double d_F_0(double a, double b)
+{
+    return 1.0;
+}
+
+double d_F_1(double a, double b)
+{
+    return 1.0;
+}
+
+double d_G_0(double a, double b, double c)
+{
+    return 1.0;
+}
+
+double d_G_1(double a, double b, double c)
+{
+    return 1.0;
+}
+
+double d_G_2(double a, double b, double c)
+{
+    return -1.0;
+}
+
+double d_H_0(double a, double b)
+{
+    return 1.0/b;
+}
+
+double d_H_1(double a, double b)
+{
+    return -a/(b*b);
+}
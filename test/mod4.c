@@ -0,0 +1,87 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The interval primitives of mod1.c, F_lo and F_hi are the lower
+ * and upper bounds of F over the intervals of its arguments. The
+ * primitive G has no upper bound and a lower bound with a float
+ * argument, to test the missing and invalid interval primitives.
+ */
+
+#include <math.h>
+
+static double min4(double a, double b, double c, double d)
+{
+    double m = a;
+    if(b < m) m = b;
+    if(c < m) m = c;
+    if(d < m) m = d;
+    return m;
+}
+
+static double max4(double a, double b, double c, double d)
+{
+    double m = a;
+    if(b > m) m = b;
+    if(c > m) m = c;
+    if(d > m) m = d;
+    return m;
+}
+
+double F_lo(double a_lo, double a_hi, double b_lo, double b_hi)
+{
+    return a_lo + b_lo;
+}
+
+double F_hi(double a_lo, double a_hi, double b_lo, double b_hi)
+{
+    return a_hi + b_hi;
+}
+
+double H_lo(double a_lo, double a_hi, double b_lo, double b_hi)
+{
+    if(b_lo <= 0.0 && b_hi >= 0.0)
+        return -HUGE_VAL;
+
+    return min4(a_lo/b_lo, a_lo/b_hi, a_hi/b_lo, a_hi/b_hi);
+}
+
+double H_hi(double a_lo, double a_hi, double b_lo, double b_hi)
+{
+    if(b_lo <= 0.0 && b_hi >= 0.0)
+        return HUGE_VAL;
+
+    return max4(a_lo/b_lo, a_lo/b_hi, a_hi/b_lo, a_hi/b_hi);
+}
+
+double I_lo(double a_lo, double a_hi)
+{
+    return a_lo;
+}
+
+double I_hi(double a_lo, double a_hi)
+{
+    return a_hi;
+}
+
+double G_lo(double a_lo, double a_hi, double b_lo, double b_hi,
+            double c_lo, float c_hi)
+{
+    return a_lo + b_lo - c_hi;
+}
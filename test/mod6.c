@@ -0,0 +1,37 @@
+/*
+ * Shine - The Symbolic Regression Machine
+ *
+ * Copyright (C) 2011 Christian S. Perone
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/*
+ * The vector variants of mod1.c for the width 2, used by the vector
+ * kernels. The variant of H takes a scalar argument, it must be
+ * rejected by the closure check and scalarized by the kernels.
+ */
+
+typedef double v2df __attribute__((ext_vector_type(2)));
+
+v2df F_v2(v2df a, v2df b)
+{
+    return a + b;
+}
+
+v2df H_v2(v2df a, double b)
+{
+    return a / b;
+}